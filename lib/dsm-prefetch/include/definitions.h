@@ -30,6 +30,12 @@ typedef struct {
 #define MADV_WRITE 19 // Request read permissions
 #define MADV_RELEASE 18 // Forfeit current permissions
 
+/*
+ * Maximum number of spans submitted to the kernel in a single call, i.e., the
+ * kernel's limit on the number of iovecs passed to process_madvise().
+ */
+#define PREFETCH_BATCH 1024
+
 /* Enable/disable printing debugging messages */
 #ifdef _DEBUG
 #include <stdio.h>
@@ -51,11 +57,33 @@ typedef struct {
 /* Environment variable to set log file for statistics */
 #define ENV_STAT_LOG_FN "POPCORN_PREFETCH_STATS_FN"
 
+/*
+ * Environment variable to submit prefetch requests with one madvise() per
+ * span rather than in batches.
+ */
+#define ENV_PER_SPAN "POPCORN_PREFETCH_PER_SPAN"
+
+/* Environment variables to set the largest gaps filled between spans */
+#define ENV_READ_GAP "POPCORN_PREFETCH_READ_GAP"
+#define ENV_WRITE_GAP "POPCORN_PREFETCH_WRITE_GAP"
+
 /*
  * Size of statically-allocated per-node cache.  Should be a multiple of 128 to
  * ensure caches pages for different nodes are placed on different pages.
  */
 #define NODE_CACHE_SIZE 64
 
+/*
+ * Number of nodes allocated from the heap at a time once a list's cache has
+ * been exhausted.
+ */
+#define NODE_CHUNK_SIZE 256
+
+/*
+ * Number of spans each thread can stage per node before having to merge them
+ * into the node's shared request lists.
+ */
+#define STAGING_SPANS 256
+
 #endif
 
@@ -26,6 +26,21 @@ typedef enum {
   RELEASE      /* Release current permissions */
 } access_type_t;
 
+/*
+ * A handle for waiting on prefetch requests executed asynchronously.  Tokens
+ * may be copied & waited on by any thread.
+ */
+typedef struct {
+  int nid;           /* the node for which requests were executed */
+  unsigned long seq; /* the last batch of requests handed off */
+} prefetch_token_t;
+
+/* A span of memory, for queueing many prefetch requests at once. */
+typedef struct {
+  const void *low;  /* the lowest address of the memory span */
+  const void *high; /* the highest address of the memory span */
+} prefetch_span_t;
+
 /*
  * Request prefetching for a contiguous span of memory for the node on which
  * the thread is currently executing.  Prefetch the pages containing up to but
@@ -54,6 +69,37 @@ void popcorn_prefetch_node(int nid,
                            const void *low,
                            const void *high);
 
+/*
+ * Request prefetching for many spans of memory on a node at once.  Equivalent
+ * to calling popcorn_prefetch_node() for each span, but sorts & merges the
+ * spans before queueing them, which is cheaper for large numbers of spans.
+ *
+ * @param nid the node on which the thread will be accessing the memory
+ * @param type how the thread will be accessing the memory
+ * @param spans the memory spans
+ * @param num the number of memory spans
+ */
+void popcorn_prefetch_node_bulk(int nid,
+                                access_type_t type,
+                                const prefetch_span_t *spans,
+                                size_t num);
+
+/*
+ * Set the largest gap, in pages, to fill between neighboring spans when
+ * executing prefetch requests for an access type.  Filling a gap prefetches
+ * pages that weren't requested but sends one request to the DSM rather than
+ * two, which is cheaper when the extra pages take less time to transfer than
+ * the additional request.  Only applies to reading & writing; releases are
+ * never coalesced, and gaps are never filled when prefetching manually.
+ * Defaults to 0 (no gaps filled), or to the value of the
+ * POPCORN_PREFETCH_READ_GAP & POPCORN_PREFETCH_WRITE_GAP environment
+ * variables.
+ *
+ * @param type the access type
+ * @param pages the largest gap to fill, in pages
+ */
+void popcorn_prefetch_set_gap(access_type_t type, size_t pages);
+
 /*
  * Return the number of prefetch requests currently batched for a given node &
  * access type.
@@ -69,9 +115,9 @@ size_t popcorn_prefetch_num_requests(int nid, access_type_t type);
  * the thread is currently executing and clear the queued requests.  Only needs
  * to be called once per node.
  *
- * Note: if manual asynchronous prefetching is enabled, the return value of
- * prefetch requests executed is approximate -- rather than synchronizing with
- * the thread to get an exact answer, return potentially-stale information.
+ * Note: if manual asynchronous prefetching is enabled, requests are handed off
+ * to a prefetching thread for the node & this returns without waiting for
+ * them to be sent.
  *
  * @return the number of prefetch requests executed
  */
@@ -81,15 +127,54 @@ size_t popcorn_prefetch_execute();
  * Inform the DSM of all outstanding prefetch requests for the specified node
  * and clear the queued requests.  Only needs to be called once per node.
  *
- * Note: if manual asynchronous prefetching is enabled, the return value of
- * prefetch requests executed is approximate -- rather than synchronizing with
- * the thread to get an exact answer, return potentially-stale information.
+ * Note: if manual asynchronous prefetching is enabled, requests are handed off
+ * to a prefetching thread for the node & this returns without waiting for
+ * them to be sent.
  *
  * @param nid the node for which to prefetch data
  * @return the number of prefetch requests executed
  */
 size_t popcorn_prefetch_execute_node(int nid);
 
+/*
+ * Hand off all outstanding prefetch requests for the node on which the thread
+ * is currently executing to a prefetching thread for that node, and clear the
+ * queued requests.  Returns without waiting for the requests to be sent to
+ * the DSM, allowing the caller to overlap prefetching with computation.
+ *
+ * @return a token for waiting until the requests have been sent
+ */
+prefetch_token_t popcorn_prefetch_execute_async();
+
+/*
+ * Hand off all outstanding prefetch requests for the specified node to a
+ * prefetching thread for that node, and clear the queued requests.  Returns
+ * without waiting for the requests to be sent to the DSM.  Unlike
+ * popcorn_prefetch_execute_node(), the calling thread need not be executing
+ * on the node.
+ *
+ * @param nid the node for which to prefetch data
+ * @return a token for waiting until the requests have been sent
+ */
+prefetch_token_t popcorn_prefetch_execute_node_async(int nid);
+
+/*
+ * Check whether asynchronously-executed prefetch requests have been sent to
+ * the DSM.
+ *
+ * @param token a token returned by popcorn_prefetch_execute_*async()
+ * @return non-zero if the requests have been sent, or zero otherwise
+ */
+int popcorn_prefetch_poll(prefetch_token_t token);
+
+/*
+ * Wait until asynchronously-executed prefetch requests have been sent to the
+ * DSM.
+ *
+ * @param token a token returned by popcorn_prefetch_execute_*async()
+ */
+void popcorn_prefetch_wait(prefetch_token_t token);
+
 #ifdef __cplusplus
 }
 #endif
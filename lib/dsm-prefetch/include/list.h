@@ -19,10 +19,14 @@ typedef struct node_t node_t;
 /* An opaque cache entry type. */
 typedef struct node_cache_t node_cache_t;
 
-/* A sorted linked list. */
+/*
+ * A sorted list of disjoint memory spans.  Spans are kept in a balanced binary
+ * search tree so that inserting, removing & looking up spans takes
+ * logarithmic time in the number of spans queued.
+ */
 typedef struct {
   node_cache_t *cache;
-  node_t *head, *tail;
+  node_t *root, *free;
   size_t size;
   int nid;
   pthread_mutex_t lock;
@@ -53,6 +57,19 @@ size_t list_size(const list_t *l);
  */
 void list_insert(list_t *l, const memory_span_t *mem);
 
+/*
+ * Insert multiple memory regions into the list, merging with other spans as
+ * needed.  Cheaper than inserting the regions individually, especially into an
+ * empty list.
+ *
+ * Note: sorts & coalesces the memory regions in place.
+ *
+ * @param l a list
+ * @param mem an array of contiguous memory regions to be inserted
+ * @param num the number of memory regions
+ */
+void list_insert_bulk(list_t *l, memory_span_t *mem, size_t num);
+
 /*
  * Return true if the list has a memory region that overlaps a span, or false
  * otherwise.
@@ -0,0 +1,46 @@
+/*
+ * Per-thread staging buffers for prefetch requests.  Threads append requests
+ * to their own buffers without synchronizing with other threads; staged
+ * requests are merged into a node's shared request lists when the node's
+ * requests are queried or executed, or when a thread's buffer fills up.
+ *
+ * Date: 10/16/2026
+ */
+
+#ifndef _STAGING_H
+#define _STAGING_H
+
+#include <stdbool.h>
+#include "definitions.h"
+#include "dsm-prefetch.h"
+#include "list.h"
+
+/*
+ * Stage a prefetch request in the calling thread's buffer for a node.
+ *
+ * @param nid the node for the prefetch request
+ * @param type the access type
+ * @param mem the memory span
+ * @return true if the request was staged, or false if the buffer is full and
+ *         must be drained
+ */
+bool staging_push(int nid, access_type_t type, const memory_span_t *mem);
+
+/*
+ * Merge staged requests for a node into its request lists.  The caller must
+ * hold all three lists' locks.
+ *
+ * @param nid the node
+ * @param all merge all threads' staged requests if true, or only the calling
+ *            thread's if false
+ * @param read the node's read request list
+ * @param write the node's write request list
+ * @param release the node's release request list
+ */
+void staging_drain(int nid,
+                   bool all,
+                   list_t *read,
+                   list_t *write,
+                   list_t *release);
+
+#endif
@@ -7,17 +7,22 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
+#include <errno.h>
 #include <migrate.h>
-#include <semaphore.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <time.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
 
 #include "platform.h"
 #include "definitions.h"
 #include "list.h"
+#include "staging.h"
 #include "dsm-prefetch.h"
 
 
@@ -31,13 +36,39 @@ typedef struct {
   char padding[PAGESZ - (3 * sizeof(list_t))];
 } __attribute__((aligned (PAGESZ))) node_requests_t;
 
-/* Parameters for threads performing asynchronous manual prefetching. */
+/* A batch of spans handed off to a node's prefetching thread. */
+typedef struct pending_t {
+  access_type_t type;
+  size_t num;
+  unsigned long seq;
+  struct pending_t *next;
+  struct iovec iov[];
+} pending_t;
+
+/*
+ * A thread which migrates to a node & submits batches of spans on behalf of
+ * threads executing prefetch requests asynchronously.  Batches are numbered in
+ * the order they're queued & submitted in that order, so a batch has been
+ * submitted once the thread has completed a batch with an equal or higher
+ * number.
+ */
 typedef struct {
   int nid;
-  volatile bool exit;
-  sem_t work;
-  char padding[PAGESZ - sizeof(size_t) - sizeof(sem_t)];
-} __attribute__((aligned (PAGESZ))) thread_arg_t;
+  bool started, exit;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t work, done;
+  pending_t *head, *tail;
+  unsigned long queued; // Number of the last batch queued
+  unsigned long completed; // Number of the last batch submitted
+} __attribute__((aligned (PAGESZ))) worker_t;
+
+#ifndef SYS_process_madvise
+#define SYS_process_madvise 440
+#endif
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
 
 /* Statically-allocated lists. */
 static node_requests_t requests[MAX_POPCORN_NODES];
@@ -47,24 +78,49 @@ typedef struct {
   size_t num; // Number of prefetch requests
   size_t pages; // Number of pages prefetched
   size_t time; // Time to prefetch, in nanoseconds
+  size_t calls; // Number of system calls issued
+  size_t coalesced; // Number of requests saved by filling gaps between spans
+  size_t overfetched; // Number of unrequested pages prefetched to fill gaps
 } stats_t;
 
-static stats_t total_stats = { .num = 0, .pages = 0, .time = 0 };
+static stats_t total_stats = { .num = 0, .pages = 0, .time = 0, .calls = 0,
+                               .coalesced = 0, .overfetched = 0 };
+
+/* Largest gaps (in pages) filled between spans, per access type. */
+static size_t gap_pages[RELEASE + 1] = { 0 };
+
+/*
+ * Merge staged requests into a node's lists.  Merges all threads' staged
+ * requests if ALL is true, or only the calling thread's otherwise.
+ */
+static void merge_staged(int nid, bool all)
+{
+  list_atomic_start(&requests[nid].release);
+  list_atomic_start(&requests[nid].read);
+  list_atomic_start(&requests[nid].write);
+  staging_drain(nid, all, &requests[nid].read, &requests[nid].write,
+                &requests[nid].release);
+  list_atomic_end(&requests[nid].write);
+  list_atomic_end(&requests[nid].read);
+  list_atomic_end(&requests[nid].release);
+}
 
 static void accumulate_global_stats(stats_t *stats) {
   __atomic_fetch_add(&total_stats.num, stats->num, __ATOMIC_RELAXED);
 #ifdef _STATISTICS
   __atomic_fetch_add(&total_stats.pages, stats->pages, __ATOMIC_RELAXED);
   __atomic_fetch_add(&total_stats.time, stats->time, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&total_stats.calls, stats->calls, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&total_stats.coalesced, stats->coalesced,
+                     __ATOMIC_RELAXED);
+  __atomic_fetch_add(&total_stats.overfetched, stats->overfetched,
+                     __ATOMIC_RELAXED);
 #endif
 }
 
-#ifdef _MAPREFETCH
-/* Threads for asynchronous manual prefetching */
-static pthread_t prefetch_threads[MAX_POPCORN_NODES];
-static thread_arg_t prefetch_params[MAX_POPCORN_NODES];
+/* Per-node prefetching threads, started on demand. */
+static worker_t workers[MAX_POPCORN_NODES];
 static void *prefetch_thread_main(void *arg);
-#endif
 
 /* Get a human-readable string for the access type. */
 static inline const char * __attribute__((unused))
@@ -79,6 +135,59 @@ access_type_str(access_type_t type)
   }
 }
 
+/* Start a node's prefetching thread if not already started. */
+static bool start_worker(int nid)
+{
+  worker_t *worker = &workers[nid];
+
+  if(__atomic_load_n(&worker->started, __ATOMIC_ACQUIRE)) return true;
+
+  pthread_mutex_lock(&worker->lock);
+  if(!worker->started)
+  {
+    if(!pthread_create(&worker->thread, NULL, prefetch_thread_main, worker))
+      __atomic_store_n(&worker->started, true, __ATOMIC_RELEASE);
+    else warn("Could not initialize prefetching thread %d\n", nid);
+  }
+  pthread_mutex_unlock(&worker->lock);
+
+  return worker->started;
+}
+
+/*
+ * Queue a batch of spans for a node's prefetching thread.  Prefetching is only
+ * a hint, so drop the batch if it can't be allocated.
+ */
+static void queue_pending(worker_t *worker,
+                          access_type_t type,
+                          const struct iovec *iov,
+                          size_t num)
+{
+  pending_t *pending;
+  size_t i;
+
+  pending = popcorn_malloc(sizeof(pending_t) + sizeof(struct iovec) * num,
+                           worker->nid);
+  if(!pending)
+  {
+    warn("Could not allocate batch of %lu spans for node %d\n",
+         num, worker->nid);
+    return;
+  }
+  pending->type = type;
+  pending->num = num;
+  pending->next = NULL;
+  for(i = 0; i < num; i++) pending->iov[i] = iov[i];
+
+  pthread_mutex_lock(&worker->lock);
+  pending->seq = ++worker->queued;
+  if(worker->tail) worker->tail->next = pending;
+  else worker->head = pending;
+  worker->tail = pending;
+  pthread_cond_signal(&worker->work);
+  pthread_mutex_unlock(&worker->lock);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Initialization & cleanup
 ///////////////////////////////////////////////////////////////////////////////
@@ -89,6 +198,7 @@ access_type_str(access_type_t type)
  */
 static void __attribute__((constructor)) prefetch_initialize()
 {
+  const char *env;
   size_t i;
   for(i = 0; i < MAX_POPCORN_NODES; i++)
   {
@@ -97,8 +207,18 @@ static void __attribute__((constructor)) prefetch_initialize()
     list_init(&requests[i].release, i);
   }
 
+  if((env = getenv(ENV_READ_GAP))) gap_pages[READ] = strtoul(env, NULL, 10);
+  if((env = getenv(ENV_WRITE_GAP))) gap_pages[WRITE] = strtoul(env, NULL, 10);
+
+  for(i = 0; i < MAX_POPCORN_NODES; i++)
+  {
+    workers[i].nid = i;
+    pthread_mutex_init(&workers[i].lock, NULL);
+    pthread_cond_init(&workers[i].work, NULL);
+    pthread_cond_init(&workers[i].done, NULL);
+  }
+
 #ifdef _MAPREFETCH
-  int failed;
   for(i = 0; i < MAX_POPCORN_NODES; i++)
   {
     if(!node_available(i))
@@ -106,48 +226,50 @@ static void __attribute__((constructor)) prefetch_initialize()
       warn("Node %lu not available for prefetching\n", i);
       continue;
     }
-
-    prefetch_params[i].nid = i;
-    prefetch_params[i].exit = false;
-    failed = sem_init(&prefetch_params[i].work, 0, 0);
-    failed |= pthread_create(&prefetch_threads[i], NULL, prefetch_thread_main,
-                             &prefetch_params[i]);
-    if(failed) warn("Could not initialize prefetching thread %d\n", i);
+    start_worker(i);
   }
 #endif
 }
 
-#ifdef _MAPREFETCH
-/* Join all prefetching threads. */
+/*
+ * Join all prefetching threads, which submit any remaining batches before
+ * exiting.
+ */
 static void __attribute__((destructor)) prefetch_end()
 {
   size_t i;
+#ifdef _STATISTICS
+  const char *fn = NULL;
+  FILE *out = stderr;
+#endif
+
   for(i = 0; i < MAX_POPCORN_NODES; i++)
   {
-    if(!node_available(i)) continue;
+    if(!workers[i].started) continue;
 
-    prefetch_params[i].exit = true;
-    sem_post(&prefetch_params[i].work);
-    pthread_join(prefetch_threads[i], NULL);
-    sem_destroy(&prefetch_params[i].work);
+    pthread_mutex_lock(&workers[i].lock);
+    workers[i].exit = true;
+    pthread_cond_signal(&workers[i].work);
+    pthread_mutex_unlock(&workers[i].lock);
+    pthread_join(workers[i].thread, NULL);
   }
-}
-#elif defined _STATISTICS
-static void __attribute__((destructor)) print_stats() {
-  const char *fn = NULL;
-  FILE *out = stderr;
 
+#ifdef _STATISTICS
   if((fn = getenv(ENV_STAT_LOG_FN))) out = fopen(fn, "w");
 
   if(out)
     fprintf(out, "Executed %lu prefetch requests\n"
                  "Prefetched %lu pages\n"
-                 "Prefetching took %lu nanoseconds\n",
-            total_stats.num, total_stats.pages, total_stats.time);
+                 "Prefetching took %lu nanoseconds\n"
+                 "Issued %lu system calls (saved %ld)\n"
+                 "Filling gaps saved %lu requests & over-fetched %lu pages\n",
+            total_stats.num, total_stats.pages, total_stats.time,
+            total_stats.calls, (long)(total_stats.num - total_stats.calls),
+            total_stats.coalesced, total_stats.overfetched);
 
   if(fn && out) fclose(out);
-}
 #endif
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 // Prefetch request batching
@@ -188,6 +310,19 @@ void popcorn_prefetch_node(int nid,
   debug("Node %d: queueing span 0x%lx -> 0x%lx for %s\n",
         nid, span.low, span.high, access_type_str(type));
 
+  if(type != READ && type != WRITE && type != RELEASE)
+  {
+    assert(false && "Unknown access type");
+    return;
+  }
+
+  // Stage the request in this thread's buffer, merging the buffer into the
+  // node's lists if it's full.  If the buffer can't be allocated, insert the
+  // request into the lists directly.
+  if(staging_push(nid, type, &span)) return;
+  merge_staged(nid, false);
+  if(staging_push(nid, type, &span)) return;
+
   switch(type)
   {
   case READ: list_insert(&requests[nid].read, &span); break;
@@ -197,6 +332,71 @@ void popcorn_prefetch_node(int nid,
   }
 }
 
+void popcorn_prefetch_set_gap(access_type_t type, size_t pages)
+{
+  if(type != READ && type != WRITE)
+  {
+    warn("Gaps can only be filled when reading or writing\n");
+    return;
+  }
+#ifdef _MANUAL_PREFETCH
+  warn("Gaps are never filled when prefetching manually\n");
+#endif
+  __atomic_store_n(&gap_pages[type], pages, __ATOMIC_RELAXED);
+}
+
+void popcorn_prefetch_node_bulk(int nid,
+                                access_type_t type,
+                                const prefetch_span_t *spans,
+                                size_t num)
+{
+  memory_span_t *batch;
+  size_t i, valid;
+  list_t *list;
+
+  // Ensure prefetch request is for a valid node.
+  if(nid < 0 || nid >= MAX_POPCORN_NODES)
+  {
+    warn("Invalid node ID %d\n", nid);
+    return;
+  }
+
+  switch(type)
+  {
+  case READ: list = &requests[nid].read; break;
+  case WRITE: list = &requests[nid].write; break;
+  case RELEASE: list = &requests[nid].release; break;
+  default: assert(false && "Unknown access type"); return;
+  }
+
+  if(!(batch = malloc(sizeof(memory_span_t) * num)))
+  {
+    for(i = 0; i < num; i++)
+      popcorn_prefetch_node(nid, type, spans[i].low, spans[i].high);
+    return;
+  }
+
+  for(i = 0, valid = 0; i < num; i++)
+  {
+    if(spans[i].low >= spans[i].high)
+    {
+      warn("Invalid bounds %p - %p: %s\n", spans[i].low, spans[i].high,
+           spans[i].low == spans[i].high ? "zero-sized span"
+                                         : "inverted bounds");
+      continue;
+    }
+    batch[valid].low = PAGE_ROUND_DOWN((uint64_t)spans[i].low);
+    batch[valid].high = PAGE_ROUND_UP((uint64_t)spans[i].high);
+    valid++;
+  }
+
+  debug("Node %d: queueing %lu spans for %s\n",
+        nid, valid, access_type_str(type));
+
+  list_insert_bulk(list, batch, valid);
+  free(batch);
+}
+
 size_t popcorn_prefetch_num_requests(int nid, access_type_t type)
 {
   // Ensure prefetch request is for a valid node.
@@ -206,6 +406,7 @@ size_t popcorn_prefetch_num_requests(int nid, access_type_t type)
     return 0;
   }
 
+  merge_staged(nid, true);
   switch(type)
   {
   case READ: return list_size(&requests[nid].read);
@@ -255,38 +456,200 @@ prefetch_span_manual(access_type_t type, const memory_span_t *span)
   }
 }
 
-/* Prefetch a given span */
-static void prefetch_span(access_type_t type, const memory_span_t *span)
+/*
+ * Spans of a single access type batched together for submission, either
+ * directly by the executing thread or, if WORKER is set, by a node's
+ * prefetching thread.
+ */
+typedef struct {
+  access_type_t type;
+  size_t num;
+  worker_t *worker;
+  struct iovec iov[PREFETCH_BATCH];
+} batch_t;
+
+/*
+ * Process file descriptor used to submit batches with process_madvise(), and
+ * whether the kernel accepts vectored submissions.  If the kernel doesn't
+ * support process_madvise() or rejects DSM advice through it, batches are
+ * submitted by calling madvise() on each span instead.
+ */
+static int pidfd = -1;
+static bool vectored = true;
+static pthread_once_t pidfd_once = PTHREAD_ONCE_INIT;
+
+static void open_pidfd(void)
 {
+  if(getenv(ENV_PER_SPAN))
+  {
+    __atomic_store_n(&vectored, false, __ATOMIC_RELAXED);
+    return;
+  }
+
+  pidfd = syscall(SYS_pidfd_open, getpid(), 0);
+  if(pidfd < 0)
+  {
+    warn("Could not open pidfd, submitting prefetch requests per span\n");
+    __atomic_store_n(&vectored, false, __ATOMIC_RELAXED);
+  }
+}
+
+static inline int advice(access_type_t type)
+{
+  switch(type)
+  {
+  case READ: return MADV_READ;
+  case WRITE: return MADV_WRITE;
+  case RELEASE: return MADV_RELEASE;
+  default: assert(false && "Unknown access type"); return -1;
+  }
+}
+
+/*
+ * Submit a batch of spans to the kernel.  Submits the entire batch in a
+ * single process_madvise() call if supported, falling back to calling
+ * madvise() for each span otherwise.
+ *
+ * @param type the access type
+ * @param iov the spans
+ * @param num the number of spans
+ * @return the number of system calls issued
+ */
+static size_t submit_spans(access_type_t type,
+                           const struct iovec *iov,
+                           size_t num)
+{
+  int adv = advice(type);
+  size_t i = 0, calls = 0;
+  ssize_t ret;
+
 #ifdef _MANUAL_PREFETCH
   // Note: no manual analog to releasing ownership
-  if(type != RELEASE) prefetch_span_manual(type, span);
-  else madvise((void *)span->low, SPAN_SIZE(*span), MADV_RELEASE);
-#else
-  switch(type)
+  if(type != RELEASE)
   {
-  case READ: madvise((void *)span->low, SPAN_SIZE(*span), MADV_READ); break;
-  case WRITE: madvise((void *)span->low, SPAN_SIZE(*span), MADV_WRITE); break;
-  case RELEASE:
-    madvise((void *)span->low, SPAN_SIZE(*span), MADV_RELEASE);
-    break;
-  default: assert(false && "Unknown access type"); break;
+    memory_span_t span;
+    for(i = 0; i < num; i++)
+    {
+      span.low = (uint64_t)iov[i].iov_base;
+      span.high = span.low + iov[i].iov_len;
+      prefetch_span_manual(type, &span);
+    }
+    return 0;
   }
 #endif /* _MANUAL_PREFETCH */
+
+  pthread_once(&pidfd_once, open_pidfd);
+  while(i < num && __atomic_load_n(&vectored, __ATOMIC_RELAXED))
+  {
+    ret = syscall(SYS_process_madvise, pidfd, &iov[i], num - i, adv, 0);
+    calls++;
+    if(ret < 0)
+    {
+      if(errno == ENOSYS || errno == EINVAL || errno == EPERM ||
+         errno == EBADF)
+      {
+        warn("Vectored prefetching not supported (%d), "
+             "submitting prefetch requests per span\n", errno);
+        __atomic_store_n(&vectored, false, __ATOMIC_RELAXED);
+      }
+      else i++; // Like madvise() failures, ignore the span & continue
+      continue;
+    }
+
+    // The kernel stops at the first span it fails to advise; skip past the
+    // advised spans & the failed span and submit the remainder.
+    for(; i < num && (size_t)ret >= iov[i].iov_len; i++) ret -= iov[i].iov_len;
+    if(i < num) i++;
+  }
+
+  for(; i < num; i++, calls++) madvise(iov[i].iov_base, iov[i].iov_len, adv);
+
+  return calls;
+}
+
+/* Submit spans & record the number of system calls & time to submit them. */
+static void submit_spans_timed(access_type_t type,
+                               const struct iovec *iov,
+                               size_t num,
+                               stats_t *stats)
+{
+#ifdef _STATISTICS
+  struct timespec start_time, end_time;
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+#endif
+  stats->calls += submit_spans(type, iov, num);
+#ifdef _STATISTICS
+  clock_gettime(CLOCK_MONOTONIC, &end_time);
+  stats->time += NS(end_time) - NS(start_time);
+#endif
+}
+
+/* Submit (or hand off to the node's prefetching thread) & empty a batch. */
+static void prefetch_batch_flush(batch_t *batch, stats_t *stats)
+{
+  if(!batch->num) return;
+  if(batch->worker)
+    queue_pending(batch->worker, batch->type, batch->iov, batch->num);
+  else submit_spans_timed(batch->type, batch->iov, batch->num, stats);
+  batch->num = 0;
+}
+
+/* Prefetch a given span by adding it to a batch. */
+static void prefetch_batch_add(batch_t *batch,
+                               const memory_span_t *span,
+                               stats_t *stats)
+{
+#ifdef _STATISTICS
+  stats->pages += SPAN_NUM_PAGES(*span);
+#endif
+  stats->num++;
+
+#ifndef _MANUAL_PREFETCH
+  // Spans are added in ascending order, so fill a small enough gap between
+  // this span & the previous one by extending the previous span.
+  //
+  // Note: never done for manual prefetching, which would touch (& for
+  // writing, modify) pages nobody requested & which may not be mapped.
+  if(batch->num)
+  {
+    struct iovec *prev = &batch->iov[batch->num - 1];
+    uint64_t gap = span->low - ((uint64_t)prev->iov_base + prev->iov_len);
+    if(gap <= __atomic_load_n(&gap_pages[batch->type], __ATOMIC_RELAXED) *
+              PAGESZ)
+    {
+      prev->iov_len = span->high - (uint64_t)prev->iov_base;
+#ifdef _STATISTICS
+      stats->coalesced++;
+      stats->overfetched += gap / PAGESZ;
+#endif
+      return;
+    }
+  }
+#endif /* _MANUAL_PREFETCH */
+
+  if(batch->num == PREFETCH_BATCH) prefetch_batch_flush(batch, stats);
+  batch->iov[batch->num].iov_base = (void *)span->low;
+  batch->iov[batch->num].iov_len = SPAN_SIZE(*span);
+  batch->num++;
 }
 
 /*
  * Core prefetching logic, used both in manual & OS-based prefetching.  By
  * default, only records the number of spans prefetched.  If _STATISTICS is
  * defined, records the number of pages and time to prefetch as well.
+ *
+ * If WORKER is set, hands batches off to the node's prefetching thread as
+ * they fill up rather than submitting them, and returns the number of the
+ * last batch queued in TOKEN.
  */
-static void popcorn_prefetch_execute_internal(int nid, stats_t *stats)
+static void popcorn_prefetch_execute_internal(int nid,
+                                              worker_t *worker,
+                                              stats_t *stats,
+                                              unsigned long *token)
 {
   const node_t *n, *end;
   const memory_span_t *span;
-#ifdef _STATISTICS
-  struct timespec start_time, end_time;
-#endif
+  batch_t batch;
 
   assert(0 <= nid && nid < MAX_POPCORN_NODES && "Invalid node ID");
   assert(stats && "Invalid stats parameter");
@@ -294,12 +657,17 @@ static void popcorn_prefetch_execute_internal(int nid, stats_t *stats)
   stats->num = 0;
   stats->pages = 0;
   stats->time = 0;
+  stats->calls = 0;
+  stats->coalesced = 0;
+  stats->overfetched = 0;
 
   // We can't prefetch to another node, so warn & clear out lists to prevent
   // them from growing forever due to failed prefetch executions.
-  if(current_nid() != nid) {
+  batch.worker = worker;
+  if(!worker && current_nid() != nid) {
     warn("Cannot prefetch to node on which we're not running (%d vs. %d)\n",
          current_nid(), nid);
+    merge_staged(nid, true);
     list_clear(&requests[nid].write);
     list_clear(&requests[nid].read);
     list_clear(&requests[nid].release);
@@ -307,12 +675,18 @@ static void popcorn_prefetch_execute_internal(int nid, stats_t *stats)
   }
 
   // Acquire locks to prevent other threads from trying to add new requests
-  // while we're processing the lists.
+  // while we're processing the lists, and merge in all staged requests.
+  // Requests are merged before processing so that writes supersede reads &
+  // prefetches cancel releases regardless of which thread staged them.
   list_atomic_start(&requests[nid].release);
   list_atomic_start(&requests[nid].read);
   list_atomic_start(&requests[nid].write);
+  staging_drain(nid, true, &requests[nid].read, &requests[nid].write,
+                &requests[nid].release);
 
   // Send write requests
+  batch.type = WRITE;
+  batch.num = 0;
   n = list_begin(&requests[nid].write);
   end = list_end(&requests[nid].write);
   while(n != end)
@@ -330,23 +704,17 @@ static void popcorn_prefetch_execute_internal(int nid, stats_t *stats)
     debug("Node %d: executing prefetch of 0x%lx -> 0x%lx for writing\n",
           nid, span->low, span->high);
 
-#ifdef _STATISTICS
-    clock_gettime(CLOCK_MONOTONIC, &start_time);
-#endif
-    prefetch_span(WRITE, span);
-#ifdef _STATISTICS
-    clock_gettime(CLOCK_MONOTONIC, &end_time);
-    stats->pages += SPAN_NUM_PAGES(*span);
-    stats->time += NS(end_time) - NS(start_time);
-#endif
-    stats->num++;
+    prefetch_batch_add(&batch, span, stats);
 
     n = list_next(n);
   }
+  prefetch_batch_flush(&batch, stats);
   list_clear(&requests[nid].write);
   list_atomic_end(&requests[nid].write);
 
   // Send read requests
+  batch.type = READ;
+  batch.num = 0;
   n = list_begin(&requests[nid].read);
   end = list_end(&requests[nid].read);
   while(n != end)
@@ -360,23 +728,17 @@ static void popcorn_prefetch_execute_internal(int nid, stats_t *stats)
     debug("Node %d: executing prefetch of 0x%lx -> 0x%lx for reading\n",
           nid, span->low, span->high);
 
-#ifdef _STATISTICS
-    clock_gettime(CLOCK_MONOTONIC, &start_time);
-#endif
-    prefetch_span(READ, span);
-#ifdef _STATISTICS
-    clock_gettime(CLOCK_MONOTONIC, &end_time);
-    stats->pages += SPAN_NUM_PAGES(*span);
-    stats->time += NS(end_time) - NS(start_time);
-#endif
-    stats->num++;
+    prefetch_batch_add(&batch, span, stats);
 
     n = list_next(n);
   }
+  prefetch_batch_flush(&batch, stats);
   list_clear(&requests[nid].read);
   list_atomic_end(&requests[nid].read);
 
   // Send release requests
+  batch.type = RELEASE;
+  batch.num = 0;
   n = list_begin(&requests[nid].release);
   end = list_end(&requests[nid].release);
   while(n != end)
@@ -386,20 +748,18 @@ static void popcorn_prefetch_execute_internal(int nid, stats_t *stats)
     debug("Node %d: executing release of 0x%lx -> 0x%lx\n",
           nid, span->low, span->high);
 
-#ifdef _STATISTICS
-    clock_gettime(CLOCK_MONOTONIC, &start_time);
-#endif
-    prefetch_span(RELEASE, span);
-#ifdef _STATISTICS
-    clock_gettime(CLOCK_MONOTONIC, &end_time);
-    stats->pages += SPAN_NUM_PAGES(*span);
-    stats->time += NS(end_time) - NS(start_time);
-#endif
-    stats->num++;
+    prefetch_batch_add(&batch, span, stats);
 
     n = list_next(n);
   }
+  prefetch_batch_flush(&batch, stats);
   list_clear(&requests[nid].release);
+  if(worker)
+  {
+    pthread_mutex_lock(&worker->lock);
+    *token = worker->queued;
+    pthread_mutex_unlock(&worker->lock);
+  }
   list_atomic_end(&requests[nid].release);
 }
 
@@ -411,6 +771,9 @@ size_t popcorn_prefetch_execute()
 size_t popcorn_prefetch_execute_node(int nid)
 {
   stats_t stats;
+#ifdef _MAPREFETCH
+  unsigned long token;
+#endif
 
   // Ensure prefetch request is for a valid node.
   if(nid < 0 || nid >= MAX_POPCORN_NODES)
@@ -420,53 +783,116 @@ size_t popcorn_prefetch_execute_node(int nid)
   }
 
 #ifdef _MAPREFETCH
-  stats.num = list_size(&requests[nid].write) +
-              list_size(&requests[nid].read) +
-              list_size(&requests[nid].release);
-  sem_post(&prefetch_params[nid].work);
+  if(start_worker(nid))
+    popcorn_prefetch_execute_internal(nid, &workers[nid], &stats, &token);
+  else popcorn_prefetch_execute_internal(nid, NULL, &stats, NULL);
 #else
-  popcorn_prefetch_execute_internal(nid, &stats);
-  accumulate_global_stats(&stats);
+  popcorn_prefetch_execute_internal(nid, NULL, &stats, NULL);
 #endif
+  accumulate_global_stats(&stats);
 
   return stats.num;
 }
 
-/* Prefetching thread main loop. */
-static void * __attribute__((unused))
-prefetch_thread_main(void *arg)
+prefetch_token_t popcorn_prefetch_execute_async()
+{
+  return popcorn_prefetch_execute_node_async(current_nid());
+}
+
+prefetch_token_t popcorn_prefetch_execute_node_async(int nid)
+{
+  prefetch_token_t token = { .nid = nid, .seq = 0 };
+  stats_t stats;
+
+  // Ensure prefetch request is for a valid node.
+  if(nid < 0 || nid >= MAX_POPCORN_NODES)
+  {
+    warn("Invalid node ID %d\n", nid);
+    return token;
+  }
+
+  // If the prefetching thread can't be started, prefetch synchronously
+  if(start_worker(nid))
+    popcorn_prefetch_execute_internal(nid, &workers[nid], &stats, &token.seq);
+  else popcorn_prefetch_execute_internal(nid, NULL, &stats, NULL);
+  accumulate_global_stats(&stats);
+
+  return token;
+}
+
+int popcorn_prefetch_poll(prefetch_token_t token)
+{
+  if(token.nid < 0 || token.nid >= MAX_POPCORN_NODES) return 1;
+  return __atomic_load_n(&workers[token.nid].completed, __ATOMIC_ACQUIRE) >=
+         token.seq;
+}
+
+void popcorn_prefetch_wait(prefetch_token_t token)
 {
-  stats_t stats = { .num = 0, .pages = 0, .time = 0 }, cur;
-  thread_arg_t *param = (thread_arg_t *)arg;
+  worker_t *worker;
+
+  if(popcorn_prefetch_poll(token)) return;
+
+  worker = &workers[token.nid];
+  pthread_mutex_lock(&worker->lock);
+  while(worker->completed < token.seq)
+    pthread_cond_wait(&worker->done, &worker->lock);
+  pthread_mutex_unlock(&worker->lock);
+}
+
+/*
+ * Prefetching thread main loop.  Submits batches in the order they were
+ * queued, so executing threads can keep collecting (and queueing) the next
+ * batches while previous ones are in flight.
+ */
+static void *prefetch_thread_main(void *arg)
+{
+  stats_t stats = { .num = 0, .pages = 0, .time = 0, .calls = 0,
+                    .coalesced = 0, .overfetched = 0 }, cur;
+  worker_t *worker = (worker_t *)arg;
+  pending_t *pending;
 
   debug("PID %d: servicing prefetch requests for node %d\n",
-        gettid(), param->nid);
+        gettid(), worker->nid);
 
-  migrate(param->nid, NULL, NULL);
-  if(current_nid() != param->nid) warn("PID %d: still on origin\n", gettid());
+  migrate(worker->nid, NULL, NULL);
+  if(current_nid() != worker->nid) warn("PID %d: still on origin\n", gettid());
 
-  sem_wait(&param->work);
-  while(!param->exit)
+  pthread_mutex_lock(&worker->lock);
+  while(true)
   {
-    debug("PID %d: prefetching for node %d\n", gettid(), param->nid);
-    popcorn_prefetch_execute_internal(param->nid, &cur);
-    stats.num += cur.num;
+    while(!worker->head && !worker->exit)
+      pthread_cond_wait(&worker->work, &worker->lock);
+    if(!(pending = worker->head)) break;
+    if(!(worker->head = pending->next)) worker->tail = NULL;
+    pthread_mutex_unlock(&worker->lock);
+
+    debug("PID %d: prefetching %lu spans for node %d\n",
+          gettid(), pending->num, worker->nid);
+    memset(&cur, 0, sizeof(cur));
+    submit_spans_timed(pending->type, pending->iov, pending->num, &cur);
+    accumulate_global_stats(&cur);
+    stats.num += pending->num;
 #ifdef _STATISTICS
-    stats.pages += cur.pages;
     stats.time += cur.time;
+    stats.calls += cur.calls;
 #endif
-    sem_wait(&param->work);
+
+    pthread_mutex_lock(&worker->lock);
+    __atomic_store_n(&worker->completed, pending->seq, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&worker->done);
+    popcorn_free(pending);
   }
+  pthread_mutex_unlock(&worker->lock);
 
   migrate(0, NULL, NULL);
 
 #ifndef _STATISTICS
-  debug("PID %d: executed %lu requests\n", gettid(), stats.num);
+  debug("PID %d: submitted %lu spans\n", gettid(), stats.num);
 #else
-  debug("PID %d: executed %lu requests, touched %lu pages, took %lu ns\n",
-        gettid(), stats.num, stats.pages, stats.time);
+  debug("PID %d: submitted %lu spans, took %lu ns, issued %lu system calls\n",
+        gettid(), stats.num, stats.time, stats.calls);
 #endif
 
   return NULL;
 }
-
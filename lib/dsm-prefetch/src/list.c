@@ -19,18 +19,20 @@
 // Node API
 ///////////////////////////////////////////////////////////////////////////////
 
-/* A linked list node. */
+/*
+ * A list node, i.e., a node in an AVL tree ordered by the spans' lowest
+ * addresses.  Free nodes are chained through their parent pointers.
+ */
 typedef struct node_t {
-  struct node_t *prev, *next;
+  struct node_t *parent, *left, *right;
+  int height;
   memory_span_t mem;
 } node_t;
 
-/* Per-node linked list node cache */
+/* Per-node list node cache */
 typedef struct node_cache_t {
   node_t node[NODE_CACHE_SIZE];
-  bool node_used[NODE_CACHE_SIZE];
-  char padding[PAGESZ - ((sizeof(node_t) * NODE_CACHE_SIZE +
-                          sizeof(bool) * NODE_CACHE_SIZE) % PAGESZ)];
+  char padding[PAGESZ - ((sizeof(node_t) * NODE_CACHE_SIZE) % PAGESZ)];
 } __attribute__((aligned(PAGESZ))) node_cache_t;
 
 #ifndef _NOCACHE
@@ -41,74 +43,206 @@ typedef struct node_cache_t {
   */
 #define NUM_CACHE (MAX_POPCORN_NODES * 3)
 
-/* Pre-allocated linked list nodes */
+/* Pre-allocated list nodes */
 static node_cache_t cache[NUM_CACHE];
 
 #endif
 
-/* Allocate & initialize a new linked list node */
-static node_t *node_create(node_cache_t *cache,
-                           const memory_span_t *mem,
-                           int nid)
+/* Add a node to the list's free nodes */
+static inline void node_free(list_t *l, node_t *n)
+{
+  assert(n && "Invalid node pointer");
+#ifdef _CHECKS
+  n->left = n->right = NULL;
+  n->mem.low = n->mem.high = 0;
+#endif
+  n->parent = l->free;
+  l->free = n;
+}
+
+/* Allocate & initialize a new list node */
+static node_t *node_create(list_t *l, const memory_span_t *mem)
 {
   node_t *n;
+  size_t i;
 
   assert(mem && "Invalid memory span pointer");
-  assert(0 <= nid && nid < MAX_POPCORN_NODES && "Invalid node ID");
-
-#ifndef _NOCACHE
-  // Try to allocate from the node cache before dropping to malloc
-  assert(cache && "Invalid cache pointer");
+  assert(0 <= l->nid && l->nid < MAX_POPCORN_NODES && "Invalid node ID");
 
-  size_t i;
-  for(i = 0; i < NODE_CACHE_SIZE; i++) {
-    if(!cache->node_used[i]) {
-      cache->node_used[i] = true;
-      cache->node[i].mem = *mem;
-#ifdef _CHECKS
-      cache->node[i].prev = cache->node[i].next = NULL;
-#endif
-      return &cache->node[i];
-    }
+  // Allocate nodes from the heap in chunks once the cache is exhausted.  Nodes
+  // are recycled through the free list rather than returned to the heap.
+  if(!l->free)
+  {
+    n = popcorn_malloc(sizeof(node_t) * NODE_CHUNK_SIZE, l->nid);
+    assert(n && "Invalid node pointer");
+    for(i = 0; i < NODE_CHUNK_SIZE; i++) node_free(l, &n[i]);
   }
-#endif
-  n = popcorn_malloc(sizeof(node_t), nid);
-  assert(n && "Invalid node pointer");
+
+  n = l->free;
+  l->free = n->parent;
+  n->parent = n->left = n->right = NULL;
+  n->height = 1;
   n->mem = *mem;
-#ifdef _CHECKS
-  n->prev = n->next = NULL;
-#endif
   return n;
 }
 
-/* Free a linked list node */
-static void node_free(node_cache_t *cache, node_t *n)
+///////////////////////////////////////////////////////////////////////////////
+// Tree API
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Tree operations return the new root of the subtree on which they operated.
+ * Callers are responsible for setting the returned root's parent pointer.
+ */
+
+static inline int tree_height(const node_t *n) { return n ? n->height : 0; }
+
+static inline void tree_update(node_t *n)
 {
-  assert(n && "Invalid node pointer");
-#ifdef _CHECKS
-  n->prev = n->next = NULL;
-  n->mem.low = n->mem.high = 0;
-#endif
-#ifndef _NOCACHE
-  assert(cache && "Invalid cache pointer");
-
-  // Determine if the node was allocated from the cache or heap
-  size_t entry;
-  void *cast = (void *)n, *cache_start = (void *)cache,
-       *cache_end = cache_start + offsetof(node_cache_t, node_used);
-  if(cache_start <= cast && cast < cache_end) {
-    entry = (cast - cache_start) / sizeof(node_t);
-
-    assert((cast - cache_start) % sizeof(node_t) == 0 &&
-           "Pointer into middle of node");
-    assert(entry < NODE_CACHE_SIZE && "Invalid node cache entry calculation");
-    assert(cache->node_used[entry] == true && "Invalid cache metadata");
-
-    cache->node_used[entry] = false;
-    return;
+  n->height = MAX(tree_height(n->left), tree_height(n->right)) + 1;
+}
+
+static inline void tree_set_left(node_t *n, node_t *child)
+{
+  n->left = child;
+  if(child) child->parent = n;
+}
+
+static inline void tree_set_right(node_t *n, node_t *child)
+{
+  n->right = child;
+  if(child) child->parent = n;
+}
+
+static node_t *tree_rotate_right(node_t *n)
+{
+  node_t *left = n->left;
+  tree_set_left(n, left->right);
+  tree_set_right(left, n);
+  tree_update(n);
+  tree_update(left);
+  return left;
+}
+
+static node_t *tree_rotate_left(node_t *n)
+{
+  node_t *right = n->right;
+  tree_set_right(n, right->left);
+  tree_set_left(right, n);
+  tree_update(n);
+  tree_update(right);
+  return right;
+}
+
+/* Restore the AVL balance property at a node. */
+static node_t *tree_rebalance(node_t *n)
+{
+  int balance = tree_height(n->left) - tree_height(n->right);
+
+  if(balance > 1)
+  {
+    if(tree_height(n->left->left) < tree_height(n->left->right))
+      tree_set_left(n, tree_rotate_left(n->left));
+    return tree_rotate_right(n);
   }
-#endif
-  free(n);
+  else if(balance < -1)
+  {
+    if(tree_height(n->right->right) < tree_height(n->right->left))
+      tree_set_right(n, tree_rotate_right(n->right));
+    return tree_rotate_left(n);
+  }
+  tree_update(n);
+  return n;
+}
+
+/* Insert a node whose span doesn't overlap any in the tree. */
+static node_t *tree_insert(node_t *root, node_t *n)
+{
+  if(!root) return n;
+  if(n->mem.low < root->mem.low)
+    tree_set_left(root, tree_insert(root->left, n));
+  else tree_set_right(root, tree_insert(root->right, n));
+  return tree_rebalance(root);
+}
+
+/* Unlink the leftmost node in a subtree. */
+static node_t *tree_remove_min(node_t *root, node_t **min)
+{
+  if(!root->left)
+  {
+    *min = root;
+    return root->right;
+  }
+  tree_set_left(root, tree_remove_min(root->left, min));
+  return tree_rebalance(root);
+}
+
+/*
+ * Unlink a node from the tree.  Nodes are relinked rather than having their
+ * spans copied, so pointers to other nodes remain valid.
+ */
+static node_t *tree_remove(node_t *root, node_t *n)
+{
+  node_t *min, *right;
+
+  assert(root && "Node not in tree");
+  if(n->mem.low < root->mem.low)
+    tree_set_left(root, tree_remove(root->left, n));
+  else if(n->mem.low > root->mem.low)
+    tree_set_right(root, tree_remove(root->right, n));
+  else
+  {
+    assert(root == n && "Duplicate span in tree");
+    if(!n->left) return n->right;
+    if(!n->right) return n->left;
+    right = tree_remove_min(n->right, &min);
+    tree_set_left(min, n->left);
+    tree_set_right(min, right);
+    root = min;
+  }
+  return tree_rebalance(root);
+}
+
+/* Build a balanced tree from nodes sorted by address. */
+static node_t *tree_build(node_t **nodes, size_t num)
+{
+  size_t mid = num / 2;
+  node_t *root;
+
+  if(!num) return NULL;
+  root = nodes[mid];
+  tree_set_left(root, tree_build(nodes, mid));
+  tree_set_right(root, tree_build(nodes + mid + 1, num - mid - 1));
+  tree_update(root);
+  return root;
+}
+
+/* Free all nodes in a subtree. */
+static void tree_free(list_t *l, node_t *n)
+{
+  if(!n) return;
+  tree_free(l, n->left);
+  tree_free(l, n->right);
+  node_free(l, n);
+}
+
+static inline node_t *tree_first(node_t *n)
+{
+  if(n) while(n->left) n = n->left;
+  return n;
+}
+
+static inline node_t *tree_next(const node_t *n)
+{
+  const node_t *child;
+
+  if(n->right) return tree_first(n->right);
+  do
+  {
+    child = n;
+    n = n->parent;
+  } while(n && n->right == child);
+  return (node_t *)n;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -188,97 +322,124 @@ list_check_contained(const memory_span_t *a, const memory_span_t *b)
  * pointer to the node containing 0x3000.  Note that if the start address
  * already exists in a node in the list, list_seek() returns that node.  For
  * example, calling list_seek() for another memory span starting at 0x3000
- * would again return a pointer to the node containing 0x3000.
+ * would again return a pointer to the node containing 0x3000.  The node
+ * directly before where the span would be inserted is returned in prev.
  *
  * @param l a list
  * @param mem a memory span
+ * @param prev set to the predecessor node, or NULL if the span would be added
+ *             as the head
  * @return a node, or NULL if the span should be added as the tail
  */
-static inline node_t *list_seek(list_t *l, const memory_span_t *mem)
+static inline node_t *
+list_seek(list_t *l, const memory_span_t *mem, node_t **prev)
 {
-  assert(l && mem && "Invalid arguments to list_seek()");
-  if(l->head)
+  node_t *cur = l->root, *next = NULL;
+
+  assert(l && mem && prev && "Invalid arguments to list_seek()");
+  *prev = NULL;
+  while(cur)
   {
-    node_t *cur = l->head;
-    while(cur && cur->mem.low < mem->low) cur = cur->next;
-    return cur;
+    if(cur->mem.low < mem->low)
+    {
+      *prev = cur;
+      cur = cur->right;
+    }
+    else
+    {
+      next = cur;
+      cur = cur->left;
+    }
   }
-  else return NULL;
+  return next;
 }
 
 /*
- * Merge two nodes.  Merges b into a and returns the merged node.
- *
- * Note: a *must* be directly before b in sorted ordering in the list.
+ * Delete a node from the list & return its successor.
  *
- * @param a a linked list node
- * @param b a linked list node
- * @return the new merged node
+ * @param l a list
+ * @param n a node
+ * @return the node's successor in the list, or NULL if the node was the tail
  */
-static node_t *list_merge(list_t *l, node_t *a, node_t *b)
+static node_t *list_delete(list_t *l, node_t *n)
 {
-  assert(l && a && b &&
-         a->mem.low <= b->mem.low &&
-         a->next == b && b->prev == a &&
-         "Invalid arguments to node merge");
-
-  debug("Merging 0x%lx - 0x%lx and 0x%lx - 0x%lx to 0x%lx - 0x%lx\n",
-        a->mem.low, a->mem.high, b->mem.low, b->mem.high,
-        MIN(a->mem.low, b->mem.low), MAX(a->mem.high, b->mem.high));
-
-  a->mem.high = MAX(a->mem.high, b->mem.high);
-  a->next = b->next;
-  if(a->next) a->next->prev = a;
-  else l->tail = a; // b was the tail
-  node_free(l->cache, b);
+  node_t *next;
+
+  assert(l && n && "Invalid arguments to list_delete()");
+
+  debug("Deleting 0x%lx - 0x%lx\n", n->mem.low, n->mem.high);
+
+  next = tree_next(n);
+  l->root = tree_remove(l->root, n);
+  if(l->root) l->root->parent = NULL;
   l->size--;
-  return a;
+  node_free(l, n);
+  return next;
 }
 
 /*
- * Delete a node from the list & return its successor.
+ * Merge the successors of a node which overlap or are adjacent to it into the
+ * node.  Can merge an arbitrary number of times.
  *
  * @param l a list
  * @param n a node
- * @return the node's successor in the list, or NULL if the node was the tail
  */
-static node_t *list_delete(list_t *l, node_t *n)
+static void list_merge_next(list_t *l, node_t *n)
 {
-  node_t *prev, *next = NULL;
+  node_t *next = tree_next(n);
 
-  assert(l && n && "Invalid arguments to list_delete()");
+  while(next && list_check_merge(&n->mem, &next->mem))
+  {
+    debug("Merging 0x%lx - 0x%lx and 0x%lx - 0x%lx to 0x%lx - 0x%lx\n",
+          n->mem.low, n->mem.high, next->mem.low, next->mem.high,
+          n->mem.low, MAX(n->mem.high, next->mem.high));
 
-  debug("Deleting 0x%lx - 0x%lx\n", n->mem.low, n->mem.high);
+    n->mem.high = MAX(n->mem.high, next->mem.high);
+    next = list_delete(l, next);
+  }
+}
+
+/* Insert a span, assuming the list's lock is held. */
+static void list_insert_locked(list_t *l, const memory_span_t *mem)
+{
+  node_t *prev, *next, *n;
+
+  next = list_seek(l, mem, &prev);
+
+  // Merge with predecessor span; can merge at most once.  Extending the
+  // predecessor doesn't change its position in the list.
+  if(prev && list_check_merge(&prev->mem, mem))
+  {
+    if(prev->mem.high >= mem->high) return;
+    prev->mem.high = mem->high;
+    list_merge_next(l, prev);
+  }
 
-  if(l->size == 1)
+  // Merge with successor spans.  Re-use the first successor, as lowering its
+  // starting address doesn't change its position in the list either.
+  else if(next && list_check_merge(mem, &next->mem))
   {
-    l->head = l->tail = NULL;
-    l->size = 0;
+    next->mem.low = mem->low;
+    next->mem.high = MAX(next->mem.high, mem->high);
+    list_merge_next(l, next);
   }
   else
   {
-    if(n == l->head)
-    {
-      l->head = n->next;
-      l->head->prev = NULL;
-      next = l->head;
-    }
-    else if(n == l->tail)
-    {
-      l->tail = n->prev;
-      l->tail->next = NULL;
-    }
-    else
-    {
-      prev = n->prev;
-      next = n->next;
-      prev->next = next;
-      next->prev = prev;
-    }
-    l->size--;
+    n = node_create(l, mem);
+    l->root = tree_insert(l->root, n);
+    l->root->parent = NULL;
+    l->size++;
   }
-  node_free(l->cache, n);
-  return next;
+}
+
+/* Sort memory spans by their lowest address. */
+static int span_compare(const void *a, const void *b)
+{
+  const memory_span_t *sa = (const memory_span_t *)a,
+                      *sb = (const memory_span_t *)b;
+  if(sa->low < sb->low) return -1;
+  else if(sa->low > sb->low) return 1;
+  else return 0;
 }
 
 /* User-facing APIs */
@@ -287,16 +448,18 @@ void list_init(list_t *l, int nid)
 {
   pthread_mutexattr_t attr;
   assert(l && "Invalid list pointer");
+  l->root = l->free = NULL;
+  l->size = 0;
+  l->nid = nid;
 #ifndef _NOCACHE
   static size_t cur_cache = 0;
+  size_t i;
   assert(cur_cache < NUM_CACHE && "Initialized too many lists");
   l->cache = &cache[cur_cache++];
+  for(i = 0; i < NODE_CACHE_SIZE; i++) node_free(l, &l->cache->node[i]);
 #else
   l->cache = NULL;
 #endif
-  l->head = l->tail = NULL;
-  l->size = 0;
-  l->nid = nid;
   pthread_mutexattr_init(&attr);
   pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
   pthread_mutex_init(&l->lock, &attr);
@@ -311,86 +474,63 @@ size_t list_size(const list_t *l)
 
 void list_insert(list_t *l, const memory_span_t *mem)
 {
-  node_t *cur, *prev, *next, *n;
-
   assert(l && mem && "Invalid arguments to list_insert()");
   assert(mem->low < mem->high && "Invalid memory span");
 
   pthread_mutex_lock(&l->lock);
+  list_insert_locked(l, mem);
+  pthread_mutex_unlock(&l->lock);
+}
 
-  n = node_create(l->cache, mem, l->nid);
+void list_insert_bulk(list_t *l, memory_span_t *mem, size_t num)
+{
+  size_t i, merged;
+  node_t **nodes;
 
-  assert(n && "Invalid pointer returned by node_create()");
+  assert(l && (mem || !num) && "Invalid arguments to list_insert_bulk()");
+  if(!num) return;
 
-  if(!l->head)
+  // Sort & coalesce the spans so each is inserted at most once.  Compilers
+  // often generate spans in order, so avoid sorting if possible.
+  for(i = 1; i < num && mem[i - 1].low <= mem[i].low; i++);
+  if(i < num) qsort(mem, num, sizeof(memory_span_t), span_compare);
+  for(i = 1, merged = 0; i < num; i++)
   {
-    // First node in the list
-    l->head = l->tail = n;
-    l->size = 1;
-    n->prev = n->next = NULL;
+    assert(mem[i].low < mem[i].high && "Invalid memory span");
+    if(list_check_merge(&mem[merged], &mem[i]))
+      mem[merged].high = MAX(mem[merged].high, mem[i].high);
+    else mem[++merged] = mem[i];
   }
-  else
-  {
-    // Insert the node into the list
-    cur = list_seek(l, mem);
-    if(cur == l->head) // First element in the list
-    {
-      cur->prev = n;
-      n->next = cur;
-      n->prev = NULL;
-      l->head = n;
-    }
-    else if(!cur) // Last element in the list
-    {
-      cur = l->tail;
-      cur->next = n;
-      n->prev = cur;
-      n->next = NULL;
-      l->tail = n;
-    }
-    else // In the middle of the list
-    {
-      next = cur;
-      cur = cur->prev;
-      cur->next = n;
-      n->prev = cur;
-      next->prev = n;
-      n->next = next;
-    }
-    l->size++;
+  num = merged + 1;
 
-    // Merge with predecessor span; can merge at most once.
-    prev = n->prev;
-    if(prev && list_check_merge(&prev->mem, &n->mem))
-      n = list_merge(l, prev, n);
+  pthread_mutex_lock(&l->lock);
 
-    // Merge with successor spans; can merge an arbitrary number of times.
-    next = n->next;
-    while(next && list_check_merge(&n->mem, &next->mem))
-    {
-      n = list_merge(l, n, next);
-      next = n->next;
-    }
+  // Build the tree directly from the sorted spans if the list is empty
+  if(!l->root && (nodes = malloc(sizeof(node_t *) * num)))
+  {
+    for(i = 0; i < num; i++) nodes[i] = node_create(l, &mem[i]);
+    l->root = tree_build(nodes, num);
+    l->root->parent = NULL;
+    l->size = num;
+    free(nodes);
   }
+  else for(i = 0; i < num; i++) list_insert_locked(l, &mem[i]);
+
   pthread_mutex_unlock(&l->lock);
 }
 
 bool list_overlaps(list_t *l, const memory_span_t *mem)
 {
   bool overlaps = false;
-  node_t *next;
+  node_t *prev, *next;
 
   assert(l && mem && "Invalid arguments to list_overlaps()");
   assert(mem->low < mem->high && "Invalid memory span");
 
   pthread_mutex_lock(&l->lock);
-  if(l->head)
-  {
-    next = list_seek(l, mem);
-    if(!next) overlaps = list_check_overlap(&l->tail->mem, mem);
-    else overlaps = list_check_overlap(&next->prev->mem, mem) ||
-                    list_check_overlap(mem, &next->mem);
-  }
+  next = list_seek(l, mem, &prev);
+  overlaps = (prev && list_check_overlap(&prev->mem, mem)) ||
+             (next && list_check_overlap(mem, &next->mem));
   pthread_mutex_unlock(&l->lock);
 
   return overlaps;
@@ -399,65 +539,55 @@ bool list_overlaps(list_t *l, const memory_span_t *mem)
 void list_remove(list_t *l, const memory_span_t *mem)
 {
   node_t *cur, *prev;
-  memory_span_t cur_span, new_span;
+  memory_span_t new_span;
 
   assert(l && mem && "Invalid arguments to list_remove()");
   assert(mem->low < mem->high && "Invalid memory span");
 
   pthread_mutex_lock(&l->lock);
-  if(l->head)
+  cur = list_seek(l, mem, &prev);
+
+  // Remove overlapping region from predecessor; can split at most once.
+  // Note that by definition the predecessor will not be a subset of mem
+  // since it's lower bound *must* be before mem's lower bound.
+  if(prev && list_check_overlap(&prev->mem, mem))
   {
-    cur = list_seek(l, mem);
-
-    // Remove overlapping region from predecessor; can split at most once.
-    // Note that by definition the predecessor will not be a subset of mem
-    // since it's lower bound *must* be before mem's lower bound.
-    if(cur) prev = cur->prev;
-    else prev = l->tail;
-    if(prev && list_check_overlap(&prev->mem, mem))
+    if(prev->mem.high <= mem->high)
     {
-      if(prev->mem.high <= mem->high)
-      {
-        debug("Resizing 0x%lx - 0x%lx to 0x%lx - 0x%lx\n",
-              prev->mem.low, prev->mem.high, prev->mem.low, mem->low);
-
-        prev->mem.high = mem->low;
-      }
-      else
-      {
-        // The memory region being removed is a strict subset of prev -- split
-        // prev into two new nodes with mem removed.
-        debug("Replacing 0x%lx - 0x%lx with 0x%lx - 0x%lx & 0x%lx - 0x%lx\n",
-              prev->mem.low, prev->mem.high, prev->mem.low, mem->low,
-              mem->high, prev->mem.high);
-
-        cur_span = prev->mem;
-        list_delete(l, prev);
-
-        new_span.low = cur_span.low;
-        new_span.high = mem->low;
-        list_insert(l, &new_span);
-
-        new_span.low = mem->high;
-        new_span.high = cur_span.high;
-        list_insert(l, &new_span);
-      }
+      debug("Resizing 0x%lx - 0x%lx to 0x%lx - 0x%lx\n",
+            prev->mem.low, prev->mem.high, prev->mem.low, mem->low);
+
+      prev->mem.high = mem->low;
     }
+    else
+    {
+      // The memory region being removed is a strict subset of prev -- split
+      // prev into two nodes with mem removed.
+      debug("Replacing 0x%lx - 0x%lx with 0x%lx - 0x%lx & 0x%lx - 0x%lx\n",
+            prev->mem.low, prev->mem.high, prev->mem.low, mem->low,
+            mem->high, prev->mem.high);
+
+      new_span.low = mem->high;
+      new_span.high = prev->mem.high;
+      prev->mem.high = mem->low;
+      list_insert_locked(l, &new_span);
+    }
+  }
 
-    // Remove overlapping regions from successors; can split an arbitrary
-    // number of times.  Note that by definition mem will not be a strict
-    // subset of the successor since its lower bound *must* be less than or
-    // equal to the successor's lower bound.
-    while(cur && list_check_overlap(mem, &cur->mem))
+  // Remove overlapping regions from successors; can split an arbitrary
+  // number of times.  Note that by definition mem will not be a strict
+  // subset of the successor since its lower bound *must* be less than or
+  // equal to the successor's lower bound.
+  while(cur && list_check_overlap(mem, &cur->mem))
+  {
+    if(list_check_contained(mem, &cur->mem)) cur = list_delete(l, cur);
+    else
     {
-      if(list_check_contained(mem, &cur->mem)) cur = list_delete(l, cur);
-      else
-      {
-        debug("Resizing 0x%lx - 0x%lx to 0x%lx - 0x%lx\n",
-              cur->mem.low, cur->mem.high, mem->high, cur->mem.high);
-
-        cur->mem.low = mem->high;
-      }
+      debug("Resizing 0x%lx - 0x%lx to 0x%lx - 0x%lx\n",
+            cur->mem.low, cur->mem.high, mem->high, cur->mem.high);
+
+      cur->mem.low = mem->high;
+      break;
     }
   }
   pthread_mutex_unlock(&l->lock);
@@ -465,18 +595,9 @@ void list_remove(list_t *l, const memory_span_t *mem)
 
 void list_clear(list_t *l)
 {
-  node_t *cur, *next;
-
   pthread_mutex_lock(&l->lock);
-  cur = l->head;
-  while(cur)
-  {
-    next = cur->next;
-    node_free(l->cache, cur);
-    cur = next;
-  }
-  l->head = NULL;
-  l->tail = NULL;
+  tree_free(l, l->root);
+  l->root = NULL;
   l->size = 0;
   pthread_mutex_unlock(&l->lock);
 }
@@ -493,11 +614,11 @@ void list_atomic_end(list_t *l) {
 
 const node_t *list_begin(list_t *l) {
   assert(l && "Invalid arguments to list_begin()");
-  return l->head;
+  return tree_first(l->root);
 }
 
 const node_t *list_next(const node_t *n) {
-  if(n) return n->next;
+  if(n) return tree_next(n);
   else return NULL;
 }
 
@@ -510,18 +631,13 @@ const memory_span_t *list_get_span(const node_t *n) {
 
 void list_print(list_t *l)
 {
-  node_t *cur;
+  const node_t *cur;
 
   assert(l && "Invalid arguments to list_print()");
 
   pthread_mutex_lock(&l->lock);
   printf("List for node %d (%p) contains %lu span(s)\n", l->nid, l, l->size);
-  cur = l->head;
-  while(cur)
-  {
+  for(cur = list_begin(l); cur; cur = list_next(cur))
     printf("  0x%lu - 0x%lu\n", cur->mem.low, cur->mem.high);
-    cur = cur->next;
-  }
   pthread_mutex_unlock(&l->lock);
 }
-
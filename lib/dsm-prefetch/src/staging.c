@@ -0,0 +1,172 @@
+/*
+ * Per-thread staging buffers for prefetch requests.
+ *
+ * Each thread has a single-producer ring buffer per node to which it queues
+ * requests.  Rings are consumed by whichever thread merges them into the
+ * node's request lists, which requires holding the lists' locks, so there's
+ * only ever one consumer at a time.  Rings are never freed; when a thread
+ * exits its rings (and any requests still staged in them) are adopted by the
+ * next thread to queue requests for the node.
+ *
+ * Date: 10/16/2026
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <assert.h>
+
+#include "platform.h"
+#include "staging.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Definitions & declarations
+///////////////////////////////////////////////////////////////////////////////
+
+/* A staged prefetch request. */
+typedef struct {
+  memory_span_t mem;
+  access_type_t type;
+} staged_span_t;
+
+/*
+ * A ring buffer of staged requests.  The producer only writes the tail & the
+ * consumer only writes the head, so they're kept on separate cache lines.
+ */
+typedef struct staging_t {
+  staged_span_t span[STAGING_SPANS];
+  size_t head;
+  char padding1[64 - sizeof(size_t)];
+  size_t tail;
+  char padding2[64 - sizeof(size_t)];
+  bool owned;
+  struct staging_t *next;
+} staging_t;
+
+/* All rings for each node, including those of exited threads. */
+static staging_t *rings[MAX_POPCORN_NODES];
+
+/* The calling thread's rings, released at thread exit. */
+static __thread staging_t *my_rings[MAX_POPCORN_NODES];
+static pthread_key_t rings_key;
+static pthread_once_t rings_once = PTHREAD_ONCE_INIT;
+
+///////////////////////////////////////////////////////////////////////////////
+// Ring management
+///////////////////////////////////////////////////////////////////////////////
+
+/* Release a thread's rings for adoption by other threads. */
+static void release_rings(void *arg)
+{
+  staging_t **mine = (staging_t **)arg;
+  size_t i;
+
+  for(i = 0; i < MAX_POPCORN_NODES; i++)
+  {
+    if(!mine[i]) continue;
+    __atomic_store_n(&mine[i]->owned, false, __ATOMIC_RELEASE);
+    mine[i] = NULL;
+  }
+}
+
+static void create_rings_key(void)
+{
+  if(pthread_key_create(&rings_key, release_rings))
+    warn("Could not create key for releasing staging buffers\n");
+}
+
+/* Adopt a released ring for a node, or allocate & register a new one. */
+static staging_t *get_ring(int nid)
+{
+  staging_t *ring;
+  bool owned;
+
+  pthread_once(&rings_once, create_rings_key);
+
+  ring = __atomic_load_n(&rings[nid], __ATOMIC_ACQUIRE);
+  for(; ring; ring = ring->next)
+  {
+    owned = false;
+    if(__atomic_compare_exchange_n(&ring->owned, &owned, true, false,
+                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      break;
+  }
+
+  if(!ring)
+  {
+    if(!(ring = popcorn_malloc(sizeof(staging_t), nid))) return NULL;
+    ring->head = ring->tail = 0;
+    ring->owned = true;
+    ring->next = __atomic_load_n(&rings[nid], __ATOMIC_RELAXED);
+    while(!__atomic_compare_exchange_n(&rings[nid], &ring->next, ring, true,
+                                       __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+  }
+
+  my_rings[nid] = ring;
+  pthread_setspecific(rings_key, my_rings);
+  return ring;
+}
+
+/* Merge a ring's staged requests into the lists. */
+static void drain_ring(staging_t *ring,
+                       list_t *read,
+                       list_t *write,
+                       list_t *release)
+{
+  size_t head = ring->head,
+         tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  const staged_span_t *staged;
+
+  for(; head != tail; head++)
+  {
+    staged = &ring->span[head % STAGING_SPANS];
+    switch(staged->type)
+    {
+    case READ: list_insert(read, &staged->mem); break;
+    case WRITE: list_insert(write, &staged->mem); break;
+    case RELEASE: list_insert(release, &staged->mem); break;
+    default: assert(false && "Unknown access type"); break;
+    }
+  }
+  __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Staging APIs
+///////////////////////////////////////////////////////////////////////////////
+
+bool staging_push(int nid, access_type_t type, const memory_span_t *mem)
+{
+  staging_t *ring = my_rings[nid];
+  staged_span_t *staged;
+  size_t tail;
+
+  if(!ring && !(ring = get_ring(nid))) return false;
+
+  tail = ring->tail;
+  if(tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == STAGING_SPANS)
+    return false;
+
+  staged = &ring->span[tail % STAGING_SPANS];
+  staged->mem = *mem;
+  staged->type = type;
+  __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+void staging_drain(int nid,
+                   bool all,
+                   list_t *read,
+                   list_t *write,
+                   list_t *release)
+{
+  staging_t *ring;
+
+  if(!all)
+  {
+    if(my_rings[nid]) drain_ring(my_rings[nid], read, write, release);
+    return;
+  }
+
+  ring = __atomic_load_n(&rings[nid], __ATOMIC_ACQUIRE);
+  for(; ring; ring = ring->next) drain_ring(ring, read, write, release);
+}
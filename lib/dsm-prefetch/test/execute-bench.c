@@ -0,0 +1,71 @@
+/*
+ * Benchmark executing a fragmented set of prefetch requests.  Queues every
+ * other page of a buffer for reading & writing on the current node and
+ * reports the time to execute them.  Set POPCORN_PREFETCH_PER_SPAN to compare
+ * against submitting one madvise() per span, set POPCORN_PREFETCH_READ_GAP &
+ * POPCORN_PREFETCH_WRITE_GAP to 1 to fill the holes between spans, and build
+ * with type=statistics to report the number of system calls & requests saved.
+ *
+ * Usage: ./execute-bench [spans] [iterations]
+ *
+ * Date: 10/16/2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "dsm-prefetch.h"
+#include "platform.h"
+
+static size_t num_spans = 10000;
+static size_t iterations = 10;
+
+static inline unsigned long elapsed(struct timespec *start,
+                                    struct timespec *end)
+{
+  return (end->tv_sec * 1000000000 + end->tv_nsec) -
+         (start->tv_sec * 1000000000 + start->tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+  struct timespec start, end;
+  unsigned long time = 0;
+  size_t i, iter, executed = 0;
+  access_type_t type;
+  char *buf;
+
+  if(argc > 1) num_spans = strtoul(argv[1], NULL, 10);
+  if(argc > 2) iterations = strtoul(argv[2], NULL, 10);
+  if(num_spans < 1) num_spans = 1;
+
+  buf = mmap(NULL, num_spans * 2 * PAGESZ, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(buf == MAP_FAILED)
+  {
+    perror("Could not allocate buffer");
+    return 1;
+  }
+  for(i = 0; i < num_spans * 2; i++) buf[i * PAGESZ] = 1;
+
+  for(iter = 0; iter < iterations; iter++)
+  {
+    type = iter % 2 ? WRITE : READ;
+    for(i = 0; i < num_spans; i++)
+      popcorn_prefetch(type, &buf[i * 2 * PAGESZ], &buf[(i * 2 + 1) * PAGESZ]);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    executed += popcorn_prefetch_execute();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    time += elapsed(&start, &end);
+  }
+
+  printf("Executed %lu spans in %lu iterations: %.1f ns/span\n",
+         executed, iterations, executed ? (double)time / executed : 0.0);
+
+  munmap(buf, num_spans * 2 * PAGESZ);
+  return executed != num_spans * iterations;
+}
@@ -0,0 +1,110 @@
+/*
+ * Benchmark queueing large numbers of prefetch requests, both one span at a
+ * time & in bulk.  Queues random spans (1 - 4 pages scattered across a 4GB
+ * range, so few merge) and strided spans (every other page, in ascending
+ * order).  The spans are only queued, never prefetched -- requests are queued
+ * for a node on which the benchmark isn't running, so executing them simply
+ * discards them.
+ *
+ * Usage: ./queue-bench [spans] [node]
+ *
+ * Date: 10/16/2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "dsm-prefetch.h"
+#include "platform.h"
+
+/* Base of the (never accessed) address range in which spans are generated. */
+#define BASE 0x100000000000UL
+#define RANGE_PAGES (1UL << 20)
+
+static size_t num_spans = 100000;
+static int nid = 1;
+
+static inline unsigned long elapsed(struct timespec *start,
+                                    struct timespec *end)
+{
+  return (end->tv_sec * 1000000000 + end->tv_nsec) -
+         (start->tv_sec * 1000000000 + start->tv_nsec);
+}
+
+static void gen_random(prefetch_span_t *spans)
+{
+  size_t i;
+  uint64_t page;
+
+  srand(1);
+  for(i = 0; i < num_spans; i++)
+  {
+    page = ((uint64_t)rand() * RAND_MAX + rand()) % RANGE_PAGES;
+    spans[i].low = (const void *)(BASE + page * PAGESZ);
+    spans[i].high = (const void *)(BASE + (page + 1 + rand() % 4) * PAGESZ);
+  }
+}
+
+static void gen_strided(prefetch_span_t *spans)
+{
+  size_t i;
+
+  for(i = 0; i < num_spans; i++)
+  {
+    spans[i].low = (const void *)(BASE + i * 2 * PAGESZ);
+    spans[i].high = (const void *)(BASE + (i * 2 + 1) * PAGESZ);
+  }
+}
+
+/* Queue spans one at a time or in bulk, and report the time per span. */
+static void run(const char *name, const prefetch_span_t *spans, int bulk)
+{
+  struct timespec start, end;
+  size_t i, queued;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if(bulk) popcorn_prefetch_node_bulk(nid, READ, spans, num_spans);
+  else
+  {
+    for(i = 0; i < num_spans; i++)
+      popcorn_prefetch_node(nid, READ, spans[i].low, spans[i].high);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  queued = popcorn_prefetch_num_requests(nid, READ);
+  printf("%-8s %-10s %8lu spans -> %8lu requests: %8.1f ns/span\n",
+         name, bulk ? "bulk" : "individual", num_spans, queued,
+         (double)elapsed(&start, &end) / num_spans);
+
+  popcorn_prefetch_execute_node(nid);
+}
+
+int main(int argc, char **argv)
+{
+  prefetch_span_t *random, *strided;
+
+  if(argc > 1) num_spans = strtoul(argv[1], NULL, 10);
+  if(argc > 2) nid = atoi(argv[2]);
+  if(num_spans < 1) num_spans = 1;
+
+  random = malloc(sizeof(prefetch_span_t) * num_spans);
+  strided = malloc(sizeof(prefetch_span_t) * num_spans);
+  if(!random || !strided)
+  {
+    fprintf(stderr, "Could not allocate spans\n");
+    return 1;
+  }
+  gen_random(random);
+  gen_strided(strided);
+
+  run("random", random, 0);
+  run("random", random, 1);
+  run("strided", strided, 0);
+  run("strided", strided, 1);
+
+  free(strided);
+  free(random);
+  return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Benchmark the throughput of concurrently queueing prefetch requests.  For
+ * 1, 2, 4, ..., up to the maximum number of threads, each thread queues its
+ * own strided spans (every other page in a disjoint range) for a node on
+ * which the benchmark isn't running, and the aggregate number of spans queued
+ * per second is reported.  Requests are merged & discarded after each run.
+ *
+ * Usage: ./queue-scaling [spans per thread] [max threads] [node]
+ *
+ * Date: 10/16/2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "dsm-prefetch.h"
+#include "platform.h"
+
+/* Base of the (never accessed) address range in which spans are generated. */
+#define BASE 0x100000000000UL
+
+static size_t num_spans = 100000;
+static size_t max_threads = 64;
+static int nid = 1;
+static pthread_barrier_t barrier;
+
+static inline unsigned long elapsed(struct timespec *start,
+                                    struct timespec *end)
+{
+  return (end->tv_sec * 1000000000 + end->tv_nsec) -
+         (start->tv_sec * 1000000000 + start->tv_nsec);
+}
+
+static void *queue_spans(void *arg)
+{
+  uint64_t base = BASE + (uint64_t)arg * num_spans * 2 * PAGESZ;
+  size_t i;
+
+  pthread_barrier_wait(&barrier);
+  for(i = 0; i < num_spans; i++)
+    popcorn_prefetch_node(nid, READ,
+                          (const void *)(base + i * 2 * PAGESZ),
+                          (const void *)(base + (i * 2 + 1) * PAGESZ));
+  pthread_barrier_wait(&barrier);
+  return NULL;
+}
+
+static int run(size_t num_threads)
+{
+  pthread_t threads[num_threads];
+  struct timespec start, end;
+  size_t i, queued;
+
+  if(pthread_barrier_init(&barrier, NULL, num_threads + 1)) return 1;
+  for(i = 0; i < num_threads; i++)
+  {
+    if(pthread_create(&threads[i], NULL, queue_spans, (void *)i))
+    {
+      fprintf(stderr, "Could not create thread %lu\n", i);
+      exit(1);
+    }
+  }
+
+  pthread_barrier_wait(&barrier);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pthread_barrier_wait(&barrier);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  for(i = 0; i < num_threads; i++) pthread_join(threads[i], NULL);
+  pthread_barrier_destroy(&barrier);
+
+  queued = popcorn_prefetch_num_requests(nid, READ);
+  printf("%3lu threads: %10lu spans -> %10lu requests: %12.0f spans/s\n",
+         num_threads, num_threads * num_spans, queued,
+         (double)(num_threads * num_spans) * 1e9 / elapsed(&start, &end));
+
+  popcorn_prefetch_execute_node(nid);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  size_t num_threads;
+
+  if(argc > 1) num_spans = strtoul(argv[1], NULL, 10);
+  if(argc > 2) max_threads = strtoul(argv[2], NULL, 10);
+  if(argc > 3) nid = atoi(argv[3]);
+  if(num_spans < 1) num_spans = 1;
+  if(max_threads < 1) max_threads = 1;
+
+  for(num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+    if(run(num_threads)) return 1;
+
+  return 0;
+}
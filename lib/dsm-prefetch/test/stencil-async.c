@@ -0,0 +1,158 @@
+/*
+ * Double-buffered 2D Jacobi stencil which prefetches each block of rows before
+ * computing it.  Compares prefetching synchronously before computing each
+ * block against prefetching the next block asynchronously while computing the
+ * current one, and checks both produce the same result.
+ *
+ * Usage: ./stencil-async [rows] [columns] [rows per block] [iterations]
+ *
+ * Date: 10/16/2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "dsm-prefetch.h"
+
+static size_t rows = 4096, cols = 4096, block = 256, iterations = 10;
+
+static inline unsigned long elapsed(struct timespec *start,
+                                    struct timespec *end)
+{
+  return (end->tv_sec * 1000000000 + end->tv_nsec) -
+         (start->tv_sec * 1000000000 + start->tv_nsec);
+}
+
+static void init(double *grid)
+{
+  size_t i;
+  for(i = 0; i < rows * cols; i++) grid[i] = (double)(i % 17);
+}
+
+/* Queue requests for the rows (& halo) read & written by a block. */
+static void prefetch_block(const double *src, double *dst, size_t first)
+{
+  size_t last = first + block < rows - 1 ? first + block : rows - 1;
+  popcorn_prefetch(READ, &src[(first - 1) * cols], &src[(last + 1) * cols]);
+  popcorn_prefetch(WRITE, &dst[first * cols], &dst[last * cols]);
+}
+
+static void compute_block(const double *src, double *dst, size_t first)
+{
+  size_t last = first + block < rows - 1 ? first + block : rows - 1, i, j;
+  for(i = first; i < last; i++)
+    for(j = 1; j < cols - 1; j++)
+      dst[i * cols + j] = 0.25 * (src[(i - 1) * cols + j] +
+                                  src[(i + 1) * cols + j] +
+                                  src[i * cols + j - 1] +
+                                  src[i * cols + j + 1]);
+}
+
+/* Run the stencil, returning the grid holding the result. */
+static double *run(double *a, double *b, int async, unsigned long *wait)
+{
+  struct timespec start, end;
+  prefetch_token_t token;
+  size_t iter, first;
+  double *src = a, *dst = b, *tmp;
+
+  *wait = 0;
+  for(iter = 0; iter < iterations; iter++)
+  {
+    if(async)
+    {
+      prefetch_block(src, dst, 1);
+      token = popcorn_prefetch_execute_async();
+    }
+
+    for(first = 1; first < rows - 1; first += block)
+    {
+      if(async)
+      {
+        // Wait for this block's data, then overlap prefetching the next block
+        // with computing this one.
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        popcorn_prefetch_wait(token);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        *wait += elapsed(&start, &end);
+
+        if(first + block < rows - 1)
+        {
+          prefetch_block(src, dst, first + block);
+          token = popcorn_prefetch_execute_async();
+        }
+      }
+      else
+      {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        prefetch_block(src, dst, first);
+        popcorn_prefetch_execute();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        *wait += elapsed(&start, &end);
+      }
+
+      compute_block(src, dst, first);
+    }
+
+    tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  return src;
+}
+
+int main(int argc, char **argv)
+{
+  struct timespec start, end;
+  unsigned long sync_time, async_time, sync_wait, async_wait;
+  double *a, *b, *sync_result, *async_result;
+  int ret;
+
+  if(argc > 1) rows = strtoul(argv[1], NULL, 10);
+  if(argc > 2) cols = strtoul(argv[2], NULL, 10);
+  if(argc > 3) block = strtoul(argv[3], NULL, 10);
+  if(argc > 4) iterations = strtoul(argv[4], NULL, 10);
+  if(rows < 3) rows = 3;
+  if(cols < 3) cols = 3;
+  if(block < 1) block = 1;
+
+  a = malloc(sizeof(double) * rows * cols);
+  b = malloc(sizeof(double) * rows * cols);
+  sync_result = malloc(sizeof(double) * rows * cols);
+  if(!a || !b || !sync_result)
+  {
+    fprintf(stderr, "Could not allocate grids\n");
+    return 1;
+  }
+
+  init(a);
+  init(b);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  memcpy(sync_result, run(a, b, 0, &sync_wait),
+         sizeof(double) * rows * cols);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  sync_time = elapsed(&start, &end);
+
+  init(a);
+  init(b);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  async_result = run(a, b, 1, &async_wait);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  async_time = elapsed(&start, &end);
+
+  printf("Synchronous:  %10.3f ms total, %10.3f ms prefetching\n",
+         sync_time / 1e6, sync_wait / 1e6);
+  printf("Asynchronous: %10.3f ms total, %10.3f ms waiting on prefetches\n",
+         async_time / 1e6, async_wait / 1e6);
+
+  ret = memcmp(sync_result, async_result, sizeof(double) * rows * cols);
+  if(ret) printf("ERROR: asynchronous result differs\n");
+
+  free(sync_result);
+  free(b);
+  free(a);
+  return ret != 0;
+}
@@ -10,6 +10,7 @@
 #include <assert.h>
 #include <float.h>
 #include "hierarchy.h"
+#include "migrate.h"
 
 global_info_t ALIGN_PAGE popcorn_global;
 node_info_t ALIGN_PAGE popcorn_node[MAX_POPCORN_NODES];
@@ -1219,6 +1220,7 @@ static void calc_het_probe_workshare(int nid, bool ull, workshare_csr_t *csr)
   popcorn_global.workshare_time[nid] =
     MAX(popcorn_node[nid].workshare_time /
         popcorn_global.threads_per_node[nid], 1);
+  migrate_report_workshare(nid, popcorn_global.workshare_time[nid]);
   popcorn_get_page_faults(&sent, &recv);
   popcorn_global.page_faults[nid] = sent - popcorn_node[nid].page_faults;
 
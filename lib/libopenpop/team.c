@@ -144,7 +144,7 @@ gomp_thread_start (void *xdata)
 
 	  if (popcorn_distributed ())
             {
-              if (thr->popcorn_nid != popcorn_getnid())
+              if (thr->popcorn_nid != current_nid ())
 	        migrate(thr->popcorn_nid, NULL, NULL);
               if (thr->popcorn_nid != 0)
                 hierarchy_init_thread(thr->popcorn_nid);
@@ -51,8 +51,59 @@
 #if _SIG_MIGRATION == 1
 # include <signal.h>
 # define MIGRATE_SIGNAL SIGRTMIN
+
+/*
+ * Migration requests are delivered as the signal's value, with the
+ * destination node in the low 16 bits & the reason in the upper bits.
+ */
+# define REQUEST_VALUE( nid, reason ) (((reason) << 16) | ((nid) & 0xffff))
+# define REQUEST_NID( value ) ((value) & 0xffff)
+# define REQUEST_REASON( value ) (((value) >> 16) & 0x7fff)
+# define REQUEST_MAX_REASON 0x7fff
+
+/*
+ * Number of distinct reasons counted in response time statistics; larger
+ * reasons are counted with the last one.
+ */
+# define MAX_MIGRATE_REASONS 16
+
+/*
+ * Maximum number of migration points for which response times are tracked
+ * separately; responses at additional points are counted together.
+ */
+# define MAX_MIGRATION_SITES 512
+
+/* Environment variable naming a file to which to dump response times. */
+# define ENV_RESPONSE_FILE "MIGRATE_RESPONSE_FILE"
 #endif
 
+/*
+ * Without signal-triggered migration, the scheduler proposes migrations
+ * through the kernel.  Migration points re-read the thread's status from the
+ * kernel at most once per period (in nanoseconds), which bounds how long a
+ * proposal can go unnoticed; zero re-reads it at every migration point.
+ */
+#ifndef STATUS_REFRESH_NS
+#define STATUS_REFRESH_NS 1000000UL
+#endif
+
+/*
+ * Users can tell the runtime the name of the file containing the thread
+ * schedule by setting the POPCORN_THREAD_SCHEDULE environment variable.
+ * Otherwise, the runtime will look for the file DEF_THREAD_SCHEDULE.
+ */
+#define DEF_THREAD_SCHEDULE "thread-schedule.txt"
+#define ENV_POPCORN_THREAD_SCHEDULE "POPCORN_THREAD_SCHEDULE"
+
+/*
+ * Setting POPCORN_THREAD_SCHEDULE_RELOAD enables reloading the thread schedule
+ * while running, when RELOAD_SCHEDULE_SIGNAL is received or (if set to a
+ * non-zero number of milliseconds) when the file's modification time changes,
+ * checked at most once per period.
+ */
+#define ENV_POPCORN_THREAD_SCHEDULE_RELOAD "POPCORN_THREAD_SCHEDULE_RELOAD"
+#define RELOAD_SCHEDULE_SIGNAL SIGHUP
+
 /* Dump verbose migration information to a log file. */
 #define _LOG 0
 #define LOG_FILE "/tmp/migrate.log"
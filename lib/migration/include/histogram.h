@@ -0,0 +1,62 @@
+/*
+ * Lock-free log-bucketed (HDR-style) latency histograms.  Each power-of-two
+ * range of values is divided into HIST_SUB_BUCKETS linear sub-buckets, so
+ * recorded values keep a bounded relative error regardless of magnitude.
+ * Values above the largest bucket are counted in it, so samples are never
+ * dropped.  Histograms may be updated concurrently by any number of threads.
+ *
+ * Date: 10/16/2026
+ */
+
+#ifndef _HISTOGRAM_H
+#define _HISTOGRAM_H
+
+#include <stdio.h>
+
+/* Number of linear sub-buckets per power of two (as a power of two). */
+#define HIST_SUB_BITS 4
+#define HIST_SUB_BUCKETS (1UL << HIST_SUB_BITS)
+
+/* Number of powers of two tracked; larger values go in the last bucket. */
+#define HIST_MAGNITUDES 40
+
+#define HIST_BUCKETS ((HIST_MAGNITUDES + 1) * HIST_SUB_BUCKETS)
+
+struct histogram
+{
+  unsigned long count;
+  unsigned long long sum;
+  unsigned long long max;
+  unsigned long buckets[HIST_BUCKETS];
+};
+
+/*
+ * Record a value in a histogram.
+ *
+ * @param hist the histogram
+ * @param value the value
+ */
+void hist_record(struct histogram *hist, unsigned long long value);
+
+/*
+ * Get the value at or below which a fraction of the recorded values lie.
+ * Reports the highest value equivalent to (i.e., in the same bucket as) the
+ * percentile's value.
+ *
+ * @param hist the histogram
+ * @param fraction the fraction of values, e.g., 0.99 for the 99th percentile
+ * @return the value at the percentile, or 0 if no values were recorded
+ */
+unsigned long long hist_percentile(const struct histogram *hist,
+                                   double fraction);
+
+/*
+ * Print a histogram's summary statistics (count, mean, p50, p99, p999 & max)
+ * on a single line.
+ *
+ * @param hist the histogram
+ * @param fp the stream to which to print
+ */
+void hist_print_summary(const struct histogram *hist, FILE *fp);
+
+#endif /* _HISTOGRAM_H */
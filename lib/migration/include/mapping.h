@@ -6,6 +6,41 @@
 #define _MAPPING_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Binary thread schedule format, generated from text schedules by
+ * util/convert-schedule.py.  All fields are little-endian.  A header is
+ * followed by a hash table of regions (indexed by schedule_hash(), with
+ * collisions resolved by linear probing) and the node mappings for all
+ * regions:
+ *
+ *   struct schedule_header
+ *   struct schedule_slot[num_slots]
+ *   int32_t nodes[num_nodes]
+ */
+#define SCHEDULE_MAGIC "POPSCHED"
+#define SCHEDULE_VERSION 1
+#define SCHEDULE_EMPTY UINT32_MAX
+
+struct schedule_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_slots; // Number of hash table slots, a power of two >= 2
+  uint64_t num_nodes; // Total number of node mappings
+};
+
+struct schedule_slot {
+  uint64_t region; // The application region number
+  uint32_t first; // Index of region's first mapping, or SCHEDULE_EMPTY
+  uint32_t num; // The number of node mappings for this region
+};
+
+/* Get the hash table slot at which to start searching for a region. */
+static inline size_t schedule_hash(uint64_t region, uint32_t num_slots)
+{
+  return (region * 0x9e3779b97f4a7c15ULL) >> (64 - __builtin_ctz(num_slots));
+}
 
 /* The default node on which to execute if no thread schedule is available. */
 void set_default_node(int node);
@@ -20,4 +55,3 @@ void set_default_node(int node);
 int get_node_mapping(size_t region, int ptid);
 
 #endif /* _MAPPING_H */
-
@@ -5,10 +5,61 @@
 # error Unknown/unsupported architecture!
 #endif
 
+#include <pthread.h>
+#include <sys/types.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * A team of threads which migrate together.  Members rewrite their stacks in
+ * parallel and wait for each other before migrating, so either all members
+ * migrate or, if any member could not prepare for migration, none of them do.
+ * Should be treated as opaque & only accessed through the migrate_team*()
+ * functions.
+ */
+struct migrate_team {
+  pthread_mutex_t lock;
+  pthread_cond_t done;
+  int size;
+  int arrived;
+  int failed;
+  int proceed;
+  unsigned long round;
+};
+
+/** Maximum number of nodes, must match the platform's MAX_POPCORN_NODES. */
+#define MIGRATE_MAX_NODES 32
+
+/**
+ * Metrics describing a thread at a migration point, passed to migration
+ * policies.  Times are in nanoseconds; zero means unknown.
+ */
+struct migrate_metrics {
+  int current_nid;        /* node on which the thread is executing */
+  int proposed_nid;       /* node proposed by the scheduler, or -1 if none */
+  unsigned long available; /* bitmask of nodes available as destinations */
+  void *site;             /* the migration point */
+  unsigned long long since_point; /* time since the thread's previous point */
+  unsigned long long points; /* points reached since the thread migrated */
+  unsigned long long fault_rate; /* DSM page faults/second on current node */
+  unsigned long long migration_ns; /* estimated cost of migrating */
+  /* Relative time for each node to complete the same amount of work, as
+     measured by work-sharing runtimes (see migrate_report_workshare()). */
+  unsigned long long work_time[MIGRATE_MAX_NODES];
+};
+
+/**
+ * A migration policy, consulted at migration points to choose a node.
+ */
+struct migrate_policy {
+  const char *name;
+  /* Return the node to which the thread should migrate, or -1 to stay. */
+  int (*decide)(const struct migrate_metrics *metrics, void *data);
+  void *data;
+};
+
 /**
  * Return whether a node is available as a migration target.
  * @param nid the node ID
@@ -67,6 +118,101 @@ void migrate_schedule(size_t region,
                       void (*callback)(void*),
                       void *callback_data);
 
+/**
+ * Request that a single thread migrate to a node, without disturbing other
+ * threads.  The thread migrates when it next reaches a migration point.  Only
+ * supported if the library was built with signal-triggered migration.
+ *
+ * @param tid the thread's kernel thread ID
+ * @param nid the node to which the thread should migrate
+ * @param reason a requester-defined reason for the migration (0 - 32767),
+ *               recorded in response time statistics
+ * @return zero if the request was delivered, or an error number otherwise
+ */
+int migrate_request(pid_t tid, int nid, int reason);
+
+/**
+ * Dump statistics about the time between when threads are requested to
+ * migrate & when they enter the migration library, by migration point & by
+ * thread.  Only supported if the library was built with signal-triggered
+ * migration & response timing; statistics are also dumped at exit, to the file
+ * named by the MIGRATE_RESPONSE_FILE environment variable if set.
+ *
+ * @param fn the file to which to write, or NULL to write to standard output
+ * @return zero if the statistics were dumped, or an error number otherwise
+ */
+int migrate_dump_response_times(const char *fn);
+
+/**
+ * Initialize a team of threads which migrate together, and load the metadata
+ * needed to migrate to any available node so members don't contend on loading
+ * it when they migrate.  Should be called by the team's leader before any
+ * member calls migrate_team().
+ *
+ * @param team the team
+ * @param size the number of threads in the team
+ * @return zero if the team was initialized, or non-zero otherwise
+ */
+int migrate_team_init(struct migrate_team *team, int size);
+
+/**
+ * Release a team's resources.  No member may be migrating.
+ *
+ * @param team the team
+ */
+void migrate_team_destroy(struct migrate_team *team);
+
+/**
+ * Migrate thread together with the rest of its team.  Must be called by every
+ * member of the team (including members which are already on the destination
+ * node or won't migrate), as members wait for each other to finish rewriting
+ * their stacks before migrating.  If any member can't migrate, no members
+ * migrate.  The optional callback function will be invoked before execution
+ * resumes on destination architecture.
+ *
+ * @param team the team
+ * @param nid the node to which this thread should migrate
+ * @param callback a callback function to be invoked before execution resumes
+ *                 on destination architecture
+ * @param callback_data data to be passed to the callback function
+ */
+void migrate_team(struct migrate_team *team,
+                  int nid,
+                  void (*callback)(void*),
+                  void *callback_data);
+
+/**
+ * Built-in migration policies.  The proposal policy migrates threads to the
+ * node proposed by the scheduler, which is the default behavior.  The cost
+ * model policy migrates threads to the node with the lowest estimated time to
+ * reach the next migration point, including the cost of migrating & of DSM
+ * page faults, unless the scheduler has proposed a node.
+ */
+extern const struct migrate_policy migrate_policy_proposal;
+extern const struct migrate_policy migrate_policy_cost_model;
+
+/**
+ * Set the policy consulted by check_migrate() for all threads.  The policy
+ * can also be selected by name with the MIGRATE_POLICY environment variable.
+ * If the MIGRATE_POLICY_TRACE environment variable names a file, each
+ * decision & the metrics on which it was based are recorded there for replay
+ * by util/policy-replay.
+ *
+ * @param policy the policy, or NULL to only follow the scheduler's proposals
+ *               without collecting metrics
+ */
+void migrate_set_policy(const struct migrate_policy *policy);
+
+/**
+ * Report the time a node took to complete a unit of work, e.g., a work-sharing
+ * runtime's probing period.  Only ratios between nodes are meaningful, so
+ * reports must be in consistent units.
+ *
+ * @param nid the node
+ * @param time the time to complete the work
+ */
+void migrate_report_workshare(int nid, unsigned long long time);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,75 @@
+/*
+ * Migration policy engine.  Collects metrics about threads at migration
+ * points, consults the configured policy & optionally records decisions in a
+ * trace for offline replay.
+ *
+ * Date: 10/16/2026
+ */
+
+#ifndef _POLICY_H
+#define _POLICY_H
+
+#include <stdint.h>
+#include "migrate.h"
+
+/* Environment variables selecting the policy, trace file & migration cost. */
+#define ENV_MIGRATE_POLICY "MIGRATE_POLICY"
+#define ENV_MIGRATE_POLICY_TRACE "MIGRATE_POLICY_TRACE"
+#define ENV_MIGRATE_POLICY_MIGRATION_NS "MIGRATE_POLICY_MIGRATION_NS"
+
+/* Minimum time between reading DSM page fault counts, in nanoseconds. */
+#define POLICY_SAMPLE_NS 10000000ULL
+
+/* Default estimated cost of migrating a thread, in nanoseconds. */
+#define POLICY_MIGRATION_NS 1000000ULL
+
+/*
+ * Cost model parameters.  Migrating must be estimated to save at least
+ * COST_MODEL_MARGIN percent over COST_MODEL_HORIZON intervals between
+ * migration points (the thread's previous interval is used as the estimate of
+ * those to come).  Migrating leaves the thread's working set behind; it's
+ * estimated to take as many faults, each costing COST_MODEL_FAULT_NS, as the
+ * node took in the previous interval.  Threads must reach COST_MODEL_MIN_POINTS
+ * migration points after migrating before migrating again, to avoid bouncing
+ * between nodes.
+ */
+#define COST_MODEL_HORIZON 8
+#define COST_MODEL_MARGIN 10
+#define COST_MODEL_FAULT_NS 50000ULL
+#define COST_MODEL_MIN_POINTS 4
+
+/* Policy trace format, written by the engine & read by util/policy-replay. */
+#define POLICY_TRACE_MAGIC "POPTRACE"
+#define POLICY_TRACE_VERSION 1
+
+struct policy_trace_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size; /* size of each record, to detect mismatches */
+};
+
+struct policy_trace_record
+{
+  uint64_t timestamp; /* when the decision was made */
+  uint32_t tid; /* kernel thread ID of the thread */
+  int32_t decision; /* the node chosen by the policy, or -1 */
+  struct migrate_metrics metrics;
+};
+
+/*
+ * Decide to which node the calling thread should migrate at a migration
+ * point.  If no policy is set, follows the scheduler's proposal.
+ *
+ * @param site the migration point
+ * @return the node to which to migrate, or -1 to stay
+ */
+int policy_decide(void *site);
+
+/*
+ * Reset the calling thread's metrics after it migrates, as times measured on
+ * different nodes can't be compared.
+ */
+void policy_migrated(void);
+
+#endif /* _POLICY_H */
@@ -0,0 +1,88 @@
+/*
+ * Per-thread status area.  Publishes the calling thread's current node &
+ * migration proposal in memory so that hot paths (migration points, node
+ * queries from libopenpop & dsm-prefetch) read them with a load rather than a
+ * system call.
+ *
+ * The area mirrors the kernel's per-thread status.  Until the kernel shares
+ * it with userspace directly, the runtime acts as the publisher: the current
+ * node is read from the kernel once & then updated after each migration, and
+ * proposals are published by the migration signal handler or, without
+ * signal-triggered migration, refreshed from the kernel at most once every
+ * STATUS_REFRESH_NS nanoseconds.
+ *
+ * Date: 10/16/2026
+ */
+
+#ifndef _STATUS_H
+#define _STATUS_H
+
+/* A thread's published status. */
+struct thread_status_area
+{
+  volatile int current_nid; /* node on which the thread is executing */
+  volatile int proposed_nid; /* node to which to migrate, or -1 if none */
+  volatile int valid; /* whether the current node has been read */
+  unsigned long refreshed; /* when the proposal was last read from the OS */
+};
+
+extern __thread struct thread_status_area __thread_status;
+
+/*
+ * Read the calling thread's status from the kernel & publish it.
+ */
+void status_refresh(void);
+
+/*
+ * Get the calling thread's proposed node, refreshing from the kernel if the
+ * published proposal is stale.
+ *
+ * @return the node to which the thread should migrate, or -1 if none
+ */
+int status_proposed_nid(void);
+
+/*
+ * Get the node on which the calling thread is executing.
+ *
+ * @return the current node ID, or -1 if it could not be determined
+ */
+static inline int status_current_nid(void)
+{
+  if(!__thread_status.valid) status_refresh();
+  return __thread_status.current_nid;
+}
+
+/*
+ * Publish a migration proposal for the calling thread.  Async-signal-safe.
+ *
+ * @param nid the node to which the thread should migrate, or -1 to clear
+ */
+static inline void status_propose(int nid)
+{
+  __thread_status.proposed_nid = nid;
+}
+
+/*
+ * Publish that the calling thread arrived at a node, which also satisfies any
+ * pending proposal.
+ *
+ * @param nid the node on which the thread is now executing
+ */
+static inline void status_migrated(int nid)
+{
+  __thread_status.current_nid = nid;
+  __thread_status.proposed_nid = -1;
+  __thread_status.valid = 1;
+}
+
+/*
+ * Invalidate the calling thread's published status, so it's read from the
+ * kernel on the next query.
+ */
+static inline void status_invalidate(void)
+{
+  __thread_status.valid = 0;
+  __thread_status.refreshed = 0;
+}
+
+#endif /* _STATUS_H */
@@ -11,5 +11,12 @@
  */
 void clear_migrate_flag();
 
+/*
+ * If triggering a migration via signals, record the migration point through
+ * which the thread entered the migration library, to attribute response
+ * times to migration points.
+ */
+void set_migration_point(void *site);
+
 #endif /* _TRIGGER_H */
 
@@ -0,0 +1,63 @@
+/*
+ * Built-in migration policies.  Only depend on the metrics passed to them, so
+ * they can also be evaluated offline by util/policy-replay.
+ *
+ * Date: 10/16/2026
+ */
+
+#include "migrate.h"
+#include "policy.h"
+
+/* Follow the scheduler's proposal. */
+static int decide_proposal(const struct migrate_metrics *metrics, void *data)
+{
+  return metrics->proposed_nid;
+}
+
+/*
+ * Choose the node with the lowest estimated time to execute the next
+ * COST_MODEL_HORIZON intervals, including the cost of migrating there.
+ */
+static int decide_cost_model(const struct migrate_metrics *metrics, void *data)
+{
+  int nid, cur = metrics->current_nid, best = -1;
+  unsigned long long stay, cost, best_cost, work, faults;
+
+  if(metrics->proposed_nid >= 0) return metrics->proposed_nid;
+  if(cur < 0 || cur >= MIGRATE_MAX_NODES || !metrics->work_time[cur] ||
+     !metrics->since_point || metrics->points < COST_MODEL_MIN_POINTS)
+    return -1;
+
+  work = metrics->since_point * COST_MODEL_HORIZON;
+  faults = metrics->fault_rate * metrics->since_point / 1000000000ULL;
+  stay = work;
+  best_cost = stay - stay * COST_MODEL_MARGIN / 100;
+
+  for(nid = 0; nid < MIGRATE_MAX_NODES; nid++)
+  {
+    if(nid == cur || !(metrics->available & (1UL << nid)) ||
+       !metrics->work_time[nid]) continue;
+    // Note: scale in floating point, as work times may be in any units
+    cost = (double)work * metrics->work_time[nid] / metrics->work_time[cur] +
+           metrics->migration_ns + faults * COST_MODEL_FAULT_NS;
+    if(cost < best_cost)
+    {
+      best = nid;
+      best_cost = cost;
+    }
+  }
+
+  return best;
+}
+
+const struct migrate_policy migrate_policy_proposal = {
+  .name = "proposal",
+  .decide = decide_proposal,
+  .data = NULL,
+};
+
+const struct migrate_policy migrate_policy_cost_model = {
+  .name = "cost-model",
+  .decide = decide_cost_model,
+  .data = NULL,
+};
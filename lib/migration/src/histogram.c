@@ -0,0 +1,80 @@
+/*
+ * Lock-free log-bucketed (HDR-style) latency histograms.
+ *
+ * Date: 10/16/2026
+ */
+
+#include "histogram.h"
+
+/* Get the bucket for a value. */
+static inline size_t bucket_index(unsigned long long value)
+{
+  size_t magnitude;
+
+  // Values below HIST_SUB_BUCKETS map directly to the first sub-buckets
+  if(value < HIST_SUB_BUCKETS) return value;
+  magnitude = 63 - __builtin_clzll(value) - HIST_SUB_BITS + 1;
+  if(magnitude > HIST_MAGNITUDES) return HIST_BUCKETS - 1;
+  return magnitude * HIST_SUB_BUCKETS +
+         ((value >> (magnitude - 1)) & (HIST_SUB_BUCKETS - 1));
+}
+
+/* Get the highest value counted in a bucket. */
+static inline unsigned long long bucket_max(size_t bucket)
+{
+  size_t magnitude = bucket / HIST_SUB_BUCKETS,
+         sub = bucket % HIST_SUB_BUCKETS;
+
+  if(!magnitude) return sub;
+  return ((HIST_SUB_BUCKETS + sub + 1) << (magnitude - 1)) - 1;
+}
+
+void hist_record(struct histogram *hist, unsigned long long value)
+{
+  unsigned long long max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+
+  __atomic_fetch_add(&hist->buckets[bucket_index(value)], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&hist->sum, value, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+  while(value > max &&
+        !__atomic_compare_exchange_n(&hist->max, &max, value, 1,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+unsigned long long hist_percentile(const struct histogram *hist,
+                                   double fraction)
+{
+  unsigned long count = 0, target, total = 0;
+  unsigned long long max;
+  size_t i;
+
+  for(i = 0; i < HIST_BUCKETS; i++)
+    total += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+  if(!total) return 0;
+
+  target = (unsigned long)(fraction * total + 0.5);
+  if(target < 1) target = 1;
+  if(target > total) target = total;
+
+  // Note: the max is exact, so don't report past it
+  max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+  for(i = 0; i < HIST_BUCKETS; i++)
+  {
+    count += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+    if(count >= target) break;
+  }
+  return bucket_max(i) < max ? bucket_max(i) : max;
+}
+
+void hist_print_summary(const struct histogram *hist, FILE *fp)
+{
+  unsigned long count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+  unsigned long long sum = __atomic_load_n(&hist->sum, __ATOMIC_RELAXED);
+
+  fprintf(fp, "count %lu, mean %llu ns, p50 %llu ns, p99 %llu ns, "
+              "p999 %llu ns, max %llu ns\n",
+          count, count ? sum / count : 0,
+          hist_percentile(hist, 0.5), hist_percentile(hist, 0.99),
+          hist_percentile(hist, 0.999),
+          __atomic_load_n(&hist->max, __ATOMIC_RELAXED));
+}
@@ -1,6 +1,14 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "config.h"
+#include "mapping.h"
 
 /* Default node ID if no mapping is available. */
 static int default_node = 0;
@@ -11,34 +19,119 @@ typedef struct mapping {
   size_t region; // The application region number
   size_t num; // The number of node mappings for this region
   int *node; // node mappings, use PTID as index
+  size_t line; // The line on which the mapping appeared
 } mapping_t;
 
-static size_t num_mappings = 0; // Number of mappings parsed from file
-static mapping_t *mappings = NULL; // The guts
+/*
+ * A loaded thread schedule.  Binary schedules are mapped directly from the
+ * file, while text schedules are converted into the same format in memory.
+ */
+typedef struct schedule {
+  void *image; // The schedule in binary format
+  size_t size; // Size of the image
+  int mapped; // Whether the image is mapped from the file or allocated
+  struct timespec mtime; // Modification time of the file when loaded
+  const struct schedule_header *header;
+  const struct schedule_slot *slots;
+  const int32_t *nodes;
+  struct schedule *next; // Next retired schedule
+} schedule_t;
 
-/* Free any dynamically-allocated data. */
-static void __attribute__((destructor)) cleanup()
+/*
+ * The current schedule, swapped atomically when reloaded.  Lookups never
+ * block; when reloading is enabled they instead count themselves as readers
+ * while using a schedule.  Replaced schedules are retired & only released by
+ * a later reload which observes no readers, as any reader still holding a
+ * retired schedule must have started before it was replaced.
+ */
+static schedule_t *current = NULL;
+static schedule_t *retired = NULL;
+static unsigned long readers = 0;
+
+/* Schedule file name & reload state. */
+static const char *schedule_fn = NULL;
+static int reload_enabled = 0;
+static long reload_poll_ms = 0;
+static unsigned long long next_poll = 0;
+static int reloading = 0;
+static volatile sig_atomic_t reload_requested = 0;
+
+/* Release a schedule. */
+static void free_schedule(schedule_t *sched)
 {
-  size_t i;
+  if(!sched) return;
+  if(sched->mapped) munmap(sched->image, sched->size);
+  else free(sched->image);
+  free(sched);
+}
+
+/* Release all retired schedules. */
+static void free_retired()
+{
+  schedule_t *sched;
 
-  if(mappings)
+  while((sched = retired))
   {
-    for(i = 0; i < num_mappings; i++)
-      if(mappings[i].node) free(mappings[i].node);
-    free(mappings);
+    retired = sched->next;
+    free_schedule(sched);
   }
+}
 
-  num_mappings = 0;
-  mappings = NULL;
+/* Free any dynamically-allocated data. */
+static void __attribute__((destructor)) cleanup()
+{
+  free_schedule(current);
+  free_retired();
+  current = NULL;
 }
 
 /*
- * Users can tell the runtime the name of the file containing the thread
- * schedule by setting the POPCORN_THREAD_SCHEDULE environment variable.
- * Otherwise, the runtime will look for the file DEF_THREAD_SCHEDULE.
+ * Point a schedule's header, slots & nodes into its image & check that all
+ * regions' mappings are within the image.
  */
-#define DEF_THREAD_SCHEDULE "thread-schedule.txt"
-#define ENV_POPCORN_THREAD_SCHEDULE "POPCORN_THREAD_SCHEDULE"
+static int index_schedule(schedule_t *sched)
+{
+  const struct schedule_header *header = sched->image;
+  size_t i, size = sizeof(struct schedule_header);
+
+  if(sched->size < size ||
+     memcmp(header->magic, SCHEDULE_MAGIC, sizeof(header->magic)) ||
+     header->version != SCHEDULE_VERSION || header->num_slots < 2 ||
+     (header->num_slots & (header->num_slots - 1)))
+    return 0;
+
+  size += sizeof(struct schedule_slot) * header->num_slots;
+  if(sched->size < size ||
+     (sched->size - size) / sizeof(int32_t) < header->num_nodes)
+    return 0;
+
+  sched->header = header;
+  sched->slots = (const struct schedule_slot *)(header + 1);
+  sched->nodes = (const int32_t *)(sched->slots + header->num_slots);
+  for(i = 0; i < header->num_slots; i++)
+    if(sched->slots[i].first != SCHEDULE_EMPTY &&
+       (uint64_t)sched->slots[i].first + sched->slots[i].num >
+       header->num_nodes)
+      return 0;
+  return 1;
+}
+
+/* Find a region's mappings in a schedule. */
+static const struct schedule_slot *
+find_region(const schedule_t *sched, uint64_t region)
+{
+  uint32_t i, mask = sched->header->num_slots - 1;
+  size_t idx = schedule_hash(region, sched->header->num_slots);
+  const struct schedule_slot *slot;
+
+  for(i = 0; i <= mask; i++, idx = (idx + 1) & mask)
+  {
+    slot = &sched->slots[idx];
+    if(slot->first == SCHEDULE_EMPTY) return NULL;
+    if(slot->region == region) return slot;
+  }
+  return NULL;
+}
 
 /* Comparison function for sorting by region numbers. */
 int region_compare(const void *a, const void *b)
@@ -47,12 +140,67 @@ int region_compare(const void *a, const void *b)
   mapping_t *map_b = (mapping_t *)b;
   if(map_a->region < map_b->region) return -1;
   else if(map_a->region > map_b->region) return 1;
+  else if(map_a->line < map_b->line) return -1;
+  else if(map_a->line > map_b->line) return 1;
   else return 0;
 }
 
+/* Convert parsed text mappings into a binary schedule. */
+static schedule_t *build_schedule(mapping_t *mappings, size_t num_mappings)
+{
+  struct schedule_header *header;
+  struct schedule_slot *slots;
+  int32_t *nodes;
+  size_t i, j, idx, num_nodes = 0;
+  uint32_t num_slots = 2;
+  schedule_t *sched;
+
+  for(i = 0; i < num_mappings; i++) num_nodes += mappings[i].num;
+  while(num_slots < num_mappings * 2) num_slots <<= 1;
+
+  if(!(sched = calloc(1, sizeof(schedule_t)))) return NULL;
+  sched->size = sizeof(struct schedule_header) +
+                sizeof(struct schedule_slot) * num_slots +
+                sizeof(int32_t) * num_nodes;
+  if(!(sched->image = calloc(1, sched->size)))
+  {
+    free(sched);
+    return NULL;
+  }
+
+  header = sched->image;
+  slots = (struct schedule_slot *)(header + 1);
+  nodes = (int32_t *)(slots + num_slots);
+  memcpy(header->magic, SCHEDULE_MAGIC, sizeof(header->magic));
+  header->version = SCHEDULE_VERSION;
+  header->num_slots = num_slots;
+  header->num_nodes = num_nodes;
+  for(i = 0; i < num_slots; i++) slots[i].first = SCHEDULE_EMPTY;
+
+  // Note: mappings are sorted by region & then by line, so the first of
+  // duplicate regions in the file wins
+  for(i = 0, num_nodes = 0; i < num_mappings; i++)
+  {
+    idx = schedule_hash(mappings[i].region, num_slots);
+    while(slots[idx].first != SCHEDULE_EMPTY &&
+          slots[idx].region != mappings[i].region)
+      idx = (idx + 1) & (num_slots - 1);
+    if(slots[idx].first != SCHEDULE_EMPTY) continue;
+
+    slots[idx].region = mappings[i].region;
+    slots[idx].first = num_nodes;
+    slots[idx].num = mappings[i].num;
+    for(j = 0; j < mappings[i].num; j++)
+      nodes[num_nodes++] = mappings[i].node[j];
+  }
+
+  index_schedule(sched);
+  return sched;
+}
+
 /*
- * Parse the mapping file, if one is available. Files contain a Popcorn
- * thread ID (PTID) -> node mapping in the following format:
+ * Parse a text schedule. Files contain a Popcorn thread ID (PTID) -> node
+ * mapping in the following format:
  *
  *  <region #> <# entries> <PTID 0 node> ... <PTID N node>
  *
@@ -68,21 +216,12 @@ int region_compare(const void *a, const void *b)
  * The file may contain multiple lines, one per region.  Regions are
  * implementation-dependent and may be defined by the user or compiler.
  */
-static void __attribute__((constructor)) read_mapping_schedule()
+static schedule_t *parse_text_schedule(FILE *fp)
 {
   int c, read;
-  size_t i, j;
-  const char *fn;
-  FILE *fp;
-
-  if(!(fn = getenv(ENV_POPCORN_THREAD_SCHEDULE))) fn = DEF_THREAD_SCHEDULE;
-  if(!(fp = fopen(fn, "r")))
-  {
-#if _DEBUG == 1
-    perror("Could not open thread schedule file");
-#endif
-    return;
-  }
+  size_t i, j, num_mappings;
+  mapping_t *mappings;
+  schedule_t *sched = NULL;
 
   // Start by figuring out how many mappings are in the file
   num_mappings = 1;
@@ -92,15 +231,17 @@ static void __attribute__((constructor)) read_mapping_schedule()
 
   // Allocate storage & parse file
   mappings = (mapping_t *)calloc(num_mappings, sizeof(mapping_t));
+  if(!mappings) return NULL;
   for(i = 0; i < num_mappings; i++)
   {
     // The first few fields are fixed and will tell us the variable parts
     read = fscanf(fp, "%lu %lu", &mappings[i].region, &mappings[i].num);
+    mappings[i].line = i;
 
     // Check if we accidentally have an extra newline character
     if(read == EOF)
     {
-      num_mappings--;
+      num_mappings = i;
       break;
     }
     // Otherwise, ensure the format wasn't screwed up
@@ -110,8 +251,8 @@ static void __attribute__((constructor)) read_mapping_schedule()
       fprintf(stderr, "Parsing error: invalid thread mapping "
                       "format, line %lu\n", i);
 #endif
-      cleanup();
-      return;
+      num_mappings = i;
+      goto cleanup;
     }
 
     // Allocate storage & parse node mapping list
@@ -125,46 +266,211 @@ static void __attribute__((constructor)) read_mapping_schedule()
         fprintf(stderr, "Parsing error: not enough node "
                         "mappings, line %lu\n", i);
 #endif
-        cleanup();
-        return;
+        num_mappings = i + 1;
+        goto cleanup;
       }
     }
   }
 
-  // Sort so we can do a binary search based on region ID
+  // Sort so duplicate regions are resolved deterministically
   qsort(mappings, num_mappings, sizeof(mapping_t), region_compare);
+  sched = build_schedule(mappings, num_mappings);
+
+cleanup:
+  for(i = 0; i < num_mappings; i++)
+    if(mappings[i].node) free(mappings[i].node);
+  free(mappings);
+  return sched;
+}
 
+/*
+ * Load a thread schedule.  Binary schedules (beginning with SCHEDULE_MAGIC)
+ * are mapped read-only; anything else is parsed as a text schedule.
+ */
+static schedule_t *load_schedule(const char *fn)
+{
+  int fd;
+  FILE *fp;
+  struct stat st;
+  char magic[sizeof(((struct schedule_header *)0)->magic)];
+  schedule_t *sched = NULL;
+
+  if((fd = open(fn, O_RDONLY)) < 0)
+  {
 #if _DEBUG == 1
+    perror("Could not open thread schedule file");
+#endif
+    return NULL;
+  }
+  if(fstat(fd, &st)) goto close_fd;
+
+  if(st.st_size >= (off_t)sizeof(magic) &&
+     pread(fd, magic, sizeof(magic), 0) == sizeof(magic) &&
+     !memcmp(magic, SCHEDULE_MAGIC, sizeof(magic)))
+  {
+    if(!(sched = calloc(1, sizeof(schedule_t)))) goto close_fd;
+    sched->size = st.st_size;
+    sched->mapped = 1;
+    sched->image = mmap(NULL, sched->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(sched->image == MAP_FAILED)
+    {
+      free(sched);
+      sched = NULL;
+    }
+    else if(!index_schedule(sched))
+    {
+#if _DEBUG == 1
+      fprintf(stderr, "Invalid binary thread schedule '%s'\n", fn);
+#endif
+      free_schedule(sched);
+      sched = NULL;
+    }
+  }
+  else if((fp = fdopen(fd, "r")))
+  {
+    sched = parse_text_schedule(fp);
+    fd = -1;
+    fclose(fp);
+  }
+
+  if(sched) sched->mtime = st.st_mtim;
+
+close_fd:
+  if(fd >= 0) close(fd);
+  return sched;
+}
+
+/* Publish a newly-loaded schedule. */
+static void publish_schedule(schedule_t *sched)
+{
+  schedule_t *prev;
+#if _DEBUG == 1
+  const struct schedule_slot *slot;
+  size_t i, j;
+
   printf("-> Thread schedule <-\n");
-  for(i = 0; i < num_mappings; i++)
+  for(i = 0; i < sched->header->num_slots; i++)
   {
-    printf("Region %lu: %lu mappings", mappings[i].region, mappings[i].num);
-    for(j = 0; j < mappings[i].num; j++) printf(" %d", mappings[i].node[j]);
+    slot = &sched->slots[i];
+    if(slot->first == SCHEDULE_EMPTY) continue;
+    printf("Region %lu: %u mappings", slot->region, slot->num);
+    for(j = 0; j < slot->num; j++) printf(" %d", sched->nodes[slot->first + j]);
     printf("\n");
   }
 #endif
 
-  fclose(fp);
+  // Note: only one thread publishes at a time (the constructor or the thread
+  // holding the reload flag), so the retired list needs no locking
+  prev = __atomic_exchange_n(&current, sched, __ATOMIC_SEQ_CST);
+  if(prev)
+  {
+    prev->next = retired;
+    retired = prev;
+  }
+  if(!__atomic_load_n(&readers, __ATOMIC_SEQ_CST)) free_retired();
 }
 
-/* Comparison function for finding region. */
-int region_find(const void *k, const void *m)
+/* Request a reload from a signal handler. */
+static void request_reload(int sig) { reload_requested = 1; }
+
+/* Get a coarse monotonic timestamp, in nanoseconds. */
+static inline unsigned long long coarse_now()
 {
-  size_t key = *(size_t *)k;
-  mapping_t *map = (mapping_t *)m;
-  if(key < map->region) return -1;
-  else if(key > map->region) return 1;
-  else return 0;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+  return now.tv_sec * 1000000000ULL + now.tv_nsec;
 }
 
-int get_node_mapping(size_t region, int ptid)
+/*
+ * Reload the schedule if requested by a signal or if the file has changed.
+ * Only one thread reloads at a time; others keep using the current schedule.
+ */
+static void check_reload()
 {
-  if(ptid < 0) return default_node;
-  mapping_t *map = bsearch(&region, mappings, num_mappings,
-                           sizeof(mapping_t), region_find);
-  if(!map) return default_node;
+  int reload = reload_requested;
+  struct stat st;
+  unsigned long long now = 0;
+  const schedule_t *sched;
+  schedule_t *loaded;
+
+  if(!reload)
+  {
+    if(!reload_poll_ms) return;
+    now = coarse_now();
+    if(now < __atomic_load_n(&next_poll, __ATOMIC_RELAXED)) return;
+  }
 
-  if((size_t)ptid < map->num) return map->node[ptid];
+  if(__atomic_exchange_n(&reloading, 1, __ATOMIC_ACQUIRE)) return;
+  if(!reload)
+  {
+    __atomic_store_n(&next_poll, now + reload_poll_ms * 1000000ULL,
+                     __ATOMIC_RELAXED);
+    sched = current;
+    reload = !stat(schedule_fn, &st) &&
+             (!sched || st.st_mtim.tv_sec != sched->mtime.tv_sec ||
+              st.st_mtim.tv_nsec != sched->mtime.tv_nsec);
+  }
+
+  if(reload)
+  {
+    reload_requested = 0;
+    if((loaded = load_schedule(schedule_fn))) publish_schedule(loaded);
+#if _DEBUG == 1
+    else fprintf(stderr, "Could not reload thread schedule\n");
+#endif
+  }
+  __atomic_store_n(&reloading, 0, __ATOMIC_RELEASE);
+}
+
+/* Load the thread schedule & set up reloading if requested. */
+static void __attribute__((constructor)) read_mapping_schedule()
+{
+  schedule_t *sched;
+  const char *reload;
+  struct sigaction sa;
+
+  if(!(schedule_fn = getenv(ENV_POPCORN_THREAD_SCHEDULE)))
+    schedule_fn = DEF_THREAD_SCHEDULE;
+  if((sched = load_schedule(schedule_fn))) publish_schedule(sched);
+
+  if((reload = getenv(ENV_POPCORN_THREAD_SCHEDULE_RELOAD)))
+  {
+    reload_poll_ms = atol(reload);
+    if(reload_poll_ms < 0) reload_poll_ms = 0;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = request_reload;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    if(sigaction(RELOAD_SCHEDULE_SIGNAL, &sa, NULL))
+      perror("Could not register thread schedule reload signal handler");
+    reload_enabled = 1;
+  }
+}
+
+/* Look up a thread's node in a schedule. */
+static int lookup_node(const schedule_t *sched, size_t region, int ptid)
+{
+  const struct schedule_slot *slot;
+
+  if(!sched || !(slot = find_region(sched, region))) return default_node;
+  if((uint32_t)ptid < slot->num) return sched->nodes[slot->first + ptid];
   return default_node;
 }
 
+int get_node_mapping(size_t region, int ptid)
+{
+  int node;
+
+  if(ptid < 0) return default_node;
+  if(!reload_enabled)
+    return lookup_node(__atomic_load_n(&current, __ATOMIC_ACQUIRE),
+                       region, ptid);
+
+  // The reader count must be visible before loading the schedule, so that a
+  // reload replacing it either sees this reader or isn't seen by it
+  check_reload();
+  __atomic_fetch_add(&readers, 1, __ATOMIC_SEQ_CST);
+  node = lookup_node(__atomic_load_n(&current, __ATOMIC_SEQ_CST), region, ptid);
+  __atomic_fetch_sub(&readers, 1, __ATOMIC_RELEASE);
+  return node;
+}
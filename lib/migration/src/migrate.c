@@ -11,9 +11,16 @@
 #include "internal.h"
 #include "mapping.h"
 #include "debug.h"
+#include "status.h"
+#include "policy.h"
 
 #if _SIG_MIGRATION == 1
 #include "trigger.h"
+
+/* Attribute response times to the migration point which called into us. */
+#define SET_MIGRATION_POINT() set_migration_point(__builtin_return_address(0))
+#else
+#define SET_MIGRATION_POINT()
 #endif
 
 #if _TIME_REWRITE == 1
@@ -122,13 +129,11 @@ static inline int do_migrate(void *addr)
 
 #else /* _ENV_SELECT_MIGRATE */
 
-// TODO remove this in future versions
-static inline int do_migrate(void __attribute__((unused)) *fn)
+// Note: without a policy, reads the proposal published in the thread's status
+// area rather than querying the kernel at every migration point
+static inline int do_migrate(void *fn)
 {
-	struct popcorn_thread_status status;
-	int ret = popcorn_getthreadinfo(&status);
-	if (ret) return -1;
-	return status.proposed_nid;
+  return policy_decide(fn);
 }
 
 #endif /* _ENV_SELECT_MIGRATE */
@@ -144,15 +149,14 @@ int node_available(int nid)
 
 enum arch current_arch(void)
 {
-	int nid = popcorn_getnid();
+	int nid = status_current_nid();
 	if (nid < 0 || nid >= MAX_POPCORN_NODES) return ARCH_UNKNOWN;
 	return ni[nid].arch;
 }
 
-// TODO remove this in future versions
 int current_nid(void)
 {
-  return popcorn_getnid();
+  return status_current_nid();
 }
 
 // TODO remove this in future versions
@@ -207,22 +211,62 @@ static inline void *get_thread_pointer(void *raw_tls, enum arch dest)
 static void* __attribute__((noinline))
 get_call_site() { return __builtin_return_address(0); };
 
+/*
+ * Wait for the rest of the team to finish preparing for migration.  The last
+ * member to arrive decides for the entire team whether to migrate, and resets
+ * the team for the next round.  Members can't start the next round until all
+ * members have arrived (and hence read the decision) in this round.
+ *
+ * @param team the team
+ * @param ready whether the calling member is ready to migrate
+ * @return non-zero if all members are ready to migrate, or zero otherwise
+ */
+static int team_arrive(struct migrate_team *team, int ready)
+{
+  int proceed;
+  unsigned long round;
+
+  pthread_mutex_lock(&team->lock);
+  if(!ready) team->failed = 1;
+  round = team->round;
+  if(++team->arrived == team->size)
+  {
+    team->proceed = !team->failed;
+    team->arrived = 0;
+    team->failed = 0;
+    team->round++;
+    pthread_cond_broadcast(&team->done);
+  }
+  else while(round == team->round) pthread_cond_wait(&team->done, &team->lock);
+  proceed = team->proceed;
+  pthread_mutex_unlock(&team->lock);
+
+  return proceed;
+}
+
 /* Check & invoke migration if requested. */
 // Note: a pointer to data necessary to bootstrap execution after migration is
-// saved by the pthread library.
+// saved by the pthread library.  If migrating as part of a team, waits for the
+// rest of the team to rewrite their stacks before migrating.
 void
-__migrate_shim_internal(int nid, void (*callback)(void *), void *callback_data)
+__migrate_shim_internal(int nid,
+                        void (*callback)(void *),
+                        void *callback_data,
+                        struct migrate_team *team)
 {
   int err;
   struct shim_data data;
   struct shim_data *data_ptr;
 #if _CLEAN_CRASH == 1
+  // Note: queries the kernel, as the heterogeneous path re-enters on the
+  // destination before publishing that the thread has arrived
   int cur_nid = popcorn_getnid();
 #endif
 
   if(!node_available(nid))
   {
     fprintf(stderr, "Destination node is not available!\n");
+    if(team) team_arrive(team, 0);
     return;
   }
 
@@ -250,6 +294,12 @@ __migrate_shim_internal(int nid, void (*callback)(void *), void *callback_data)
       TIMESTAMP(end);
       printf("Stack transformation time: %lluns\n", TIMESTAMP_DIFF(start, end));
 #endif
+      if(team && !team_arrive(team, 1))
+      {
+        fprintf(stderr, "Team could not migrate, not migrating!\n");
+        return;
+      }
+
       data.callback = callback;
       data.callback_data = callback_data;
       data.regset = &regs_dst;
@@ -317,11 +367,19 @@ __migrate_shim_internal(int nid, void (*callback)(void *), void *callback_data)
     else
     {
       fprintf(stderr, "Could not rewrite stack!\n");
+      if(team) team_arrive(team, 0);
       return;
     }
   }
 
   // Post-migration
+#if _NATIVE == 1
+  // Note: simulated migrations don't change nodes
+  status_invalidate();
+#else
+  status_migrated(nid);
+#endif
+  policy_migrated();
 #if _DEBUG == 1
   // Hold until we can attach post-migration
   while(__hold);
@@ -338,15 +396,17 @@ __migrate_shim_internal(int nid, void (*callback)(void *), void *callback_data)
 void check_migrate(void (*callback)(void *), void *callback_data)
 {
   int nid = do_migrate(__builtin_return_address(0));
-  if (nid >= 0 && nid != popcorn_getnid())
-    __migrate_shim_internal(nid, callback, callback_data);
+  SET_MIGRATION_POINT();
+  if (nid >= 0 && nid != status_current_nid())
+    __migrate_shim_internal(nid, callback, callback_data, NULL);
 }
 
 /* Invoke migration to a particular node if we're not already there. */
 void migrate(int nid, void (*callback)(void *), void *callback_data)
 {
-  if (nid != popcorn_getnid())
-    __migrate_shim_internal(nid, callback, callback_data);
+  SET_MIGRATION_POINT();
+  if (nid != status_current_nid())
+    __migrate_shim_internal(nid, callback, callback_data, NULL);
 }
 
 /* Invoke migration to a particular node according to a thread schedule. */
@@ -356,6 +416,54 @@ void migrate_schedule(size_t region,
                       void *callback_data)
 {
   int nid = get_node_mapping(region, popcorn_tid);
-  if (nid != popcorn_getnid())
-    __migrate_shim_internal(nid, callback, callback_data);
+  SET_MIGRATION_POINT();
+  if (nid != status_current_nid())
+    __migrate_shim_internal(nid, callback, callback_data, NULL);
+}
+
+/* Initialize a team & load metadata for all nodes to which it may migrate. */
+int migrate_team_init(struct migrate_team *team, int size)
+{
+  int nid, ret;
+
+  if(!team || size < 1) return 1;
+  if((ret = pthread_mutex_init(&team->lock, NULL))) return ret;
+  if((ret = pthread_cond_init(&team->done, NULL)))
+  {
+    pthread_mutex_destroy(&team->lock);
+    return ret;
+  }
+  team->size = size;
+  team->arrived = 0;
+  team->failed = 0;
+  team->proceed = 0;
+  team->round = 0;
+
+  // Note: loading metadata is serialized, so do it once up front rather than
+  // having every member wait for it when they rewrite their stacks
+  for(nid = 0; nid < MAX_POPCORN_NODES; nid++)
+    if(node_available(nid) && st_userspace_prepare(ni[nid].arch))
+      fprintf(stderr, "Could not load rewriting metadata for node %d\n", nid);
+
+  return 0;
+}
+
+/* Release a team's resources. */
+void migrate_team_destroy(struct migrate_team *team)
+{
+  if(!team) return;
+  pthread_cond_destroy(&team->done);
+  pthread_mutex_destroy(&team->lock);
+}
+
+/* Invoke migration to a particular node together with the rest of the team. */
+void migrate_team(struct migrate_team *team,
+                  int nid,
+                  void (*callback)(void *),
+                  void *callback_data)
+{
+  SET_MIGRATION_POINT();
+  if (nid != status_current_nid())
+    __migrate_shim_internal(nid, callback, callback_data, team);
+  else team_arrive(team, 1);
 }
@@ -0,0 +1,248 @@
+/*
+ * Migration policy engine, see policy.h.
+ *
+ * Date: 10/16/2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include "platform.h"
+#include "migrate.h"
+#include "policy.h"
+#include "status.h"
+
+_Static_assert(MIGRATE_MAX_NODES == MAX_POPCORN_NODES,
+               "MIGRATE_MAX_NODES must match MAX_POPCORN_NODES");
+
+/* The policy consulted at migration points, or NULL to follow proposals. */
+static const struct migrate_policy *policy = NULL;
+
+/* Built-in policies, selectable by name through the environment. */
+static const struct migrate_policy *builtin[] = {
+  &migrate_policy_proposal,
+  &migrate_policy_cost_model,
+};
+
+/* Per-thread metrics, reset when the thread migrates. */
+struct thread_metrics
+{
+  unsigned long long last_point;
+  unsigned long long points;
+};
+
+static __thread struct thread_metrics my_metrics = { 0, 0 };
+
+/* Latest per-node work times reported by work-sharing runtimes. */
+static unsigned long long work_time[MAX_POPCORN_NODES];
+
+/*
+ * Per-node DSM page fault rates.  The kernel's counts aren't consistent
+ * between nodes, so rates are only calculated from counts read on the same
+ * node.
+ */
+struct fault_sample
+{
+  pthread_mutex_t lock;
+  unsigned long long time;
+  unsigned long long count;
+  unsigned long long rate;
+};
+
+static struct fault_sample faults[MAX_POPCORN_NODES];
+
+/* Estimated cost of migrating. */
+static unsigned long long migration_ns = POLICY_MIGRATION_NS;
+
+/* Decision trace, if requested. */
+static FILE *trace = NULL;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline unsigned long long now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Read the number of page faults sent by this node from /proc/popcorn_stat.
+ * Uses the same format as libopenpop's popcorn_get_page_faults().
+ */
+static int read_page_faults(unsigned long long *sent)
+{
+  char buf[768], *cur, *end;
+  size_t len, i;
+  FILE *fp;
+
+  if(!(fp = fopen("/proc/popcorn_stat", "r"))) return 1;
+  len = fread(buf, 1, sizeof(buf) - 1, fp);
+  fclose(fp);
+  buf[len] = '\0';
+
+  if(!(cur = strchr(buf, '-'))) return 1;
+  for(i = 0; i < 10 && *cur; cur++)
+    if(*cur == '\n') i++;
+  while(*cur == ' ') cur++;
+  *sent = strtoull(cur, &end, 10);
+  return end == cur;
+}
+
+/* Get the node's page fault rate, re-sampling it if stale. */
+static unsigned long long get_fault_rate(int nid, unsigned long long now)
+{
+  struct fault_sample *sample = &faults[nid];
+  unsigned long long count;
+
+  // Note: only one thread per node samples, the rest use the previous rate
+  if(now - __atomic_load_n(&sample->time, __ATOMIC_RELAXED) >= POLICY_SAMPLE_NS
+     && !pthread_mutex_trylock(&sample->lock))
+  {
+    if(now - sample->time >= POLICY_SAMPLE_NS && !read_page_faults(&count))
+    {
+      if(sample->time && count >= sample->count)
+        __atomic_store_n(&sample->rate, (count - sample->count) *
+                         1000000000ULL / (now - sample->time),
+                         __ATOMIC_RELAXED);
+      sample->count = count;
+      __atomic_store_n(&sample->time, now, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&sample->lock);
+  }
+  return __atomic_load_n(&sample->rate, __ATOMIC_RELAXED);
+}
+
+/* Record a decision in the trace. */
+static void record_decision(const struct migrate_metrics *metrics,
+                            int decision,
+                            unsigned long long now)
+{
+  struct policy_trace_record rec;
+
+  rec.timestamp = now;
+  rec.tid = syscall(SYS_gettid);
+  rec.decision = decision;
+  rec.metrics = *metrics;
+
+  pthread_mutex_lock(&trace_lock);
+  if(trace && fwrite(&rec, sizeof(rec), 1, trace) != 1)
+  {
+    fprintf(stderr, "Could not write migration policy trace\n");
+    fclose(trace);
+    trace = NULL;
+  }
+  pthread_mutex_unlock(&trace_lock);
+}
+
+/* Decide whether & where the calling thread should migrate. */
+int policy_decide(void *site)
+{
+  const struct migrate_policy *cur;
+  struct migrate_metrics metrics;
+  unsigned long long now;
+  int nid, decision;
+
+  cur = __atomic_load_n(&policy, __ATOMIC_ACQUIRE);
+  if(!cur) return status_proposed_nid();
+
+  now = now_ns();
+  metrics.current_nid = status_current_nid();
+  metrics.proposed_nid = status_proposed_nid();
+  metrics.site = site;
+  metrics.since_point = my_metrics.last_point ? now - my_metrics.last_point : 0;
+  metrics.points = my_metrics.points;
+  metrics.migration_ns = migration_ns;
+  metrics.available = 0;
+  for(nid = 0; nid < MAX_POPCORN_NODES; nid++)
+  {
+    if(node_available(nid)) metrics.available |= 1UL << nid;
+    metrics.work_time[nid] = __atomic_load_n(&work_time[nid], __ATOMIC_RELAXED);
+  }
+  if(metrics.current_nid >= 0 && metrics.current_nid < MAX_POPCORN_NODES)
+    metrics.fault_rate = get_fault_rate(metrics.current_nid, now);
+  else metrics.fault_rate = 0;
+
+  decision = cur->decide(&metrics, cur->data);
+  if(__atomic_load_n(&trace, __ATOMIC_RELAXED))
+    record_decision(&metrics, decision, now);
+
+  my_metrics.last_point = now;
+  my_metrics.points++;
+  return decision;
+}
+
+/* Reset the calling thread's metrics after migrating. */
+void policy_migrated(void)
+{
+  my_metrics.last_point = 0;
+  my_metrics.points = 0;
+}
+
+/* Set the policy consulted at migration points. */
+void migrate_set_policy(const struct migrate_policy *new)
+{
+  __atomic_store_n(&policy, new, __ATOMIC_RELEASE);
+}
+
+/* Record a node's time to complete a unit of work. */
+void migrate_report_workshare(int nid, unsigned long long time)
+{
+  if(nid < 0 || nid >= MAX_POPCORN_NODES) return;
+  __atomic_store_n(&work_time[nid], time, __ATOMIC_RELAXED);
+}
+
+/* Close the trace at exit. */
+static void __attribute__((destructor)) __close_policy_trace()
+{
+  pthread_mutex_lock(&trace_lock);
+  if(trace) fclose(trace);
+  trace = NULL;
+  pthread_mutex_unlock(&trace_lock);
+}
+
+/* Select the policy, migration cost & trace from the environment. */
+static void __attribute__((constructor)) __init_policy()
+{
+  struct policy_trace_header header;
+  const char *env;
+  size_t i;
+
+  for(i = 0; i < MAX_POPCORN_NODES; i++)
+    pthread_mutex_init(&faults[i].lock, NULL);
+
+  if((env = getenv(ENV_MIGRATE_POLICY_MIGRATION_NS)))
+    migration_ns = strtoull(env, NULL, 10);
+
+  if((env = getenv(ENV_MIGRATE_POLICY)) && *env)
+  {
+    for(i = 0; i < sizeof(builtin) / sizeof(builtin[0]); i++)
+      if(!strcmp(env, builtin[i]->name)) migrate_set_policy(builtin[i]);
+    if(!policy) fprintf(stderr, "Unknown migration policy '%s'\n", env);
+  }
+
+  if((env = getenv(ENV_MIGRATE_POLICY_TRACE)) && *env)
+  {
+    if(!(trace = fopen(env, "w")))
+    {
+      fprintf(stderr, "Could not open migration policy trace '%s'\n", env);
+      return;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, POLICY_TRACE_MAGIC, sizeof(header.magic));
+    header.version = POLICY_TRACE_VERSION;
+    header.record_size = sizeof(struct policy_trace_record);
+    if(fwrite(&header, sizeof(header), 1, trace) != 1)
+    {
+      fprintf(stderr, "Could not write migration policy trace\n");
+      fclose(trace);
+      trace = NULL;
+    }
+
+    // Note: trace the scheduler's proposals if no policy was selected
+    else if(!policy) migrate_set_policy(&migrate_policy_proposal);
+  }
+}
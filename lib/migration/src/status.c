@@ -0,0 +1,53 @@
+/*
+ * Per-thread status area, see status.h.
+ *
+ * Date: 10/16/2026
+ */
+
+#include <time.h>
+#include "platform.h"
+#include "config.h"
+#include "status.h"
+
+__thread struct thread_status_area __thread_status = { -1, -1, 0, 0 };
+
+/* Read the calling thread's status from the kernel & publish it. */
+void status_refresh(void)
+{
+  struct popcorn_thread_status status;
+
+  if(popcorn_getthreadinfo(&status))
+  {
+    status.current_nid = -1;
+    status.proposed_nid = -1;
+  }
+
+  __thread_status.current_nid = status.current_nid;
+#if _SIG_MIGRATION == 0
+  // Note: with signal-triggered migration, proposals are published by the
+  // signal handler -- don't clobber one which arrived during the system call
+  __thread_status.proposed_nid = status.proposed_nid;
+#endif
+  __thread_status.valid = 1;
+}
+
+/* Get the calling thread's proposal, refreshing it if stale. */
+int status_proposed_nid(void)
+{
+#if _SIG_MIGRATION == 0
+  struct timespec now;
+  unsigned long ns;
+
+  // Note: the coarse clock is read through the vDSO, i.e., without entering
+  // the kernel
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+  ns = now.tv_sec * 1000000000UL + now.tv_nsec;
+  if(!__thread_status.valid ||
+     ns - __thread_status.refreshed >= STATUS_REFRESH_NS)
+  {
+    status_refresh();
+    __thread_status.refreshed = ns;
+  }
+#endif
+  return __thread_status.proposed_nid;
+}
@@ -4,99 +4,263 @@
 #include <unistd.h>
 #include <string.h>
 #include <signal.h>
+#include <errno.h>
 #include <assert.h>
+#include <sys/syscall.h>
 #include "config.h"
+#include "migrate.h"
+#include "trigger.h"
+#include "status.h"
 
 #if _SIG_MIGRATION == 1
 
-/* Flag set by signal handler indicating a thread should migrate. */
-// TODO this should be thread-specific
-volatile int __migrate_flag = -1;
+/*
+ * Per-thread migration request slot, set by the signal handler to the node to
+ * which the thread should migrate (or -1 if there's no pending request).
+ * Compiler-instrumented migration points check this flag to decide whether to
+ * call into the migration library.
+ */
+__thread volatile int __migrate_flag = -1;
+
+/* Details about the calling thread's pending migration request. */
+struct migrate_request
+{
+  int reason; /* requester-defined reason for the migration */
+  unsigned long long start; /* when the request was received */
+  void *site; /* migration point through which the thread last entered */
+};
+
+static __thread struct migrate_request request = { 0, UINT64_MAX, NULL };
 
 #if _TIME_RESPONSE_DELAY == 1
 
 #include "timer.h"
+#include "histogram.h"
 
 /*
- * Statistics about number of times a migration was signalled and the time
- * between when the migration was signalled and when the thread reached the
- * migration library.
+ * Per-thread statistics about number of times a migration was signalled and
+ * the time between when the migration was signalled and when the thread
+ * reached the migration library.
  */
-// Note: we don't expect to be signalled *that* much during a single
-// application's execution, so only maintain 1024 timings.
-static volatile unsigned long num_triggers = 0;
-static unsigned long long response_timings[1024] = { 0L }; // In nanoseconds
+struct response_stats
+{
+  pid_t tid;
+  unsigned long reasons[MAX_MIGRATE_REASONS];
+  struct histogram hist;
+  struct response_stats *next;
+};
+
+/* All threads' statistics, kept after threads exit so they can be output. */
+static struct response_stats *all_stats = NULL;
+static __thread struct response_stats *my_stats = NULL;
+
+/* Response times for a migration point. */
+struct site_stats
+{
+  void *site;
+  struct histogram hist;
+};
 
 /*
- * Starting (architecture-specific) timestamp set when a thread executes the
- * migration request signal handler.
+ * Per-migration point statistics, in an insert-only hash table.  Responses at
+ * migration points which don't fit in the table are counted together.
  */
-// TODO needs to be thread-specific
-static unsigned long long start = UINT64_MAX;
+static struct site_stats *sites[MAX_MIGRATION_SITES] = { NULL };
+static struct site_stats other_sites = { NULL };
+
+/* Get the statistics for a migration point, adding it if necessary. */
+static struct site_stats *get_site_stats(void *site)
+{
+  size_t i, idx = ((uintptr_t)site >> 2) % MAX_MIGRATION_SITES;
+  struct site_stats *cur, *stats = NULL;
+
+  for(i = 0; i < MAX_MIGRATION_SITES; i++)
+  {
+    cur = __atomic_load_n(&sites[idx], __ATOMIC_ACQUIRE);
+    if(!cur)
+    {
+      if(!stats && !(stats = calloc(1, sizeof(struct site_stats)))) break;
+      stats->site = site;
+      if(__atomic_compare_exchange_n(&sites[idx], &cur, stats, 0,
+                                     __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+        return stats;
+    }
+    if(cur->site == site)
+    {
+      free(stats);
+      return cur;
+    }
+    idx = (idx + 1) % MAX_MIGRATION_SITES;
+  }
+
+  free(stats);
+  return &other_sites;
+}
+
+/* Get the calling thread's response time statistics. */
+static struct response_stats *get_response_stats()
+{
+  struct response_stats *stats;
+
+  if(my_stats) return my_stats;
+  if(!(stats = calloc(1, sizeof(struct response_stats)))) return NULL;
+  stats->tid = syscall(SYS_gettid);
+  stats->next = __atomic_load_n(&all_stats, __ATOMIC_RELAXED);
+  while(!__atomic_compare_exchange_n(&all_stats, &stats->next, stats, 1,
+                                     __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+  my_stats = stats;
+  return stats;
+}
+
+/* Record a response time in the thread's & migration point's statistics. */
+static void record_response(unsigned long long ns, int reason, void *site)
+{
+  struct response_stats *stats;
+
+  // Note: samples are never dropped -- if we can't allocate statistics for
+  // the migration point, it's counted with other points
+  hist_record(&get_site_stats(site)->hist, ns);
+
+  if(!(stats = get_response_stats()))
+  {
+    fprintf(stderr, "WARNING: could not allocate response time statistics\n");
+    return;
+  }
+  if(reason < 0 || reason >= MAX_MIGRATE_REASONS)
+    reason = MAX_MIGRATE_REASONS - 1;
+  stats->reasons[reason]++;
+  hist_record(&stats->hist, ns);
+}
+
+/* Write response time statistics to a stream. */
+static void print_response_timing(FILE *fp)
+{
+  const struct response_stats *stats;
+  const struct site_stats *site;
+  unsigned long i;
+
+  fprintf(fp, "Response times by migration point:\n");
+  for(i = 0; i < MAX_MIGRATION_SITES; i++)
+  {
+    if(!(site = __atomic_load_n(&sites[i], __ATOMIC_ACQUIRE))) continue;
+    fprintf(fp, "  %p: ", site->site);
+    hist_print_summary(&site->hist, fp);
+  }
+  if(__atomic_load_n(&other_sites.hist.count, __ATOMIC_RELAXED))
+  {
+    fprintf(fp, "  other: ");
+    hist_print_summary(&other_sites.hist, fp);
+  }
+
+  fprintf(fp, "Response times by thread:\n");
+  stats = __atomic_load_n(&all_stats, __ATOMIC_ACQUIRE);
+  for(; stats; stats = stats->next)
+  {
+    fprintf(fp, "  %d: ", stats->tid);
+    hist_print_summary(&stats->hist, fp);
+    for(i = 0; i < MAX_MIGRATE_REASONS; i++)
+      if(stats->reasons[i])
+        fprintf(fp, "    reason %lu: %lu\n", i, stats->reasons[i]);
+  }
+}
 
 /* Output response time statistics. */
 // Note: destructor should only be called by one thread and is therefore
 // thread-safe.
 static void __attribute__((destructor)) __print_response_timing()
 {
-  unsigned long i;
-  printf("Number of migration triggers: %lu\nResponse times:\n", num_triggers);
-  for(i = 0; i < num_triggers; i++) printf("  %llu ns\n", response_timings[i]);
+  const char *fn = getenv(ENV_RESPONSE_FILE);
+  if(!fn || !*fn || migrate_dump_response_times(fn))
+    print_response_timing(stdout);
+}
+
+/* Dump response time statistics. */
+int migrate_dump_response_times(const char *fn)
+{
+  FILE *fp;
+
+  if(!fn)
+  {
+    print_response_timing(stdout);
+    return 0;
+  }
+  if(!(fp = fopen(fn, "w"))) return errno;
+  print_response_timing(fp);
+  fclose(fp);
+  return 0;
 }
 
 #endif /* _TIME_RESPONSE_DELAY */
 
 /*
- * Reset the migrate flag when the thread has entered the migration library to
- * avoid continuously attempting migration.
+ * Reset the calling thread's migrate flag when the thread has entered the
+ * migration library to avoid continuously attempting migration.
  */
 void clear_migrate_flag()
 {
 #if _TIME_RESPONSE_DELAY == 1
-  unsigned long end, idx;
-  if(start != UINT64_MAX)
+  unsigned long long end;
+  if(request.start != UINT64_MAX)
   {
     TIMESTAMP(end);
-    idx = __sync_fetch_and_add(&num_triggers, 1);
-    if(idx >= 1024) fprintf(stderr, "WARNING: too many response timings!\n");
-    else response_timings[idx] = TIMESTAMP_DIFF(start, end);
-    start = UINT64_MAX;
+    record_response(TIMESTAMP_DIFF(request.start, end), request.reason,
+                    request.site);
   }
   else fprintf(stderr, "WARNING: no starting time stamp");
 #endif
 
+  request.start = UINT64_MAX;
+  request.reason = 0;
   __migrate_flag = -1;
+  status_propose(-1);
+}
+
+/* Record the migration point through which the thread entered the library. */
+void set_migration_point(void *site)
+{
+  request.site = site;
 }
 
 /*
- * Handle OS thread migration request.  Communicate to a thread that it should
- * begin the migration process to another node.
+ * Handle OS thread migration request.  Communicate to the signalled thread
+ * (and only that thread) that it should begin the migration process to
+ * another node.  Requests sent with migrate_request() carry the destination
+ * node & reason; otherwise, the thread is requested to migrate to node 1.
  */
 static void __migrate_sighandler(int sig, siginfo_t *info, void *args)
 {
+  int nid = 1, reason = 0;
+
   // Avoid accidentally triggering this again, which can screw up calculating
   // migration response time.
   if(__migrate_flag >= 0) return;
 
+  if(info && info->si_code == SI_QUEUE)
+  {
+    nid = REQUEST_NID(info->si_value.sival_int);
+    reason = REQUEST_REASON(info->si_value.sival_int);
+  }
+
 #if _TIME_RESPONSE_DELAY == 1
-  TIMESTAMP(start);
+  TIMESTAMP(request.start);
 #endif
+  request.reason = reason;
+
   // The compiler can instrument code so that threads check this flag during
   // execution to decide whether to call into the migration library.
-  // TODO this needs to be set according to the what the OS tells us (maybe in
-  // the args argument?)
-  __migrate_flag = 1;
+  __migrate_flag = nid;
+  status_propose(nid);
 
   // Tell the OS we're requesting this thread migrate.
   // TODO in the real version, the OS should *know* that the thread is to be
   // migrated and does not need to be told.
-  if(syscall(SYS_propose_migration, 0, 1))
+  if(syscall(SYS_propose_migration, 0, nid))
     perror("Could not propose the migration destination for the thread");
 }
 
 /*
  * Register a signal handler to be called when the OS wants a thread to migrate
- * to a new architecture.  
+ * to a new architecture.
  */
 static void __attribute__((constructor)) __register_migrate_sighandler()
 {
@@ -110,5 +274,41 @@ static void __attribute__((constructor)) __register_migrate_sighandler()
     perror("Could not register migration trigger signal handler");
 }
 
+/* Request a single thread migrate by signalling it. */
+int migrate_request(pid_t tid, int nid, int reason)
+{
+  siginfo_t info;
+
+  if(!node_available(nid) || reason < 0 || reason > REQUEST_MAX_REASON)
+    return EINVAL;
+
+  memset(&info, 0, sizeof(siginfo_t));
+  info.si_signo = MIGRATE_SIGNAL;
+  info.si_code = SI_QUEUE;
+  info.si_pid = getpid();
+  info.si_uid = getuid();
+  info.si_value.sival_int = REQUEST_VALUE(nid, reason);
+  if(syscall(SYS_rt_tgsigqueueinfo, getpid(), tid, MIGRATE_SIGNAL, &info))
+    return errno;
+  return 0;
+}
+
+#else /* _SIG_MIGRATION */
+
+/* Requests can't be delivered without signal-triggered migration. */
+int migrate_request(pid_t tid, int nid, int reason)
+{
+  return ENOSYS;
+}
+
 #endif /* _SIG_MIGRATION */
 
+#if _SIG_MIGRATION == 0 || _TIME_RESPONSE_DELAY == 0
+
+/* Response times are only collected for signal-triggered migrations. */
+int migrate_dump_response_times(const char *fn)
+{
+  return ENOSYS;
+}
+
+#endif
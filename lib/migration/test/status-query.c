@@ -0,0 +1,104 @@
+/*
+ * Benchmark comparing the cost of querying the calling thread's node & status
+ * from the kernel against reading the runtime's published status area.
+ * Reports the average cost per call of each query.
+ *
+ * Usage: ./status-query [iterations]
+ *
+ * Date: 10/16/2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "arch.h"
+#include "platform.h"
+#include "migrate.h"
+
+static long iterations = 10000000;
+
+/* Prevent the compiler from eliding queries. */
+static volatile int sink;
+
+static inline unsigned long elapsed(struct timespec* start,
+                                    struct timespec* end)
+{
+  return (end->tv_sec * 1000000000 + end->tv_nsec) -
+         (start->tv_sec * 1000000000 + start->tv_nsec);
+}
+
+static double time_syscall_nid(void)
+{
+  long i;
+  struct timespec start, end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(i = 0; i < iterations; i++) sink = popcorn_getnid();
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (double)elapsed(&start, &end) / iterations;
+}
+
+static double time_syscall_status(void)
+{
+  long i;
+  struct popcorn_thread_status status;
+  struct timespec start, end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(i = 0; i < iterations; i++)
+  {
+    popcorn_getthreadinfo(&status);
+    sink = status.proposed_nid;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (double)elapsed(&start, &end) / iterations;
+}
+
+static double time_current_nid(void)
+{
+  long i;
+  struct timespec start, end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(i = 0; i < iterations; i++) sink = current_nid();
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (double)elapsed(&start, &end) / iterations;
+}
+
+static double time_current_arch(void)
+{
+  long i;
+  struct timespec start, end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(i = 0; i < iterations; i++) sink = current_arch();
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (double)elapsed(&start, &end) / iterations;
+}
+
+/* Migration points with no pending proposal, i.e., the common case. */
+static double time_check_migrate(void)
+{
+  long i;
+  struct timespec start, end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(i = 0; i < iterations; i++) check_migrate(NULL, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (double)elapsed(&start, &end) / iterations;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc > 1) iterations = atol(argv[1]);
+  if(iterations < 1) iterations = 1;
+
+  printf("popcorn_getnid():        %.1f ns/call\n", time_syscall_nid());
+  printf("popcorn_getthreadinfo(): %.1f ns/call\n", time_syscall_status());
+  printf("current_nid():           %.1f ns/call\n", time_current_nid());
+  printf("current_arch():          %.1f ns/call\n", time_current_arch());
+  printf("check_migrate():         %.1f ns/call\n", time_check_migrate());
+
+  return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * Benchmark comparing a team of threads migrating independently against
+ * migrating together with migrate_team().  Each iteration migrates all threads
+ * to the destination node & back to the origin, and reports the time between
+ * releasing the threads & the last thread arriving at the destination.
+ *
+ * Usage: ./team-migrate [threads] [node] [iterations]
+ *
+ * Date: 10/16/2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "migrate.h"
+
+static int num_threads = 16;
+static int nid = 1;
+static int iterations = 10;
+
+static pthread_barrier_t start, end;
+static struct migrate_team team;
+
+/*
+ * Whether threads migrate as a team in the current phase.  Only changed by
+ * the main thread between phases, & read by threads after the start barrier.
+ */
+static volatile int use_team = 0;
+
+static inline unsigned long elapsed(struct timespec* start,
+                                    struct timespec* end)
+{
+  return (end->tv_sec * 1000000000 + end->tv_nsec) -
+         (start->tv_sec * 1000000000 + start->tv_nsec);
+}
+
+static inline void move(int together, int dest)
+{
+  if(together) migrate_team(&team, dest, NULL, NULL);
+  else migrate(dest, NULL, NULL);
+}
+
+static void *thread_main(void *args)
+{
+  int i, together;
+
+  for(i = 0; i < iterations * 2; i++)
+  {
+    pthread_barrier_wait(&start);
+    together = use_team;
+    move(together, nid);
+    pthread_barrier_wait(&end);
+    move(together, 0);
+  }
+  return NULL;
+}
+
+/* Migrate all threads to the destination & back ITERATIONS times. */
+static unsigned long run(void)
+{
+  int i;
+  struct timespec t_start, t_end;
+  unsigned long total = 0;
+
+  for(i = 0; i < iterations; i++)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    pthread_barrier_wait(&start);
+    pthread_barrier_wait(&end);
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    total += elapsed(&t_start, &t_end);
+  }
+  return total / iterations;
+}
+
+int main(int argc, char **argv)
+{
+  int i;
+  pthread_t *threads;
+  unsigned long single, together;
+
+  if(argc > 1) num_threads = atoi(argv[1]);
+  if(argc > 2) nid = atoi(argv[2]);
+  if(argc > 3) iterations = atoi(argv[3]);
+  if(num_threads < 1) num_threads = 1;
+  if(iterations < 1) iterations = 1;
+
+  if(!node_available(nid))
+  {
+    fprintf(stderr, "Node %d is not available\n", nid);
+    return 1;
+  }
+
+  if(!(threads = malloc(sizeof(pthread_t) * num_threads)))
+  {
+    fprintf(stderr, "Could not allocate threads\n");
+    return 1;
+  }
+
+  // Note: the main thread only times the threads, it doesn't migrate
+  pthread_barrier_init(&start, NULL, num_threads + 1);
+  pthread_barrier_init(&end, NULL, num_threads + 1);
+  if(migrate_team_init(&team, num_threads))
+  {
+    fprintf(stderr, "Could not initialize team\n");
+    return 1;
+  }
+
+  for(i = 0; i < num_threads; i++)
+  {
+    if(pthread_create(&threads[i], NULL, thread_main, NULL))
+    {
+      fprintf(stderr, "Could not spawn thread %d\n", i);
+      return 1;
+    }
+  }
+
+  single = run();
+  use_team = 1;
+  together = run();
+
+  for(i = 0; i < num_threads; i++) pthread_join(threads[i], NULL);
+
+  printf("Independent migration (%d threads): %lu ns\n", num_threads, single);
+  printf("Team migration (%d threads): %lu ns\n", num_threads, together);
+
+  migrate_team_destroy(&team);
+  pthread_barrier_destroy(&end);
+  pthread_barrier_destroy(&start);
+  free(threads);
+  return 0;
+}
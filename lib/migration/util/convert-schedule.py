@@ -0,0 +1,94 @@
+#!/usr/bin/python3
+
+'''
+Convert a text thread schedule into the binary format mapped by the migration
+library (see include/mapping.h).  Text schedules contain one region per line:
+
+  <region #> <# entries> <PTID 0 node> ... <PTID N node>
+
+where the region number may be -1 for the default mapping.
+'''
+
+import sys, os, struct
+
+###############################################################################
+# Config
+###############################################################################
+
+MAGIC = b"POPSCHED"
+VERSION = 1
+EMPTY = 0xffffffff
+HASH_MULT = 0x9e3779b97f4a7c15
+MASK64 = (1 << 64) - 1
+
+###############################################################################
+# Utility functions
+###############################################################################
+
+def printHelp():
+	print("convert-schedule.py: convert a text thread schedule to binary\n")
+
+	print("Usage: ./convert-schedule.py <text schedule> <binary schedule>")
+
+# Must match schedule_hash() in include/mapping.h
+def scheduleHash(region, numSlots):
+	return ((region * HASH_MULT) & MASK64) >> (64 - (numSlots.bit_length() - 1))
+
+# Parse a text schedule into a list of (region, [nodes]) tuples.  As with the
+# migration library, the first line for a region wins.
+def parseSchedule(textFile):
+	regions = []
+	seen = set()
+	tokens = open(textFile, 'r').read().split()
+	i = 0
+	while i < len(tokens):
+		if i + 2 > len(tokens):
+			raise ValueError("invalid thread mapping format")
+		region = int(tokens[i]) & MASK64
+		num = int(tokens[i + 1])
+		nodes = [ int(node) for node in tokens[i + 2:i + 2 + num] ]
+		if len(nodes) != num:
+			raise ValueError("not enough node mappings for region {}".format(
+				tokens[i]))
+		if region not in seen:
+			regions.append((region, nodes))
+			seen.add(region)
+		i += 2 + num
+	return sorted(regions)
+
+def writeSchedule(regions, binFile):
+	numSlots = 2
+	while numSlots < len(regions) * 2: numSlots <<= 1
+	slots = [ (0, EMPTY, 0) ] * numSlots
+	nodes = []
+
+	for region, mapping in regions:
+		idx = scheduleHash(region, numSlots)
+		while slots[idx][1] != EMPTY: idx = (idx + 1) & (numSlots - 1)
+		slots[idx] = (region, len(nodes), len(mapping))
+		nodes.extend(mapping)
+
+	with open(binFile, 'wb') as fp:
+		fp.write(struct.pack("<8sIIQ", MAGIC, VERSION, numSlots, len(nodes)))
+		for slot in slots: fp.write(struct.pack("<QII", *slot))
+		fp.write(struct.pack("<{}i".format(len(nodes)), *nodes))
+
+###############################################################################
+# Driver
+###############################################################################
+
+if __name__ == "__main__":
+	if len(sys.argv) != 3 or sys.argv[1] in ("-h", "--help"):
+		printHelp()
+		sys.exit(0 if len(sys.argv) == 2 else 1)
+
+	try: regions = parseSchedule(sys.argv[1])
+	except (IOError, ValueError) as e:
+		print("Could not parse '{}': {}".format(sys.argv[1], e))
+		sys.exit(1)
+
+	# Note: write to a temporary file & rename so applications reloading the
+	# schedule never see a partially-written file
+	tmpFile = sys.argv[2] + ".tmp"
+	writeSchedule(regions, tmpFile)
+	os.rename(tmpFile, sys.argv[2])
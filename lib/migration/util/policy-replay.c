@@ -0,0 +1,204 @@
+/*
+ * Replay a migration policy trace (recorded by setting MIGRATE_POLICY_TRACE)
+ * through the built-in policies to evaluate them offline.  Each thread is
+ * simulated independently: the time between migration points is scaled by
+ * the relative work time of the node a policy would have placed the thread on
+ * versus the node on which it was recorded, and each migration adds the
+ * estimated migration cost.
+ *
+ * Usage: ./policy-replay <trace> [policy...]
+ *
+ * Date: 10/16/2026
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "migrate.h"
+#include "policy.h"
+
+/* Maximum number of threads simulated. */
+#define MAX_THREADS 4096
+
+static const struct migrate_policy *builtin[] = {
+  &migrate_policy_proposal,
+  &migrate_policy_cost_model,
+};
+
+/* A simulated thread. */
+struct sim_thread
+{
+  uint32_t tid;
+  int nid;
+  unsigned long long points;
+};
+
+/* Results of replaying a trace through a policy. */
+struct sim_result
+{
+  unsigned long long time;
+  unsigned long long migrations;
+  unsigned long long agreed;
+};
+
+static struct policy_trace_record *records = NULL;
+static size_t num_records = 0;
+
+static int read_trace(const char *fn)
+{
+  struct policy_trace_header header;
+  size_t capacity = 0;
+  FILE *fp;
+
+  if(!(fp = fopen(fn, "r")))
+  {
+    perror("Could not open trace");
+    return 1;
+  }
+  if(fread(&header, sizeof(header), 1, fp) != 1 ||
+     memcmp(header.magic, POLICY_TRACE_MAGIC, sizeof(header.magic)) ||
+     header.version != POLICY_TRACE_VERSION ||
+     header.record_size != sizeof(struct policy_trace_record))
+  {
+    fprintf(stderr, "'%s' is not a compatible migration policy trace\n", fn);
+    fclose(fp);
+    return 1;
+  }
+
+  while(1)
+  {
+    if(num_records == capacity)
+    {
+      capacity = capacity ? capacity * 2 : 1024;
+      records = realloc(records, capacity * sizeof(*records));
+      if(!records)
+      {
+        fprintf(stderr, "Could not allocate trace records\n");
+        fclose(fp);
+        return 1;
+      }
+    }
+    if(fread(&records[num_records], sizeof(*records), 1, fp) != 1) break;
+    num_records++;
+  }
+
+  fclose(fp);
+  return 0;
+}
+
+static struct sim_thread *get_thread(struct sim_thread *threads,
+                                     size_t *num_threads,
+                                     const struct policy_trace_record *rec)
+{
+  size_t i;
+
+  for(i = 0; i < *num_threads; i++)
+    if(threads[i].tid == rec->tid) return &threads[i];
+  if(*num_threads == MAX_THREADS) return NULL;
+
+  threads[i].tid = rec->tid;
+  threads[i].nid = rec->metrics.current_nid;
+  threads[i].points = 0;
+  (*num_threads)++;
+  return &threads[i];
+}
+
+/* Estimate the time to execute an interval recorded on one node on another. */
+static unsigned long long scale(const struct migrate_metrics *metrics, int nid)
+{
+  int recorded = metrics->current_nid;
+
+  if(nid == recorded || recorded < 0 || nid < 0 ||
+     !metrics->work_time[recorded] || !metrics->work_time[nid])
+    return metrics->since_point;
+  return (double)metrics->since_point * metrics->work_time[nid] /
+         metrics->work_time[recorded];
+}
+
+/*
+ * Replay the trace through a policy, or follow the recorded decisions if
+ * POLICY is NULL.
+ */
+static int replay(const struct migrate_policy *policy,
+                  struct sim_result *result)
+{
+  static struct sim_thread threads[MAX_THREADS];
+  struct migrate_metrics metrics;
+  struct sim_thread *thread;
+  size_t i, num_threads = 0;
+  int decision;
+
+  memset(result, 0, sizeof(*result));
+  for(i = 0; i < num_records; i++)
+  {
+    if(!(thread = get_thread(threads, &num_threads, &records[i])))
+    {
+      fprintf(stderr, "Too many threads in trace (maximum %d)\n", MAX_THREADS);
+      return 1;
+    }
+
+    metrics = records[i].metrics;
+    result->time += scale(&metrics, thread->nid);
+
+    metrics.current_nid = thread->nid;
+    metrics.points = thread->points;
+    if(policy) decision = policy->decide(&metrics, policy->data);
+    else decision = records[i].decision;
+    if(decision == records[i].decision) result->agreed++;
+
+    thread->points++;
+    if(decision >= 0 && decision < MIGRATE_MAX_NODES &&
+       decision != thread->nid && (metrics.available & (1UL << decision)))
+    {
+      result->time += metrics.migration_ns;
+      result->migrations++;
+      thread->nid = decision;
+      thread->points = 0;
+    }
+  }
+  return 0;
+}
+
+static void print_result(const char *name, const struct sim_result *result)
+{
+  printf("%-16s %12llu %16.3f %9.1f%%\n", name, result->migrations,
+         (double)result->time / 1000000.0,
+         num_records ? 100.0 * result->agreed / num_records : 100.0);
+}
+
+int main(int argc, char **argv)
+{
+  struct sim_result result;
+  size_t i;
+  int arg, found;
+
+  if(argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <trace> [policy...]\n", argv[0]);
+    return 1;
+  }
+  if(read_trace(argv[1])) return 1;
+
+  printf("Replaying %zu decisions\n", num_records);
+  printf("%-16s %12s %16s %10s\n",
+         "Policy", "Migrations", "Est. time (ms)", "Agreement");
+
+  if(replay(NULL, &result)) return 1;
+  print_result("recorded", &result);
+
+  for(i = 0; i < sizeof(builtin) / sizeof(builtin[0]); i++)
+  {
+    if(argc > 2)
+    {
+      for(found = 0, arg = 2; arg < argc; arg++)
+        if(!strcmp(argv[arg], builtin[i]->name)) found = 1;
+      if(!found) continue;
+    }
+    if(replay(builtin[i], &result)) return 1;
+    print_result(builtin[i]->name, &result);
+  }
+
+  free(records);
+  return 0;
+}
@@ -222,6 +222,7 @@ int pthread_timedjoin_np(pthread_t, void **, const struct timespec *);
 
 void pthread_set_migrate_args(void *);
 void *pthread_get_migrate_args();
+int pthread_get_stack_bounds(void **, void **);
 
 #endif
 
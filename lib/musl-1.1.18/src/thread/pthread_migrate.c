@@ -1,6 +1,7 @@
 #include "pthread_impl.h"
 #include <threads.h>
 #include <pthread.h>
+#include <sys/resource.h>
 #include "libc.h"
 
 void pthread_set_migrate_args(void *args)
@@ -13,3 +14,37 @@ void *pthread_get_migrate_args()
   return __pthread_self()->popcorn_migrate_args;
 }
 
+/* Main thread's stack bounds, calculated on first use. */
+static void *main_stack_low, *main_stack_high;
+
+/*
+ * Get the calling thread's stack bounds.  Threads' bounds are recorded in the
+ * descriptor by pthread_create, so this never needs to parse /proc/self/maps
+ * or probe mappings.  The main thread's stack grows on demand, so its bounds
+ * span the stack size limit below the auxiliary vector.
+ */
+int pthread_get_stack_bounds(void **low, void **high)
+{
+  struct pthread *self = __pthread_self();
+  struct rlimit rlim;
+  char *p;
+  size_t size;
+
+  if (self->stack) {
+    *high = self->stack;
+    *low = (char *)self->stack - self->stack_size;
+    return 0;
+  }
+
+  if (!main_stack_high) {
+    if (getrlimit(RLIMIT_STACK, &rlim)) return -1;
+    p = (void *)libc.auxv;
+    p += -(uintptr_t)p & PAGE_SIZE-1;
+    size = rlim.rlim_cur == RLIM_INFINITY ? DEFAULT_STACK_SIZE : rlim.rlim_cur;
+    main_stack_low = p - size;
+    main_stack_high = p;
+  }
+  *low = main_stack_low;
+  *high = main_stack_high;
+  return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * Per-thread alternate stacks for userspace rewriting.  Each thread has two
+ * lazily-mmapped stacks, one of which it runs on after migrating; the other
+ * is (re)used as the destination of its next migration.
+ *
+ * Date: 10/16/2026
+ */
+
+#ifndef _ALT_STACK_H
+#define _ALT_STACK_H
+
+#include "stack_transform.h"
+#include "definitions.h"
+
+/*
+ * Get a destination stack of at least SIZE bytes (plus ALT_STACK_HEADROOM)
+ * for the calling thread, which is currently executing on stack pointer SP.
+ * The returned stack is never the one containing SP.  Suitable for passing to
+ * st_rewrite_stack_alloc().
+ *
+ * @param size the size of the rewritten stack, in bytes
+ * @param sp the calling thread's current stack pointer
+ * @return the base (highest address) of the destination stack, or NULL if it
+ *         could not be allocated
+ */
+void* alt_stack_alloc(size_t size, void* sp);
+
+/*
+ * Get the bounds of the calling thread's alternate stack containing SP.
+ *
+ * @param sp a stack pointer
+ * @param bounds filled with the alternate stack's bounds if found
+ * @return true if SP is on one of the thread's alternate stacks, false
+ *         otherwise
+ */
+bool alt_stack_bounds(void* sp, stack_bounds* bounds);
+
+#endif /* _ALT_STACK_H */
@@ -0,0 +1,246 @@
+/*
+ * Inline aarch64 register access & stack property operations.  Used to build
+ * the aarch64 register operations & properties tables, and called directly
+ * by rewriting kernels specialized for aarch64 so they can be inlined.
+ *
+ * Date: 10/16/2026
+ */
+
+#ifndef _AARCH64_OPS_H
+#define _AARCH64_OPS_H
+
+#include "definitions.h"
+#include "arch/aarch64/regs.h"
+
+#define AARCH64_FBP_REG X29
+#define AARCH64_LINK_REG X30
+#define AARCH64_STACK_ALIGNMENT 0x10
+
+///////////////////////////////////////////////////////////////////////////////
+// aarch64 register access
+///////////////////////////////////////////////////////////////////////////////
+
+static inline void regset_clone_aarch64(const void* src, void* dest)
+{
+  const struct regset_aarch64* srcregs = (const struct regset_aarch64*)src;
+  struct regset_aarch64* destregs = (struct regset_aarch64*)dest;
+  *destregs = *srcregs;
+}
+
+static inline void* pc_aarch64(const void* regset)
+{
+  const struct regset_aarch64* cur = (const struct regset_aarch64*)regset;
+  return cur->pc;
+}
+
+static inline void* sp_aarch64(const void* regset)
+{
+  const struct regset_aarch64* cur = (const struct regset_aarch64*)regset;
+  return cur->sp;
+}
+
+static inline void* fbp_aarch64(const void* regset)
+{
+  const struct regset_aarch64* cur = (const struct regset_aarch64*)regset;
+  return (void*)cur->x[AARCH64_FBP_REG];
+}
+
+static inline void* ra_reg_aarch64(const void* regset)
+{
+  const struct regset_aarch64* cur = (const struct regset_aarch64*)regset;
+  return (void*)cur->x[AARCH64_LINK_REG];
+}
+
+static inline void set_pc_aarch64(void* regset, void* pc)
+{
+  struct regset_aarch64* cur = (struct regset_aarch64*)regset;
+  cur->pc = pc;
+}
+
+static inline void set_sp_aarch64(void* regset, void* sp)
+{
+  struct regset_aarch64* cur = (struct regset_aarch64*)regset;
+  cur->sp = sp;
+}
+
+static inline void set_fbp_aarch64(void* regset, void* fp)
+{
+  struct regset_aarch64* cur = (struct regset_aarch64*)regset;
+  cur->x[AARCH64_FBP_REG] = (uint64_t)fp;
+}
+
+static inline void set_ra_reg_aarch64(void* regset, void* ra)
+{
+  struct regset_aarch64* cur = (struct regset_aarch64*)regset;
+  cur->x[AARCH64_LINK_REG] = (uint64_t)ra;
+}
+
+static inline void setup_fbp_aarch64(void* regset, void* cfa)
+{
+  ASSERT(cfa, "Null canonical frame address\n");
+  struct regset_aarch64* cur = (struct regset_aarch64*)regset;
+  cur->x[AARCH64_FBP_REG] = (uint64_t)cfa - 0x10;
+}
+
+static inline uint16_t reg_size_aarch64(uint16_t reg)
+{
+  switch(reg)
+  {
+  /* General-purpose registers */
+  case X0: case X1: case X2: case X3: case X4: case X5: case X6:
+  case X7: case X8: case X9: case X10: case X11: case X12: case X13:
+  case X14: case X15: case X16: case X17: case X18: case X19: case X20:
+  case X21: case X22: case X23: case X24: case X25: case X26: case X27:
+  case X28: case X29: case X30: case SP:
+    return sizeof(uint64_t);
+
+  /* Floating-point registers */
+  case V0: case V1: case V2: case V3: case V4: case V5: case V6:
+  case V7: case V8: case V9: case V10: case V11: case V12: case V13:
+  case V14: case V15: case V16: case V17: case V18: case V19: case V20:
+  case V21: case V22: case V23: case V24: case V25: case V26: case V27:
+  case V28: case V29: case V30: case V31:
+    return sizeof(unsigned __int128);
+
+  default: break;
+  }
+
+  ST_ERR(1, "unknown/invalid register %d (aarch64)\n", reg);
+  return 0;
+}
+
+static inline void* reg_aarch64(void* regset, uint16_t reg)
+{
+  struct regset_aarch64* cur = (struct regset_aarch64*)regset;
+
+  switch(reg)
+  {
+  case X0: return &cur->x[0];
+  case X1: return &cur->x[1];
+  case X2: return &cur->x[2];
+  case X3: return &cur->x[3];
+  case X4: return &cur->x[4];
+  case X5: return &cur->x[5];
+  case X6: return &cur->x[6];
+  case X7: return &cur->x[7];
+  case X8: return &cur->x[8];
+  case X9: return &cur->x[9];
+  case X10: return &cur->x[10];
+  case X11: return &cur->x[11];
+  case X12: return &cur->x[12];
+  case X13: return &cur->x[13];
+  case X14: return &cur->x[14];
+  case X15: return &cur->x[15];
+  case X16: return &cur->x[16];
+  case X17: return &cur->x[17];
+  case X18: return &cur->x[18];
+  case X19: return &cur->x[19];
+  case X20: return &cur->x[20];
+  case X21: return &cur->x[21];
+  case X22: return &cur->x[22];
+  case X23: return &cur->x[23];
+  case X24: return &cur->x[24];
+  case X25: return &cur->x[25];
+  case X26: return &cur->x[26];
+  case X27: return &cur->x[27];
+  case X28: return &cur->x[28];
+  case X29: return &cur->x[29];
+  case X30: return &cur->x[30];
+  case SP: return &cur->sp;
+  case V0: return &cur->v[0];
+  case V1: return &cur->v[1];
+  case V2: return &cur->v[2];
+  case V3: return &cur->v[3];
+  case V4: return &cur->v[4];
+  case V5: return &cur->v[5];
+  case V6: return &cur->v[6];
+  case V7: return &cur->v[7];
+  case V8: return &cur->v[8];
+  case V9: return &cur->v[9];
+  case V10: return &cur->v[10];
+  case V11: return &cur->v[11];
+  case V12: return &cur->v[12];
+  case V13: return &cur->v[13];
+  case V14: return &cur->v[14];
+  case V15: return &cur->v[15];
+  case V16: return &cur->v[16];
+  case V17: return &cur->v[17];
+  case V18: return &cur->v[18];
+  case V19: return &cur->v[19];
+  case V20: return &cur->v[20];
+  case V21: return &cur->v[21];
+  case V22: return &cur->v[22];
+  case V23: return &cur->v[23];
+  case V24: return &cur->v[24];
+  case V25: return &cur->v[25];
+  case V26: return &cur->v[26];
+  case V27: return &cur->v[27];
+  case V28: return &cur->v[28];
+  case V29: return &cur->v[29];
+  case V30: return &cur->v[30];
+  case V31: return &cur->v[31];
+  /*
+   * TODO:
+   *   33: ELR_mode
+   */
+  default: break;
+  }
+
+  ST_ERR(1, "unknown/invalid register %u (aarch64)\n", reg);
+  return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// aarch64 stack properties
+///////////////////////////////////////////////////////////////////////////////
+
+static inline void* align_sp_aarch64(void* sp)
+{
+  /*
+   * Per the AArch64 ABI:
+   *   "Additionally, at any point at which memory is accessed via SP, the
+   *    hardware requires that
+   *      - SP mod 16 = 0. The stack must be quad-word aligned."
+   */
+  return sp -
+    (AARCH64_STACK_ALIGNMENT - ((uint64_t)sp % AARCH64_STACK_ALIGNMENT));
+}
+
+static inline bool is_callee_saved_aarch64(uint16_t reg)
+{
+  switch(reg)
+  {
+  /* General-purpose registers x19-x28 */
+  case X19: case X20: case X21: case X22: case X23: case X24:
+  case X25: case X26: case X27: case X28: case X29: case X30:
+    return true;
+
+  /* Floating-point registers v8-v15 */
+  case V8: case V9: case V10: case V11: case V12: case V13: case V14: case V15:
+    return true;
+
+  default: return false;
+  }
+}
+
+static inline uint16_t callee_reg_size_aarch64(uint16_t reg)
+{
+  switch(reg)
+  {
+  /* General-purpose registers x19-x28 */
+  case X19: case X20: case X21: case X22: case X23: case X24:
+  case X25: case X26: case X27: case X28: case X29: case X30:
+    return 8;
+
+  /* Floating-point/SIMD (only least-significant 64-bits) */
+  case V8: case V9: case V10: case V11: case V12: case V13: case V14: case V15:
+    return 8;
+
+  default: break;
+  }
+
+  ST_ERR(1, "unknown/invalid register %u (aarch64)\n", reg);
+  return 0;
+}
+
+#endif /* _AARCH64_OPS_H */
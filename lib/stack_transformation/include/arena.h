@@ -0,0 +1,55 @@
+/*
+ * Per-thread arena of rewriting contexts.  Contexts & their per-frame pools
+ * are allocated on a thread's first rewrite, grow with the deepest stack
+ * rewritten by the thread and are reset rather than freed between rewrites.
+ *
+ * Date: 10/16/2026
+ */
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include "definitions.h"
+
+/*
+ * Get an unused rewriting context from the calling thread's arena.  The
+ * context's activations & per-frame pools can hold at least ARENA_INIT_FRAMES
+ * frames and its fixup index is empty, but all other fields must be
+ * initialized by the caller.
+ *
+ * @param handle the stack transformation handle for the context
+ * @return a rewriting context, or NULL if one could not be allocated
+ */
+rewrite_context arena_get_context(st_handle handle);
+
+/*
+ * Return a rewriting context to the calling thread's arena.  Storage is kept
+ * for the thread's next rewrite.
+ *
+ * @param ctx a rewriting context obtained from arena_get_context()
+ */
+void arena_put_context(rewrite_context ctx);
+
+/*
+ * Grow a context's activations & per-frame pools to hold at least NUM_FRAMES
+ * frames, doubling their size.  Activations which have already been set up
+ * are moved to the new pools, so pointers to activations must not be held
+ * across calls which may pop frames.
+ *
+ * @param ctx a rewriting context
+ * @param num_frames the number of frames the pools must hold
+ */
+void arena_grow_pools(rewrite_context ctx, int num_frames);
+
+/*
+ * Get the calling thread's cache of the last call chain it unwound for a pair
+ * of handles.  If there is none, the least-recently used cache is emptied &
+ * returned.
+ *
+ * @param src the source stack transformation handle
+ * @param dest the destination stack transformation handle
+ * @return the thread's unwinding cache, or NULL if it could not be allocated
+ */
+unwind_cache* arena_get_unwind_cache(st_handle src, st_handle dest);
+
+#endif /* _ARENA_H */
@@ -57,9 +57,95 @@
 #endif
 
 /*
- * Maximum number of frames that can be rewritten.
+ * Initial number of pointer-to-stack fixup records held by a rewriting
+ * context, grown as needed.
  */
-#define MAX_FRAMES 512
+#define FIXUP_POOL 256
+
+/*
+ * Number of rewriting contexts in each thread's arena (a pair for a rewrite
+ * and a pair for a pending on-demand rewrite), and the number of frames their
+ * activation & per-frame pools initially hold.  Pools double in size as
+ * needed, so there is no limit on the number of frames that can be rewritten
+ * other than available memory.  They are kept for the thread's next rewrite.
+ */
+#define ARENA_CONTEXTS 4
+#define ARENA_INIT_FRAMES 32
+
+/*
+ * Rewrite frames lazily as the thread returns into them rather than rewriting
+ * the entire stack at migration time (userspace rewriting only).  Requires
+ * compiler TLS.
+ */
+//#define _ON_DEMAND 1
+
+/*
+ * Load metadata by mapping the binary read-only and pointing directly into the
+ * stack transformation sections, rather than reading them through libELF.
+ * Pages are shared between processes & only faulted in when touched.  Falls
+ * back to libELF if the binary can't be parsed directly or if the environment
+ * variable below is set.
+ */
+#define _MMAP_METADATA 1
+#define ENV_NO_MMAP "ST_NO_MMAP"
+
+/*
+ * Build cache-friendly indexes over call site return addresses & IDs at
+ * initialization.  Keys are stored in Eytzinger (breadth-first) order separate
+ * from the packed call site records, making lookups branch-free and
+ * prefetchable.  Otherwise, call sites are binary searched in-place.
+ */
+#define _SITE_INDEX 1
+
+/*
+ * Number of Eytzinger index nodes ahead of the current node to prefetch when
+ * searching, i.e., 4 levels of the implicit tree.
+ */
+#define SITE_INDEX_PREFETCH 16
+
+/*
+ * On the first rewrite between two binaries, build a table translating every
+ * source call site directly to its destination call site and a flat list of
+ * matched live value copies.  Otherwise, look up the destination call site
+ * and match live value records for every frame.
+ */
+#define _SITE_PAIRS 1
+
+/*
+ * Remember the call chain of the last stack unwound by each thread for a
+ * given pair of binaries.  If the thread migrates again from the same call
+ * path, frames are matched by return address against the cached chain rather
+ * than looking up their call sites.
+ */
+#define _UNWIND_CACHE 1
+
+/*
+ * Number of call chains cached per thread, e.g., one for each direction a
+ * thread migrates in.
+ */
+#define UNWIND_CACHE_CHAINS 4
+
+/*
+ * Instantiate the per-frame unwinding & live value copying operations for
+ * every pair of source & destination ISAs, calling each ISA's register
+ * operations directly so they can be inlined rather than through the
+ * handles' function pointer tables.  The generic operations can be selected
+ * at runtime by setting the environment variable below, e.g., to compare
+ * performance.
+ */
+#define _REWRITE_KERNELS 1
+#define ENV_NO_KERNELS "ST_NO_KERNELS"
+
+/*
+ * Statistics about rewrites (see st_get_stats()) are kept in per-thread
+ * counters and are always compiled in.  They can be disabled at runtime by
+ * setting the first environment variable below.  If the second names a file,
+ * the last STATS_RING_RECORDS rewrites are kept in a ring buffer & written to
+ * the file at exit.
+ */
+#define ENV_NO_STATS "ST_NO_STATS"
+#define ENV_STATS_FILE "ST_STATS_FILE"
+#define STATS_RING_RECORDS 4096
 
 /*
  * Default character buffer size.
@@ -89,11 +175,32 @@
 #define ENV_X86_64_BIN "ST_X86_64_BIN"
 
 /*
- * Stack limits -- Linux defaults to 8MB.
+ * Environment variable which, if set, initializes rewriting handles for all
+ * ISAs at startup rather than on the first rewrite involving each ISA.  Useful
+ * for latency-sensitive migrations.
+ */
+#define ENV_EAGER_INIT "ST_EAGER_INIT"
+
+/*
+ * Stack limits -- Linux defaults to 8MB.  By default, each thread's stack is
+ * divided in half & rewritten into the opposite half.
  */
 #define MAX_STACK_SIZE (8UL * 1024UL * 1024UL)
 #define B_STACK_OFFSET (4 * 1024 * 1024)
 
+/*
+ * Rather than dividing thread stacks in half, rewrite into a per-thread
+ * alternate stack which is mmapped on the first migration & sized for the
+ * rewritten stack plus ALT_STACK_HEADROOM bytes for the thread to keep
+ * running.  Each thread keeps two alternate stacks -- the one it runs on after
+ * migrating and the one it migrated off of, which is reused (or resized) by
+ * the next migration.  Threads can then be created with small stacks, as they
+ * no longer need room for two copies of the stack.  Not compatible with
+ * on-demand rewriting.
+ */
+//#define _ALT_STACK 1
+#define ALT_STACK_HEADROOM (1024UL * 1024UL)
+
 #endif /* _CONFIG_H */
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -108,3 +215,7 @@
 # error Must define _TIMING to enable fine-grained timing (_FINE_GRAINED_TIMING)!
 #endif
 
+#if defined(_ALT_STACK) && defined(_ON_DEMAND)
+# error Alternate stacks (_ALT_STACK) do not support on-demand rewriting (_ON_DEMAND)!
+#endif
+
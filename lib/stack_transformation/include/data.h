@@ -31,6 +31,24 @@ void put_val(rewrite_context src,
              rewrite_context dest,
              const live_value* dest_val);
 
+/*
+ * Copy a run of SIZE bytes of contiguous stack slots starting at SRC_VAL in
+ * the source context to the slots starting at DEST_VAL in the destination
+ * context.  This function implicitly uses the current stack frame in the
+ * source & destination rewriting context.
+ *
+ * @param src the source rewriting context
+ * @param src_val the first live value's location in the source context
+ * @param dest the destination rewriting context
+ * @param dest_val the first live value's location in the destination context
+ * @param size the number of bytes spanned by the run
+ */
+void put_val_run(rewrite_context src,
+                 const live_value* src_val,
+                 rewrite_context dest,
+                 const live_value* dest_val,
+                 size_t size);
+
 /*
  * Put an architecture-specific constant value into a location.  This function
  * implicitly uses the current stack frame in the rewriting context.
@@ -67,23 +85,14 @@ void* points_to_stack(const rewrite_context ctx,
                       const live_value* val);
 
 /*
- * Return whether or not a pointer refers to the specified live value in the
- * rewriting context.  If so, return the pointer's translated value for the
- * destination context.  If not, return NULL.
+ * Get the address of a stack allocation in the current frame of the rewriting
+ * context.
  *
- * @param src the source rewriting context
- * @param src_val the pointed-to live value on the source stack
- * @param dest the destination rewriting context
- * @param dest_val the pointed-to live value on the destination stack
- * @param src_ptr the source pointer which refers to the source stack
- * @return the translated pointer for the destination if src_ptr points to
- *         src_val, or NULL otherwise
+ * @param ctx a rewriting context
+ * @param val a stack allocation's metadata
+ * @return the address of the stack allocation
  */
-void* points_to_data(const rewrite_context src,
-                     const live_value* src_val,
-                     const rewrite_context dest,
-                     const live_value* dest_val,
-                     void* src_ptr);
+void* alloca_addr(const rewrite_context ctx, const live_value* val);
 
 /*
  * Set the return address in the current stack frame of a rewriting context.
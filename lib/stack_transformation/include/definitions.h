@@ -20,7 +20,6 @@
 #include "config.h"
 #include "retvals.h"
 #include "bitmap.h"
-#include "list.h"
 #include "timer.h"
 #include "regs.h"
 #include "properties.h"
@@ -127,6 +126,16 @@ extern FILE* __log;
 /* Get a value's size. */
 #define VAL_SIZE( val ) (val->is_alloca ? val->alloca_size : val->size)
 
+/* Account for data copied into a destination frame. */
+#ifdef _TIMING
+# define COUNT_BYTES( ctx, act, field, num ) (ctx)->acts[act].field += (num)
+#else
+# define COUNT_BYTES( ctx, act, field, num )
+#endif
+
+/* Account for work done by a rewrite, for the runtime's statistics. */
+#define TALLY( ctx, field, num ) (ctx)->tally.field += (num)
+
 /*
  * A fixup record for reifying pointers to the stack when pointed-to data is
  * found.
@@ -137,13 +146,89 @@ typedef struct fixup {
   const live_value* dest_loc; // pointer to reify on destination stack
 } fixup;
 
-/* List of fixup records. */
-define_list_type(fixup);
+/*
+ * Pending fixup records, sorted by pointed-to source address so the records
+ * pointing into a stack allocation can be found with a binary search.  Records
+ * added while rewriting a frame are appended to a separate pending array and
+ * merged in once the frame's pointed-to data has been copied.  Resolved
+ * records are marked by clearing their destination location & are compacted
+ * away at the next merge.
+ */
+typedef struct fixup_index {
+  fixup* sorted; // resolved & unresolved records, sorted by source address
+  size_t num_sorted, cap_sorted;
+  size_t num_resolved; // number of resolved records in the sorted array
+  fixup* pending; // unsorted records not yet merged into the sorted array
+  size_t num_pending, cap_pending;
+  bool heap_sorted, heap_pending; // whether storage was allocated on the heap
+} fixup_index;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Rewriting metadata
 ///////////////////////////////////////////////////////////////////////////////
 
+/* A pre-matched copy from a source to a destination live value record. */
+typedef struct copy_op
+{
+  const live_value* src;
+  const live_value* dest;
+
+  /*
+   * Number of operations (starting with this one) whose stack slots are
+   * contiguous in both frames & can be copied in bulk, and the number of
+   * bytes they span.  Only set for the first operation of a run.
+   */
+  uint16_t run_ops;
+  uint32_t run_bytes;
+} copy_op;
+
+/*
+ * A source call site translated to its destination call site.  Contains one
+ * copy operation per destination live value record (including duplicates).
+ */
+typedef struct site_pair
+{
+  const call_site* dest; /* destination call site, NULL if not translated */
+  const copy_op* ops; /* copy operations, dest->num_live of them */
+} site_pair;
+
+/*
+ * Table translating all call sites in a source binary to those in a
+ * destination binary.  Tables are kept in a list in the source handle and
+ * matched by the destination's generation as well as its address, as a
+ * destroyed handle's memory may be reused for a new handle.
+ */
+typedef struct site_pairs
+{
+  const struct _st_handle* dest; /* destination handle */
+  uint64_t dest_generation; /* destination handle's generation */
+  site_pair* pairs; /* indexed the same as the source's sites_addr */
+  copy_op* ops; /* storage for all copy operations */
+  struct site_pairs* next; /* table for another destination handle */
+} site_pairs;
+
+/* A frame in a cached call chain. */
+typedef struct cached_frame
+{
+  void* pc; /* return address (program counter for the outermost frame) */
+  int64_t src_idx; /* index of source call site in sites_addr */
+  const call_site* dest; /* destination call site */
+} cached_frame;
+
+/*
+ * The shape of the last call chain unwound by a thread for a pair of handles,
+ * used to skip call site lookups when the thread migrates again from the same
+ * call path.
+ */
+typedef struct unwind_cache
+{
+  const struct _st_handle* src, *dest; /* handles used for the rewrite */
+  int num_acts; /* number of frames in the call chain */
+  int cap; /* capacity of the frames array */
+  cached_frame* frames; /* frames, from outermost to innermost */
+  uint64_t last_used; /* when the cache was last used, for replacement */
+} unwind_cache;
+
 /* A call frame activation and unwinding information. */
 typedef struct activation
 {
@@ -151,6 +236,11 @@ typedef struct activation
   void* cfa; /* canonical frame address */
   void* regs; /* register values */
   bitmap callee_saved; /* callee-saved registers stored in prologue */
+  const copy_op* ops; /* pre-matched live values (source only, may be NULL) */
+#ifdef _TIMING
+  size_t bytes_moved; /* bytes copied into the frame (destination only) */
+  size_t bytes_bulk; /* bytes copied into the frame in bulk */
+#endif
 } activation;
 
 /*
@@ -164,7 +254,10 @@ struct _st_handle
   /////////////////////////////////////////////////////////////////////////////
 
   int fd; /* OS file descriptor */
-  Elf* elf; /* libELF descriptor */
+  Elf* elf; /* libELF descriptor (NULL if metadata is mapped directly) */
+  void* map; /* read-only mapping of the binary (NULL if using libELF) */
+  size_t map_size; /* size of the mapping */
+  uint64_t generation; /* unique across all handles ever initialized */
 
   /////////////////////////////////////////////////////////////////////////////
   // Binary & architecture information
@@ -194,6 +287,16 @@ struct _st_handle
   const call_site* sites_id; /* sorted by ID */
   const call_site* sites_addr; /* sorted by return address */
 
+  /* Call site indexes in Eytzinger order (1-indexed), NULL if not built */
+  uint64_t* sites_addr_keys; /* return addresses */
+  uint32_t* sites_addr_idx; /* corresponding index into sites_addr */
+  uint64_t* sites_id_keys; /* call site IDs */
+  uint32_t* sites_id_idx; /* corresponding index into sites_id */
+
+  /* Call site translation tables to other binaries, built on first use */
+  site_pairs* pairs;
+  pthread_mutex_t pairs_lock;
+
   /* Call site live value records */
   uint64_t live_vals_count;
   const live_value* live_vals;
@@ -205,6 +308,18 @@ struct _st_handle
 
 typedef struct _st_handle* st_handle;
 
+/* Work done by a rewrite, published to the runtime's statistics. */
+typedef struct rewrite_tally
+{
+  uint64_t frames; /* frames rewritten */
+  uint64_t values; /* live values copied */
+  uint64_t bytes; /* bytes copied into destination frames */
+  uint64_t fixups; /* pointers to the stack fixed up */
+} rewrite_tally;
+
+/* Per-frame rewriting operations for a pair of ISAs (see kernel.h). */
+struct rewrite_kernel;
+
 /*
  * Stack rewriting context.  Used to hold current stack information for
  * rewriting.  Instantiated twice for each thread inside of rewriting functions
@@ -214,21 +329,37 @@ struct rewrite_context
 {
   /* Binary/architecture-specific information */
   st_handle handle;
+  const struct rewrite_kernel* kernel; /* operations for source/dest ISAs */
 
   /* Stack & register information, will contain transformation results. */
   void* stack_base; /* highest stack address */
   void* stack; /* top of stack (lowest stack address) */
   void* regs; /* register set, for copying in & out */
+  void* (*alloc_stack)(size_t, void*); /* allocates the stack once its size
+                                          is known if there's no stack base
+                                          (destination only) */
+  void* alloc_data; /* argument passed to alloc_stack */
 
   /* Meta-data for stack activations. */
   int num_acts; /* number of activations */
   int act; /* current activation */
-  activation acts[MAX_FRAMES]; /* all activations currently processed */
-  list_t(fixup) stack_pointers; /* pointers to the stack, to be resolved */
+  int base_act; /* first activation to execute, callee-saved registers are
+                   not propagated past it */
+  activation* acts; /* all activations currently processed, from a pool */
+  fixup_index stack_pointers; /* pointers to the stack, to be resolved */
+  rewrite_tally tally; /* work done so far (destination only) */
 
   /* Pools for constant-time allocation of per-frame/runtime-dependent data */
   void* regset_pool; /* Register sets */
   void* callee_saved_pool; /* Callee-saved registers (bitmaps) */
+  size_t acts_pool_size; /* Size of activation pool, in bytes */
+  size_t regset_pool_size; /* Size of register set pool, in bytes */
+  size_t callee_saved_pool_size; /* Size of callee-saved pool, in bytes */
+  int pool_frames; /* Number of frames the pools can hold */
+  bool pooled; /* Whether the context belongs to the thread's arena */
+
+  /* Whether the context outlives the call to rewrite (on-demand rewriting) */
+  bool ondemand;
 };
 
 typedef struct rewrite_context* rewrite_context;
@@ -0,0 +1,96 @@
+/*
+ * Index of pointer-to-stack fixup records, sorted by pointed-to source address.
+ *
+ * Date: 10/16/2026
+ */
+
+#ifndef _FIXUP_H
+#define _FIXUP_H
+
+#include "definitions.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Fixup index operations
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Initialize a fixup index, using POOL for storage until it fills up.
+ *
+ * @param index a fixup index
+ * @param pool storage for 2 * POOL_SIZE records, or NULL to use the heap
+ * @param pool_size the number of records in each half of the pool
+ */
+void fixup_index_init(fixup_index* index, fixup* pool, size_t pool_size);
+
+/*
+ * Free any heap storage used by a fixup index.
+ *
+ * @param index a fixup index
+ */
+void fixup_index_free(fixup_index* index);
+
+/*
+ * Remove all records from a fixup index, keeping its storage for reuse.
+ *
+ * @param index a fixup index
+ */
+static inline void fixup_index_reset(fixup_index* index)
+{
+  index->num_sorted = 0;
+  index->num_resolved = 0;
+  index->num_pending = 0;
+}
+
+/*
+ * Add a fixup record to the index.  The record can't be found by
+ * fixup_index_find() until the next call to fixup_index_merge().
+ *
+ * @param index a fixup index
+ * @param data the fixup record
+ */
+void fixup_index_add(fixup_index* index, const fixup* data);
+
+/*
+ * Merge pending records into the sorted records & compact away resolved
+ * records.
+ *
+ * @param index a fixup index
+ */
+void fixup_index_merge(fixup_index* index);
+
+/*
+ * Find the first sorted record pointing at or above a source address.
+ *
+ * @param index a fixup index
+ * @param src_addr a source stack address
+ * @return the position of the first record whose source address is greater
+ *         than or equal to src_addr, or index->num_sorted if there is none
+ */
+size_t fixup_index_find(const fixup_index* index, const void* src_addr);
+
+/*
+ * Mark the sorted record at a position as resolved.
+ *
+ * @param index a fixup index
+ * @param pos the record's position
+ */
+static inline void fixup_index_resolve(fixup_index* index, size_t pos)
+{
+  ASSERT(pos < index->num_sorted && index->sorted[pos].dest_loc,
+         "invalid fixup record\n");
+  index->sorted[pos].dest_loc = NULL;
+  index->num_resolved++;
+}
+
+/*
+ * Get the number of unresolved records in the index.
+ *
+ * @param index a fixup index
+ * @return the number of unresolved records
+ */
+static inline size_t fixup_index_size(const fixup_index* index)
+{
+  return index->num_sorted - index->num_resolved + index->num_pending;
+}
+
+#endif /* _FIXUP_H */
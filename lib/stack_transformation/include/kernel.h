@@ -0,0 +1,80 @@
+/*
+ * Per-frame rewriting operations, specialized for each pair of source &
+ * destination ISAs.  Unwinding & copying live values call register operations
+ * for every frame and every value; specialized kernels call each ISA's inline
+ * register operations directly rather than through the handles' function
+ * pointer tables.  Kernels are selected once per rewrite.
+ *
+ * Date: 10/16/2026
+ */
+
+#ifndef _KERNEL_H
+#define _KERNEL_H
+
+#include "definitions.h"
+
+/* Per-frame rewriting operations for a pair of ISAs. */
+typedef struct rewrite_kernel
+{
+  /* Pop the current frame from a source/destination context */
+  void (*pop_frame_src)(rewrite_context src, bool setup_bounds);
+  void (*pop_frame_dest)(rewrite_context dest, bool setup_bounds);
+
+  /*
+   * Copy the current frame's live values using pre-matched records.  Returns
+   * true if there are pointers to data in the same frame which must be fixed
+   * up.
+   */
+  bool (*rewrite_vals)(rewrite_context src, rewrite_context dest);
+} rewrite_kernel;
+
+/*
+ * Get the rewriting kernel for a pair of ISAs.  Returns the generic kernel if
+ * specialized kernels are disabled.
+ *
+ * @param src the source ISA, as an ELF machine (e.g., EM_X86_64)
+ * @param dest the destination ISA, as an ELF machine
+ * @return the kernel for rewriting from SRC to DEST
+ */
+const rewrite_kernel* get_rewrite_kernel(uint16_t src, uint16_t dest);
+
+///////////////////////////////////////////////////////////////////////////////
+// Generic rewriting operations (rewrite.c)
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Copy the current frame's live values using pre-matched records.
+ *
+ * @param src the source rewriting context
+ * @param dest the destination rewriting context
+ * @return true if pointers to data in the same frame must be fixed up
+ */
+bool rewrite_vals(rewrite_context src, rewrite_context dest);
+
+/*
+ * Rewrite an individual value from the source to destination frame.  Handles
+ * pointers to the stack, temporaries & values whose representation differs
+ * between ISAs.
+ *
+ * @param src the source rewriting context
+ * @param val_src the source value
+ * @param dest the destination rewriting context
+ * @param val_dest the destination value
+ * @return true if the value points to data in the same frame
+ */
+bool rewrite_val(rewrite_context src, const live_value* val_src,
+                 rewrite_context dest, const live_value* val_dest);
+
+/*
+ * Resolve fix-ups for pointers to a value which has been copied into the
+ * destination frame.
+ *
+ * @param src the source rewriting context
+ * @param val_src the source value
+ * @param dest the destination rewriting context
+ * @param val_dest the destination value
+ */
+void resolve_fixups(rewrite_context src, const live_value* val_src,
+                    rewrite_context dest, const live_value* val_dest);
+
+#endif /* _KERNEL_H */
@@ -0,0 +1,118 @@
+/*
+ * Template for per-frame operations specialized for a single ISA.  Included
+ * by kernel.c once per ISA, after the ISA's inline operations (ops.h) and the
+ * following definitions:
+ *
+ *   ISA            - name of the ISA, as used in its operations' names
+ *   ISA_REGSET     - the ISA's register set type
+ *   ISA_NUM_REGS   - number of registers in the ISA's register set
+ *   ISA_HAS_RA_REG - whether the return address is mapped to a register
+ *
+ * Operations mirror their generic counterparts in data.c & unwind.c.
+ *
+ * Date: 10/16/2026
+ */
+
+#define ISA_FN( name ) KERNEL_NAME(name, ISA)
+
+/*
+ * Get a pointer to a register, stack slot or spilled value in activation ACT.
+ */
+static inline void*
+ISA_FN(val_loc)(rewrite_context ctx, const live_value* val, int act)
+{
+  void* reg = KERNEL_NAME(reg, ISA)(ctx->acts[act].regs, val->regnum);
+  if(val->type == SM_REGISTER) return reg;
+  ASSERT(val->type == SM_DIRECT || val->type == SM_INDIRECT,
+         "invalid live value location type (%u)\n", val->type);
+  return *(void**)reg + val->offset_or_constant;
+}
+
+/*
+ * Get the stack save slot or the register in the outermost activation in
+ * which a callee-saved register is saved.
+ */
+static inline void*
+ISA_FN(callee_saved_loc)(rewrite_context ctx, uint16_t regnum, int act)
+{
+  uint32_t i, unwind_start, unwind_end;
+  const unwind_loc* locs = ctx->handle->unwind_locs;
+  const activation* cur;
+
+  /* Nothing to propagate from outermost frame */
+  if(act <= ctx->base_act) return NULL;
+
+  /* Walk call chain to check if register has been saved. */
+  for(act--; act >= ctx->base_act; act--)
+  {
+    cur = &ctx->acts[act];
+    if(!bitmap_is_set(cur->callee_saved, regnum)) continue;
+    unwind_start = cur->site.unwind_offset;
+    unwind_end = unwind_start + cur->site.num_unwind;
+    for(i = unwind_start; i < unwind_end; i++)
+      if(locs[i].reg == regnum)
+        return KERNEL_NAME(fbp, ISA)(cur->regs) + locs[i].offset;
+    ASSERT(false, "invalid callee-saved slot\n");
+    return NULL;
+  }
+
+  /* Register is still live in outermost frame. */
+  return KERNEL_NAME(reg, ISA)(ctx->acts[ctx->base_act].regs, regnum);
+}
+
+/*
+ * Pop a frame from CTX's stack, restoring callee-saved registers & setting up
+ * the stack pointer.  Sets up the frame base pointer & canonical frame address
+ * if requested.
+ */
+static void ISA_FN(pop_frame)(rewrite_context ctx, bool setup_bounds)
+{
+  int act = ctx->act + 1;
+  uint32_t i, unwind_start, unwind_end;
+  const unwind_loc* locs = ctx->handle->unwind_locs;
+  activation* cur, *next;
+  void* saved_loc;
+
+  TIMER_FG_START(pop_frame);
+  ST_INFO("Popping frame (CFA = %p)\n", ACT(ctx).cfa);
+
+  if(act >= ctx->pool_frames) arena_grow_pools(ctx, act + 1);
+  cur = &ctx->acts[act - 1];
+  next = &ctx->acts[act];
+
+  /* Set up register set & callee-saved bitmap */
+  next->regs = &ctx->regset_pool[act * sizeof(ISA_REGSET)];
+  *(ISA_REGSET*)next->regs = *(const ISA_REGSET*)cur->regs;
+  next->callee_saved.size = ISA_NUM_REGS;
+  next->callee_saved.bits =
+    &ctx->callee_saved_pool[act * bitmap_size(ISA_NUM_REGS)];
+
+  /* Restore callee-saved registers */
+  unwind_start = cur->site.unwind_offset;
+  unwind_end = unwind_start + cur->site.num_unwind;
+  for(i = unwind_start; i < unwind_end; i++)
+  {
+    saved_loc = KERNEL_NAME(fbp, ISA)(cur->regs) + locs[i].offset;
+    memcpy(KERNEL_NAME(reg, ISA)(next->regs, locs[i].reg), saved_loc,
+           KERNEL_NAME(callee_reg_size, ISA)(locs[i].reg));
+    bitmap_set(cur->callee_saved, locs[i].reg);
+  }
+  if(ISA_HAS_RA_REG)
+    KERNEL_NAME(set_pc, ISA)(next->regs, KERNEL_NAME(ra_reg, ISA)(next->regs));
+
+  /* Set up frame bounds */
+  ASSERT(cur->cfa, "Invalid CFA for frame %d\n", act - 1);
+  KERNEL_NAME(set_sp, ISA)(next->regs, cur->cfa);
+  if(setup_bounds)
+  {
+    ASSERT(next->site.addr, "Invalid call site information\n");
+    next->cfa = cur->cfa + next->site.frame_size;
+    KERNEL_NAME(setup_fbp, ISA)(next->regs, next->cfa);
+  }
+
+  ctx->act++;
+
+  TIMER_FG_STOP(pop_frame);
+}
+
+#undef ISA_FN
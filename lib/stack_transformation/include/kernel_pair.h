@@ -0,0 +1,97 @@
+/*
+ * Template for per-frame operations specialized for a pair of ISAs.  Included
+ * by kernel.c once per pair, after kernel_isa.h has been included for both
+ * ISAs and the following definitions:
+ *
+ *   SRC_ISA  - name of the source ISA
+ *   DEST_ISA - name of the destination ISA
+ *
+ * Defines the kernel kernel_<SRC_ISA>_<DEST_ISA>.
+ *
+ * Date: 10/16/2026
+ */
+
+#define PAIR_FN( name ) KERNEL_NAME(KERNEL_NAME(name, SRC_ISA), DEST_ISA)
+
+/*
+ * Copy the current frame's live values using pre-matched records.  Plain
+ * values & runs of stack slots are copied directly, everything else is handed
+ * to the generic rewrite_val().
+ */
+static bool PAIR_FN(rewrite_vals)(rewrite_context src, rewrite_context dest)
+{
+  size_t i, j;
+  uint32_t size;
+  const copy_op* ops = ACT(src).ops;
+  const live_value* val_src, *val_dest;
+  const void* src_addr;
+  void* dest_addr, *callee_addr;
+  bool needs_local_fixup = false;
+
+  ASSERT(src->act == dest->act, "non-matching activations (%u vs. %u)\n",
+         src->act, dest->act);
+
+  for(i = 0; i < ACT(dest).site.num_live; i += ops[i].run_ops)
+  {
+    val_src = ops[i].src;
+    val_dest = ops[i].dest;
+
+    /* Runs of contiguous stack slots (never pointers or temporaries) */
+    if(ops[i].run_ops > 1)
+    {
+      src_addr = KERNEL_NAME(val_loc, SRC_ISA)(src, val_src, src->act);
+      dest_addr = KERNEL_NAME(val_loc, DEST_ISA)(dest, val_dest, dest->act);
+      memcpy(dest_addr, src_addr, ops[i].run_bytes);
+      COUNT_BYTES(dest, dest->act, bytes_moved, ops[i].run_bytes);
+      COUNT_BYTES(dest, dest->act, bytes_bulk, ops[i].run_bytes);
+      TALLY(dest, bytes, ops[i].run_bytes);
+      if(dest->stack_pointers.num_sorted)
+        for(j = 0; j < ops[i].run_ops; j++)
+          resolve_fixups(src, ops[i + j].src, dest, ops[i + j].dest);
+      continue;
+    }
+
+    /*
+     * Possible pointers to the stack, temporaries, constants & values with
+     * different sizes (e.g., va_list) need the generic handling.
+     */
+    if(val_src->is_ptr || val_src->is_temporary || val_dest->is_temporary ||
+       val_src->type == SM_CONSTANT || val_src->type == SM_CONST_IDX ||
+       val_dest->type == SM_CONSTANT || val_dest->type == SM_CONST_IDX ||
+       VAL_SIZE(val_src) != VAL_SIZE(val_dest))
+    {
+      needs_local_fixup |= rewrite_val(src, val_src, dest, val_dest);
+      continue;
+    }
+
+    /*
+     * Copy the value, and into the slot of the activation where it is saved
+     * if it's in a callee-saved register.
+     */
+    size = VAL_SIZE(val_dest);
+    src_addr = KERNEL_NAME(val_loc, SRC_ISA)(src, val_src, src->act);
+    dest_addr = KERNEL_NAME(val_loc, DEST_ISA)(dest, val_dest, dest->act);
+    memcpy(dest_addr, src_addr, size);
+    if(val_dest->type == SM_REGISTER &&
+       KERNEL_NAME(is_callee_saved, DEST_ISA)(val_dest->regnum) &&
+       (callee_addr = KERNEL_NAME(callee_saved_loc, DEST_ISA)(dest,
+                                                              val_dest->regnum,
+                                                              dest->act)))
+      memcpy(callee_addr, src_addr, size);
+    COUNT_BYTES(dest, dest->act, bytes_moved, size);
+    TALLY(dest, bytes, size);
+
+    if(val_src->is_alloca && dest->stack_pointers.num_sorted)
+      resolve_fixups(src, val_src, dest, val_dest);
+  }
+
+  return needs_local_fixup;
+}
+
+static const rewrite_kernel PAIR_FN(kernel) = {
+  .pop_frame_src = KERNEL_NAME(pop_frame, SRC_ISA),
+  .pop_frame_dest = KERNEL_NAME(pop_frame, DEST_ISA),
+  .rewrite_vals = PAIR_FN(rewrite_vals),
+};
+
+#undef PAIR_FN
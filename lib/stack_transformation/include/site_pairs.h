@@ -0,0 +1,39 @@
+/*
+ * APIs for translating call sites & live values between binaries.
+ *
+ * Date: 10/16/2026
+ */
+
+#ifndef _SITE_PAIRS_H
+#define _SITE_PAIRS_H
+
+#include "definitions.h"
+
+/*
+ * Get the table translating call sites in the source binary to call sites in
+ * the destination binary, building it on first use.  Thread-safe.
+ *
+ * @param src a source stack transformation handle
+ * @param dest a destination stack transformation handle
+ * @return the translation table, or NULL if disabled or it could not be built
+ */
+const site_pairs* get_site_pairs(st_handle src, st_handle dest);
+
+/*
+ * Free all translation tables held by a (source) handle.
+ *
+ * @param handle a stack transformation handle
+ */
+void free_site_pairs(st_handle handle);
+
+/*
+ * Find runs of copy operations between stack slots which are contiguous in
+ * both frames & can be copied in bulk, setting each operation's run_ops &
+ * run_bytes.  A no-op if translation tables are disabled.
+ *
+ * @param ops copy operations for a call site
+ * @param num the number of copy operations
+ */
+void coalesce_copies(copy_op* ops, uint64_t num);
+
+#endif /* _SITE_PAIRS_H */
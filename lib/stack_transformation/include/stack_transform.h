@@ -8,6 +8,7 @@
 #ifndef _ST_H
 #define _ST_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -30,6 +31,80 @@ typedef struct stack_bounds {
   void* low;
 } stack_bounds;
 
+/*
+ * Allocate a destination stack of at least SIZE bytes for a rewrite.  Returns
+ * the stack's base (i.e., highest address), or NULL if it could not be
+ * allocated.  DATA is the argument passed to st_rewrite_stack_alloc().
+ */
+typedef void* (*st_stack_alloc)(size_t size, void* data);
+
+/* Statistics for the cache of unwound call chains, across all threads */
+typedef struct st_unwind_cache_stats {
+  uint64_t hits; /* unwinds which matched the thread's cached call chain */
+  uint64_t misses; /* unwinds which looked up one or more call sites */
+  uint64_t saved_ns; /* estimated time saved by hits, in nanoseconds */
+} st_unwind_cache_stats;
+
+/* Phases of a rewrite timed by the runtime's statistics */
+typedef enum st_phase {
+  ST_PHASE_INIT = 0, /* setting up rewriting contexts */
+  ST_PHASE_UNWIND, /* unwinding the source stack & sizing the destination */
+  ST_PHASE_REWRITE, /* rewriting frames */
+  ST_PHASE_FINISH, /* copying out registers & cleaning up */
+  ST_PHASE_TOTAL, /* all of the above */
+  ST_NUM_PHASES
+} st_phase;
+
+/*
+ * Number of buckets in the runtime's latency histograms.  Bucket 0 counts
+ * phases which took 0ns, and bucket i counts phases which took between 2^(i-1)
+ * and 2^i - 1 nanoseconds.  The last bucket counts everything longer.
+ */
+#define ST_STATS_BUCKETS 40
+
+/* Statistics for rewrites, across all threads */
+typedef struct st_stats {
+  uint64_t rewrites; /* calls to st_rewrite_stack() & st_rewrite_ondemand() */
+  uint64_t resumes; /* on-demand rewrites continued from the trampoline */
+  uint64_t frames; /* frames rewritten */
+  uint64_t values; /* live values copied */
+  uint64_t bytes; /* bytes copied into destination frames */
+  uint64_t fixups; /* pointers to the stack fixed up */
+  uint64_t phase_ns[ST_NUM_PHASES]; /* time spent in each phase */
+  uint64_t phase_hist[ST_NUM_PHASES][ST_STATS_BUCKETS]; /* latencies */
+} st_stats;
+
+/*
+ * A single rewrite (or resumption of an on-demand rewrite) as recorded in the
+ * statistics file written at exit.  The file consists of an st_stats_header
+ * followed by up to num_records records, oldest first.
+ */
+typedef struct st_stats_record {
+  uint64_t seq; /* sequence number, starting at 1 */
+  uint64_t timestamp; /* completion time, in nanoseconds since the epoch */
+  uint32_t tid; /* thread ID */
+  uint16_t src_arch, dest_arch; /* source & destination ISAs */
+  uint32_t resume; /* non-zero if continued from the trampoline */
+  uint32_t frames; /* frames rewritten */
+  uint32_t values; /* live values copied */
+  uint32_t fixups; /* pointers to the stack fixed up */
+  uint64_t bytes; /* bytes copied into destination frames */
+  uint64_t phase_ns[ST_NUM_PHASES]; /* time spent in each phase */
+} st_stats_record;
+
+#define ST_STATS_MAGIC "STSTATS"
+#define ST_STATS_VERSION 1
+
+/* Header of the statistics file written at exit */
+typedef struct st_stats_header {
+  char magic[8]; /* ST_STATS_MAGIC */
+  uint32_t version; /* ST_STATS_VERSION */
+  uint32_t record_size; /* sizeof(st_stats_record) */
+  uint64_t num_records; /* number of records following the header */
+  uint64_t dropped; /* older records overwritten in the ring buffer */
+  st_stats totals; /* statistics across all rewrites, including dropped */
+} st_stats_header;
+
 ///////////////////////////////////////////////////////////////////////////////
 // Initialization & teardown
 ///////////////////////////////////////////////////////////////////////////////
@@ -46,6 +121,8 @@ st_handle st_init(const char* fn);
 
 /*
  * Clean up and free a stack transformation handle.  Releases ELF information.
+ * Translation tables cached by other handles for rewrites into this handle
+ * are never used again, even if a new handle is allocated at the same address.
  *
  * @param handle a stack transformation handle
  */
@@ -73,6 +150,18 @@ int st_userspace_rewrite(void* sp,
                          enum arch dest_arch,
                          void* dest_regs);
 
+/*
+ * Load the rewriting metadata for an ISA ahead of time, so that threads
+ * rewriting their stacks at the same time (e.g., a team migrating together)
+ * don't all wait on it being loaded by the first rewrite.
+ *
+ * Note: specific to Popcorn Compiler/the migration wrapper.
+ *
+ * @param arch the ISA
+ * @return 0 if the metadata was loaded, 1 otherwise
+ */
+int st_userspace_prepare(enum arch arch);
+
 /*
  * Rewrite the stack in its entirety from its current form (source) to the
  * requested form (destination).
@@ -98,8 +187,39 @@ int st_rewrite_stack(st_handle src,
                      void* sp_base_dest);
 
 /*
- * Rewrite only the top frame of the stack.  Previous frames will be
- * re-written on-demand as the thread unwinds the call stack.
+ * Rewrite the stack in its entirety like st_rewrite_stack(), but rather than
+ * rewriting into a pre-determined stack, call ALLOC to allocate a destination
+ * stack once the size of the rewritten stack is known.
+ *
+ * @param src a stack transformation handle which has transformation metadata
+ *            for the source binary
+ * @param regset_src a pointer to a filled register set representing the
+ *                   thread's state
+ * @param sp_base_src source stack base, i.e., highest stack address
+ * @param dest a stack transformation handle which has transformation metadata
+ *             for the destination binary
+ * @param regset_dest a pointer to a register set to be filled with destination
+ *                    thread's state
+ * @param alloc called with the size of the rewritten stack to allocate the
+ *              destination stack
+ * @param data passed to ALLOC
+ * @return 0 if succesful, or 1 otherwise
+ */
+int st_rewrite_stack_alloc(st_handle src,
+                           void* regset_src,
+                           void* sp_base_src,
+                           st_handle dest,
+                           void* regset_dest,
+                           st_stack_alloc alloc,
+                           void* data);
+
+/*
+ * Rewrite only the top frame(s) of the stack.  Previous frames will be
+ * re-written on-demand as the thread unwinds the call stack.  Frames are
+ * rewritten eagerly until there are no pointers into not-yet-rewritten frames.
+ * Note that the handles must remain valid (i.e., not be passed to
+ * st_destroy()) until the thread has returned through all rewritten frames.
+ * Falls back to st_rewrite_stack() without compiler TLS.
  *
  * @param src a stack transformation handle which has transformation metadata
  *            for the source binary
@@ -114,7 +234,6 @@ int st_rewrite_stack(st_handle src,
  *                     (will fill downwards with activation records)
  * @return 0 if succesful, or 1 otherwise
  */
-// TODO not yet implemented
 int st_rewrite_ondemand(st_handle src,
                         void* regset_src,
                         void* sp_base_src,
@@ -122,6 +241,44 @@ int st_rewrite_ondemand(st_handle src,
                         void* regset_dest,
                         void* sp_base_dest);
 
+/*
+ * Get statistics for the cache of unwound call chains.  Time saved is
+ * estimated from the average per-frame cost of unwinding without the cache.
+ * All values are zero if the runtime was built without the cache.
+ *
+ * @param stats statistics to be filled in
+ */
+void st_get_unwind_cache_stats(st_unwind_cache_stats* stats);
+
+/*
+ * Get statistics for all rewrites since the program started.  Statistics are
+ * collected unless disabled with st_set_stats_enabled() or by setting
+ * ST_NO_STATS in the environment.  If ST_STATS_FILE is set, the most recent
+ * rewrites are also written to the named file at exit.
+ *
+ * @param stats statistics to be filled in
+ */
+void st_get_stats(st_stats* stats);
+
+/*
+ * Enable or disable collecting statistics for subsequent rewrites.
+ *
+ * @param enabled non-zero to collect statistics, zero otherwise
+ */
+void st_set_stats_enabled(int enabled);
+
+/*
+ * Return whether rewriting from one binary's stack to another's uses the
+ * rewriting kernel specialized for their pair of ISAs rather than the generic
+ * path.  Specialized kernels are used unless the runtime was built without
+ * them or ST_NO_KERNELS is set in the environment.
+ *
+ * @param src the source binary's handle
+ * @param dest the destination binary's handle
+ * @return non-zero if a specialized kernel is used, zero otherwise
+ */
+int st_specialized_kernel(st_handle src, st_handle dest);
+
 /*
  * Return the current thread's stack bounds.
  *
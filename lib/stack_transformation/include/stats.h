@@ -0,0 +1,86 @@
+/*
+ * Always-on statistics for rewrites.  Each thread publishes the work done &
+ * time spent by its rewrites into its own counters, which are only written by
+ * that thread and summed across threads when read.
+ *
+ * Date: 10/16/2026
+ */
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <time.h>
+
+#include "stack_transform.h"
+#include "definitions.h"
+
+/* Time spent in each phase of a rewrite. */
+typedef struct stats_timer
+{
+  bool enabled; /* whether statistics were enabled when the rewrite started */
+  uint64_t last; /* time of the last phase boundary, in nanoseconds */
+  uint64_t ns[ST_NUM_PHASES]; /* time spent in each phase */
+} stats_timer;
+
+/*
+ * Return whether statistics are currently being collected.
+ *
+ * @return true if statistics are enabled, false otherwise
+ */
+bool stats_enabled(void);
+
+/*
+ * Read the monotonic clock.
+ *
+ * @return the current time, in nanoseconds
+ */
+static inline uint64_t stats_now(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000UL + now.tv_nsec;
+}
+
+/*
+ * Start timing a rewrite.
+ *
+ * @param timer a timer for the rewrite
+ */
+static inline void stats_timer_start(stats_timer* timer)
+{
+  memset(timer, 0, sizeof(stats_timer));
+  if((timer->enabled = stats_enabled())) timer->last = stats_now();
+}
+
+/*
+ * Attribute the time since the last phase boundary to a phase.
+ *
+ * @param timer a timer for the rewrite
+ * @param phase the phase which just finished
+ */
+static inline void stats_timer_phase(stats_timer* timer, st_phase phase)
+{
+  uint64_t now;
+
+  if(!timer->enabled) return;
+  now = stats_now();
+  timer->ns[phase] += now - timer->last;
+  timer->last = now;
+}
+
+/*
+ * Publish the work done by a rewrite into the calling thread's statistics &
+ * reset the destination context's tally.  Does nothing if statistics were
+ * disabled when the rewrite started.
+ *
+ * @param src the source rewriting context
+ * @param dest the destination rewriting context
+ * @param timer the rewrite's timer
+ * @param resume true if continuing an on-demand rewrite
+ */
+void stats_publish(rewrite_context src,
+                   rewrite_context dest,
+                   stats_timer* timer,
+                   bool resume);
+
+#endif /* _STATS_H */
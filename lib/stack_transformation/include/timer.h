@@ -33,7 +33,11 @@ typedef struct timer* timer;
 #define COARSE_TIMERS \
   X(st_init) \
   X(st_destroy) \
+  X(map_metadata) \
+  X(build_site_pairs) \
   X(st_rewrite_stack) \
+  X(st_rewrite_ondemand) \
+  X(rewrite_ondemand) \
   X(init_src_context) \
   X(init_dest_context) \
   X(unwind_and_size) \
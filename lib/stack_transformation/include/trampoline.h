@@ -0,0 +1,30 @@
+/*
+ * Return trampoline used to intercept threads returning into frames which
+ * have not yet been rewritten by on-demand stack transformation.
+ *
+ * Date: 10/16/2026
+ */
+
+#ifndef _TRAMPOLINE_H
+#define _TRAMPOLINE_H
+
+/*
+ * Return address installed in the last frame rewritten by on-demand stack
+ * transformation.  Saves the return value registers, calls
+ * __st_ondemand_resume() to rewrite the next frame(s) and jumps to the first
+ * rewritten frame's call site.  Not to be called directly.
+ */
+void __st_ondemand_trampoline(void);
+
+/*
+ * Rewrite the next frame(s) of the thread's pending on-demand rewrite.  Called
+ * by the trampoline with a register set (for the current ISA) on the stack,
+ * which is filled with the callee-saved registers, stack pointer, frame base
+ * pointer and program counter of the frame in which to resume.
+ *
+ * @param regset a register set for the current ISA
+ * @return the register set passed in, for convenience in the trampoline
+ */
+void* __st_ondemand_resume(void* regset);
+
+#endif /* _TRAMPOLINE_H */
@@ -66,6 +66,43 @@ int64_t get_num_entries(Elf* e, const char* sec);
  */
 const void* get_section_data(Elf* e, const char* sec);
 
+/*
+ * Build the handle's call site lookup indexes (if enabled).  If the indexes
+ * cannot be built, lookups fall back to binary searching the call site
+ * records.
+ *
+ * @param handle a stack transformation handle with call site records
+ * @return true if the indexes were built, false otherwise
+ */
+bool init_site_index(st_handle handle);
+
+/*
+ * Free the handle's call site lookup indexes, if any.
+ *
+ * @param handle a stack transformation handle
+ */
+void free_site_index(st_handle handle);
+
+/*
+ * Return the index into the handle's sites_addr array of the call site for
+ * the specified return address.
+ *
+ * @param handle a stack transformation handle
+ * @param ret_addr return address defining the call site
+ * @return the index of the call site, or -1 if not found
+ */
+int64_t get_site_idx_by_addr(st_handle handle, void* ret_addr);
+
+/*
+ * Return the index into the handle's sites_id array of the call site for the
+ * specified call site ID.
+ *
+ * @param handle a stack transformation handle
+ * @param csid a call site id
+ * @return the index of the call site, or -1 if not found
+ */
+int64_t get_site_idx_by_id(st_handle handle, uint64_t csid);
+
 /*
  * Return the call site information for the specified return address.
  *
@@ -0,0 +1,260 @@
+/*
+ * Per-thread alternate stacks for userspace rewriting.  Replaces dividing
+ * every thread's stack in half, which wastes half of the stack and limits
+ * how deep the stack can be when migrating.
+ *
+ * Stacks are reserved with mmap() (physical pages are only allocated when
+ * touched) with a guard page below each stack.  A thread exits while running
+ * on one of its alternate stacks, so that stack can't be unmapped when the
+ * thread's destructors run; it's instead retired & unmapped by a later
+ * allocation once the thread has completely exited.
+ *
+ * Date: 10/16/2026
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "alt_stack.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API & definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/* A mapped stack, including its guard page. */
+typedef struct alt_region
+{
+  void* map; /* start of the mapping, i.e., the guard page */
+  size_t size; /* size of the mapping */
+} alt_region;
+
+/* A thread's alternate stacks. */
+typedef struct alt_stacks
+{
+  alt_region region[2];
+} alt_stacks;
+
+/* A stack retired by an exited thread, to be unmapped once it's gone. */
+typedef struct retired_stack
+{
+  alt_region region;
+  pid_t tid;
+  struct retired_stack* next;
+} retired_stack;
+
+/* Stacks retired by exiting threads. */
+static retired_stack* retired = NULL;
+static pthread_mutex_t retired_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Thread-specific stacks, released by the key's destructor at thread exit. */
+static pthread_key_t stacks_key;
+static pthread_once_t stacks_once = PTHREAD_ONCE_INIT;
+#if _TLS_IMPL == COMPILER_TLS
+static __thread alt_stacks* thread_stacks = NULL;
+#endif
+
+/*
+ * Get the calling thread's stacks, allocating them if necessary.
+ */
+static alt_stacks* get_stacks(void);
+
+/*
+ * Create the stacks key.
+ */
+static void create_stacks_key(void);
+
+/*
+ * Release a thread's stacks at thread exit.
+ */
+static void free_stacks(void* stacks);
+
+/*
+ * Unmap stacks retired by threads which have since exited.
+ */
+static void reap_retired(void);
+
+/*
+ * Return whether SP is within REGION's stack.
+ */
+static inline bool in_region(const alt_region* region, void* sp)
+{
+  return region->map && region->map < sp && sp <= region->map + region->size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Alternate stack operations
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Get a destination stack for the calling thread.
+ */
+void* alt_stack_alloc(size_t size, void* sp)
+{
+  alt_stacks* stacks;
+  alt_region* region;
+  size_t page = sysconf(_SC_PAGESIZE), needed;
+  void* map;
+
+  if(!(stacks = get_stacks())) return NULL;
+  if(__atomic_load_n(&retired, __ATOMIC_RELAXED)) reap_retired();
+
+  /* Use whichever stack we're not running on */
+  if(in_region(&stacks->region[0], sp)) region = &stacks->region[1];
+  else if(in_region(&stacks->region[1], sp)) region = &stacks->region[0];
+  else region = stacks->region[1].size > stacks->region[0].size ?
+                &stacks->region[1] : &stacks->region[0];
+
+  needed = size + ALT_STACK_HEADROOM;
+  needed = ((needed + page - 1) & ~(page - 1)) + page;
+  if(region->size < needed)
+  {
+    if(region->map && munmap(region->map, region->size))
+      ST_WARN("could not unmap alternate stack %p\n", region->map);
+    region->map = NULL;
+    region->size = 0;
+
+    map = mmap(NULL, needed, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if(map == MAP_FAILED)
+    {
+      ST_WARN("could not map alternate stack (%lu bytes)\n", needed);
+      return NULL;
+    }
+    if(mprotect(map, page, PROT_NONE))
+      ST_WARN("could not set up alternate stack guard page\n");
+    region->map = map;
+    region->size = needed;
+    ST_INFO("Mapped alternate stack %p -> %p\n", map + page, map + needed);
+  }
+
+  return region->map + region->size;
+}
+
+/*
+ * Get the bounds of the calling thread's alternate stack containing SP.
+ */
+bool alt_stack_bounds(void* sp, stack_bounds* bounds)
+{
+  alt_stacks* stacks;
+  size_t i, page;
+
+#if _TLS_IMPL == COMPILER_TLS
+  stacks = thread_stacks;
+#else /* PTHREAD_TLS */
+  pthread_once(&stacks_once, create_stacks_key);
+  stacks = pthread_getspecific(stacks_key);
+#endif
+  if(!stacks) return false;
+
+  page = sysconf(_SC_PAGESIZE);
+  for(i = 0; i < 2; i++)
+  {
+    if(in_region(&stacks->region[i], sp))
+    {
+      bounds->low = stacks->region[i].map + page;
+      bounds->high = stacks->region[i].map + stacks->region[i].size;
+      return true;
+    }
+  }
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API implementation
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Get the calling thread's stacks.
+ */
+static alt_stacks* get_stacks(void)
+{
+  alt_stacks* stacks;
+
+#if _TLS_IMPL == COMPILER_TLS
+  if(thread_stacks) return thread_stacks;
+  pthread_once(&stacks_once, create_stacks_key);
+#else /* PTHREAD_TLS */
+  pthread_once(&stacks_once, create_stacks_key);
+  if((stacks = pthread_getspecific(stacks_key))) return stacks;
+#endif
+
+  if(!(stacks = (alt_stacks*)MALLOC(sizeof(alt_stacks)))) return NULL;
+  memset(stacks, 0, sizeof(alt_stacks));
+  if(pthread_setspecific(stacks_key, stacks))
+    ST_WARN("could not register alternate stacks for cleanup at thread exit\n");
+
+#if _TLS_IMPL == COMPILER_TLS
+  thread_stacks = stacks;
+#endif
+  return stacks;
+}
+
+/*
+ * Create the stacks key.
+ */
+static void create_stacks_key(void)
+{
+  if(pthread_key_create(&stacks_key, free_stacks))
+    ST_WARN("could not create thread-specific key for alternate stacks\n");
+}
+
+/*
+ * Unmap the stack the thread isn't running on & retire the other.
+ */
+static void free_stacks(void* data)
+{
+  alt_stacks* stacks = (alt_stacks*)data;
+  retired_stack* cur;
+  void* sp = &cur;
+  size_t i;
+
+  for(i = 0; i < 2; i++)
+  {
+    if(!stacks->region[i].map) continue;
+    if(!in_region(&stacks->region[i], sp))
+      munmap(stacks->region[i].map, stacks->region[i].size);
+    else if((cur = (retired_stack*)MALLOC(sizeof(retired_stack))))
+    {
+      cur->region = stacks->region[i];
+      cur->tid = syscall(SYS_gettid);
+      pthread_mutex_lock(&retired_lock);
+      cur->next = retired;
+      __atomic_store_n(&retired, cur, __ATOMIC_RELAXED);
+      pthread_mutex_unlock(&retired_lock);
+    }
+    else ST_WARN("could not retire alternate stack, leaking it\n");
+  }
+  free(stacks);
+
+#if _TLS_IMPL == COMPILER_TLS
+  thread_stacks = NULL;
+#endif
+}
+
+/*
+ * Unmap retired stacks whose threads have exited.
+ */
+static void reap_retired(void)
+{
+  retired_stack** prev, *cur;
+  pid_t pid = getpid();
+
+  pthread_mutex_lock(&retired_lock);
+  prev = &retired;
+  while((cur = *prev))
+  {
+    // Note: the kernel reports the thread is gone only once it has stopped
+    // running, i.e., it's no longer using the stack
+    if(syscall(SYS_tgkill, pid, cur->tid, 0) && errno == ESRCH)
+    {
+      munmap(cur->region.map, cur->region.size);
+      __atomic_store_n(prev, cur->next, __ATOMIC_RELAXED);
+      free(cur);
+    }
+    else prev = &cur->next;
+  }
+  pthread_mutex_unlock(&retired_lock);
+}
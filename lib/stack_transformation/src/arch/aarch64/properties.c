@@ -6,13 +6,12 @@
  */
 
 #include "definitions.h"
-#include "arch/aarch64/regs.h"
+#include "arch/aarch64/ops.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // File-local APIs & definitions
 ///////////////////////////////////////////////////////////////////////////////
 
-#define AARCH64_STACK_ALIGNMENT 0x10
 #define AARCH64_RA_OFFSET -0x8
 #define AARCH64_CFA_OFFSET_FUNCENTRY 0x0
 
@@ -29,10 +28,6 @@ static const uint16_t callee_saved_size_aarch64[] = {
   8, 8, 8, 8, 8, 8, 8, 8 /* Floating-point/SIMD (only 64-bits) */
 };
 
-static void* align_sp_aarch64(void* sp);
-static bool is_callee_saved_aarch64(uint16_t reg);
-static uint16_t callee_reg_size_aarch64(uint16_t reg);
-
 /* aarch64 properties */
 const struct properties_t properties_aarch64 = {
   .num_callee_saved = sizeof(callee_saved_aarch64) / sizeof(uint16_t),
@@ -45,57 +40,3 @@ const struct properties_t properties_aarch64 = {
   .is_callee_saved = is_callee_saved_aarch64,
   .callee_reg_size = callee_reg_size_aarch64
 };
-
-///////////////////////////////////////////////////////////////////////////////
-// aarch64 APIs
-///////////////////////////////////////////////////////////////////////////////
-
-static void* align_sp_aarch64(void* sp)
-{
-  /*
-   * Per the AArch64 ABI:
-   *   "Additionally, at any point at which memory is accessed via SP, the
-   *    hardware requires that
-   *      - SP mod 16 = 0. The stack must be quad-word aligned."
-   */
-  return sp -
-    (AARCH64_STACK_ALIGNMENT - ((uint64_t)sp % AARCH64_STACK_ALIGNMENT));
-}
-
-static bool is_callee_saved_aarch64(uint16_t reg)
-{
-  switch(reg)
-  {
-  /* General-purpose registers x19-x28 */
-  case X19: case X20: case X21: case X22: case X23: case X24:
-  case X25: case X26: case X27: case X28: case X29: case X30:
-    return true;
-
-  /* Floating-point registers v8-v15 */
-  case V8: case V9: case V10: case V11: case V12: case V13: case V14: case V15:
-    return true;
-
-  default: return false;
-  }
-}
-
-static uint16_t callee_reg_size_aarch64(uint16_t reg)
-{
-  switch(reg)
-  {
-  /* General-purpose registers x19-x28 */
-  case X19: case X20: case X21: case X22: case X23: case X24:
-  case X25: case X26: case X27: case X28: case X29: case X30:
-    return 8;
-
-  /* Floating-point/SIMD (only least-significant 64-bits) */
-  case V8: case V9: case V10: case V11: case V12: case V13: case V14: case V15:
-    return 8;
-
-  default: break;
-  }
-
-  ST_ERR(1, "unknown/invalid register %u (aarch64)\n", reg);
-  return 0;
-}
-
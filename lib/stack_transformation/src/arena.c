@@ -0,0 +1,339 @@
+/*
+ * Per-thread arena of rewriting contexts.  Replaces allocating contexts (and
+ * pools sized for the deepest supported stack) on every rewrite, so that
+ * threads which migrate frequently don't hit the allocator and memory scales
+ * with the depth of the stacks actually rewritten.
+ *
+ * Date: 10/16/2026
+ */
+
+#include "arena.h"
+#include "fixup.h"
+#include "util.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API & definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * A thread's rewriting contexts.  A rewrite uses a pair of contexts, and a
+ * thread may start a new rewrite while an on-demand rewrite is still pending.
+ */
+struct rewrite_arena
+{
+  struct rewrite_context ctx[ARENA_CONTEXTS];
+  bool in_use[ARENA_CONTEXTS];
+  unwind_cache cache[UNWIND_CACHE_CHAINS];
+  uint64_t cache_clock;
+};
+
+/* Thread-specific arena, freed by the key's destructor at thread exit. */
+static pthread_key_t arena_key;
+static pthread_once_t arena_once = PTHREAD_ONCE_INIT;
+#if _TLS_IMPL == COMPILER_TLS
+static __thread struct rewrite_arena* thread_arena = NULL;
+#endif
+
+/*
+ * Get the calling thread's arena, allocating it if necessary.
+ */
+static struct rewrite_arena* get_arena(void);
+
+/*
+ * Create the arena key.
+ */
+static void create_arena_key(void);
+
+/*
+ * Free a thread's arena.
+ */
+static void free_arena(void* arena);
+
+/*
+ * Initialize an empty context.
+ */
+static void init_context_storage(rewrite_context ctx, bool pooled);
+
+/*
+ * Free a context's storage.
+ */
+static void free_context_storage(rewrite_context ctx);
+
+/*
+ * Resize a context's pools to hold NUM_FRAMES frames for the context's ISA.
+ */
+static void resize_pools(rewrite_context ctx, int num_frames);
+
+///////////////////////////////////////////////////////////////////////////////
+// Arena operations
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Get an unused rewriting context.
+ */
+rewrite_context arena_get_context(st_handle handle)
+{
+  size_t i, regset_size, callee_size;
+  struct rewrite_arena* arena;
+  rewrite_context ctx = NULL;
+
+  if((arena = get_arena()))
+  {
+    for(i = 0; i < ARENA_CONTEXTS; i++)
+    {
+      if(!arena->in_use[i])
+      {
+        arena->in_use[i] = true;
+        ctx = &arena->ctx[i];
+        break;
+      }
+    }
+  }
+
+  /* Shouldn't happen, but don't fail the rewrite if the arena is exhausted */
+  if(!ctx)
+  {
+    ST_WARN("no rewriting contexts left in arena, allocating from heap\n");
+    if(!(ctx = (rewrite_context)MALLOC(sizeof(struct rewrite_context))))
+      return NULL;
+    init_context_storage(ctx, false);
+  }
+
+  /* Pools are sized in bytes, calculate how many frames they hold this time */
+  ctx->handle = handle;
+  ctx->act = 0;
+  regset_size = REGOPS(ctx)->regset_size;
+  callee_size = bitmap_size(REGOPS(ctx)->num_regs);
+  ctx->pool_frames = ctx->acts_pool_size / sizeof(activation);
+  if(ctx->regset_pool_size / regset_size < ctx->pool_frames)
+    ctx->pool_frames = ctx->regset_pool_size / regset_size;
+  if(ctx->callee_saved_pool_size / callee_size < ctx->pool_frames)
+    ctx->pool_frames = ctx->callee_saved_pool_size / callee_size;
+  if(ctx->pool_frames < ARENA_INIT_FRAMES)
+  {
+    ctx->pool_frames = 0; // Nothing to copy
+    resize_pools(ctx, ARENA_INIT_FRAMES);
+  }
+  if(!ctx->acts || !ctx->regset_pool || !ctx->callee_saved_pool)
+  {
+    arena_put_context(ctx);
+    return NULL;
+  }
+
+  return ctx;
+}
+
+/*
+ * Return a context to the arena.
+ */
+void arena_put_context(rewrite_context ctx)
+{
+  struct rewrite_arena* arena;
+  size_t i;
+
+  ASSERT(ctx, "invalid argument to arena_put_context()\n");
+
+  fixup_index_reset(&ctx->stack_pointers);
+  if(ctx->pooled)
+  {
+    arena = get_arena();
+    i = ctx - arena->ctx;
+    ASSERT(i < ARENA_CONTEXTS && arena->in_use[i],
+           "context does not belong to thread's arena\n");
+    arena->in_use[i] = false;
+  }
+  else
+  {
+    free_context_storage(ctx);
+    free(ctx);
+  }
+}
+
+/*
+ * Grow a context's per-frame pools.
+ */
+void arena_grow_pools(rewrite_context ctx, int num_frames)
+{
+  int new_frames = ctx->pool_frames ? ctx->pool_frames : ARENA_INIT_FRAMES;
+
+  if(num_frames <= ctx->pool_frames) return;
+  while(new_frames < num_frames) new_frames *= 2;
+  resize_pools(ctx, new_frames);
+  if(ctx->pool_frames < num_frames)
+    ST_ERR(1, "could not grow rewriting pools to %d frames\n", new_frames);
+}
+
+/*
+ * Get the calling thread's unwinding cache for a pair of handles.
+ */
+unwind_cache* arena_get_unwind_cache(st_handle src, st_handle dest)
+{
+  size_t i;
+  struct rewrite_arena* arena;
+  unwind_cache* cache;
+
+  if(!(arena = get_arena())) return NULL;
+
+  cache = &arena->cache[0];
+  for(i = 0; i < UNWIND_CACHE_CHAINS; i++)
+  {
+    if(arena->cache[i].src == src && arena->cache[i].dest == dest)
+    {
+      cache = &arena->cache[i];
+      break;
+    }
+    if(arena->cache[i].last_used < cache->last_used)
+      cache = &arena->cache[i];
+  }
+
+  if(cache->src != src || cache->dest != dest) cache->num_acts = 0;
+  cache->last_used = ++arena->cache_clock;
+  return cache;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API implementation
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Get the calling thread's arena.
+ */
+static struct rewrite_arena* get_arena(void)
+{
+  struct rewrite_arena* arena;
+  size_t i;
+
+#if _TLS_IMPL == COMPILER_TLS
+  if(thread_arena) return thread_arena;
+  pthread_once(&arena_once, create_arena_key);
+#else /* PTHREAD_TLS */
+  pthread_once(&arena_once, create_arena_key);
+  if((arena = pthread_getspecific(arena_key))) return arena;
+#endif
+
+  if(!(arena = (struct rewrite_arena*)MALLOC(sizeof(struct rewrite_arena))))
+    return NULL;
+  for(i = 0; i < ARENA_CONTEXTS; i++)
+  {
+    init_context_storage(&arena->ctx[i], true);
+    arena->in_use[i] = false;
+  }
+  memset(arena->cache, 0, sizeof(arena->cache));
+  arena->cache_clock = 0;
+  if(pthread_setspecific(arena_key, arena))
+    ST_WARN("could not register arena for cleanup at thread exit\n");
+
+#if _TLS_IMPL == COMPILER_TLS
+  thread_arena = arena;
+#endif
+  return arena;
+}
+
+/*
+ * Create the arena key.
+ */
+static void create_arena_key(void)
+{
+  if(pthread_key_create(&arena_key, free_arena))
+    ST_WARN("could not create thread-specific key for arena\n");
+}
+
+/*
+ * Free a thread's arena.
+ */
+static void free_arena(void* data)
+{
+  struct rewrite_arena* arena = (struct rewrite_arena*)data;
+  size_t i;
+
+  for(i = 0; i < ARENA_CONTEXTS; i++)
+    free_context_storage(&arena->ctx[i]);
+  for(i = 0; i < UNWIND_CACHE_CHAINS; i++) free(arena->cache[i].frames);
+  free(arena);
+#if _TLS_IMPL == COMPILER_TLS
+  thread_arena = NULL;
+#endif
+}
+
+/*
+ * Initialize an empty context.
+ */
+static void init_context_storage(rewrite_context ctx, bool pooled)
+{
+  ctx->acts = NULL;
+  ctx->regset_pool = NULL;
+  ctx->callee_saved_pool = NULL;
+  ctx->acts_pool_size = 0;
+  ctx->regset_pool_size = 0;
+  ctx->callee_saved_pool_size = 0;
+  ctx->pool_frames = 0;
+  ctx->pooled = pooled;
+  fixup_index_init(&ctx->stack_pointers, NULL, 0);
+}
+
+/*
+ * Free a context's storage.
+ */
+static void free_context_storage(rewrite_context ctx)
+{
+  free(ctx->acts);
+  free(ctx->regset_pool);
+  free(ctx->callee_saved_pool);
+  fixup_index_free(&ctx->stack_pointers);
+  init_context_storage(ctx, ctx->pooled);
+}
+
+/*
+ * Resize a context's pools & point activations which have already been set up
+ * at their new storage.  On failure, the context's pools are left untouched.
+ */
+static void resize_pools(rewrite_context ctx, int num_frames)
+{
+  int i;
+  size_t regset_size = REGOPS(ctx)->regset_size;
+  size_t callee_size = bitmap_size(REGOPS(ctx)->num_regs);
+  size_t new_acts_size = sizeof(activation) * num_frames;
+  size_t new_regset_size = regset_size * num_frames;
+  size_t new_callee_size = callee_size * num_frames;
+  activation* acts;
+  void* regset_pool, *callee_pool;
+
+  acts = (activation*)MALLOC(new_acts_size);
+  regset_pool = MALLOC(new_regset_size);
+  callee_pool = MALLOC(new_callee_size);
+  if(!acts || !regset_pool || !callee_pool)
+  {
+    free(acts);
+    free(regset_pool);
+    free(callee_pool);
+    return;
+  }
+
+  /*
+   * Copy activations which have already been set up.  Destination activations
+   * may have call site information past the current activation, so copy
+   * everything.
+   */
+  if(ctx->pool_frames)
+  {
+    memcpy(acts, ctx->acts, sizeof(activation) * ctx->pool_frames);
+    memcpy(regset_pool, ctx->regset_pool, regset_size * ctx->pool_frames);
+    memcpy(callee_pool, ctx->callee_saved_pool, callee_size * ctx->pool_frames);
+    for(i = 0; i < ctx->pool_frames; i++)
+    {
+      acts[i].regs = regset_pool + (i * regset_size);
+      acts[i].callee_saved.bits = callee_pool + (i * callee_size);
+    }
+  }
+
+  free(ctx->acts);
+  free(ctx->regset_pool);
+  free(ctx->callee_saved_pool);
+  ctx->acts = acts;
+  ctx->regset_pool = regset_pool;
+  ctx->callee_saved_pool = callee_pool;
+  ctx->acts_pool_size = new_acts_size;
+  ctx->regset_pool_size = new_regset_size;
+  ctx->callee_saved_pool_size = new_callee_size;
+  ctx->pool_frames = num_frames;
+}
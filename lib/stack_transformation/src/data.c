@@ -110,6 +110,41 @@ void put_val(rewrite_context src,
   ASSERT(dest_addr, "invalid destination location\n");
   memcpy(dest_addr, src_addr, VAL_SIZE(dest_val));
   if(callee_addr) memcpy(callee_addr, src_addr, VAL_SIZE(dest_val));
+  COUNT_BYTES(dest, dest->act, bytes_moved, VAL_SIZE(dest_val));
+  TALLY(dest, bytes, VAL_SIZE(dest_val));
+
+  TIMER_FG_STOP(put_val);
+}
+
+/*
+ * Copy a run of contiguous stack slots from SRC to DEST.
+ */
+void put_val_run(rewrite_context src,
+                 const live_value* src_val,
+                 rewrite_context dest,
+                 const live_value* dest_val,
+                 size_t size)
+{
+  const void* src_addr;
+  void* dest_addr;
+
+  TIMER_FG_START(put_val);
+  ASSERT(src->act == dest->act, "non-matching activations (%u vs. %u)\n",
+         src->act, dest->act);
+  ASSERT((src_val->type == SM_DIRECT || src_val->type == SM_INDIRECT) &&
+         (dest_val->type == SM_DIRECT || dest_val->type == SM_INDIRECT),
+         "invalid value types (must be stack slots for bulk copies)\n");
+
+  ST_INFO("Getting source run: ");
+  src_addr = get_src_loc(src, src_val, src->act);
+  ST_INFO("Putting destination run (size=%lu): ", size);
+  dest_addr = get_dest_loc(dest, dest_val, src->act);
+
+  ASSERT(dest_addr, "invalid destination location\n");
+  memcpy(dest_addr, src_addr, size);
+  COUNT_BYTES(dest, dest->act, bytes_moved, size);
+  COUNT_BYTES(dest, dest->act, bytes_bulk, size);
+  TALLY(dest, bytes, size);
 
   TIMER_FG_STOP(put_val);
 }
@@ -135,6 +170,8 @@ void put_val_arch(rewrite_context ctx, const arch_live_value* val)
 
   ST_INFO("Arch-specific live value: ");
   apply_arch_operation(ctx, dest_addr, callee_addr, val);
+  COUNT_BYTES(ctx, ctx->act, bytes_moved, val->size);
+  TALLY(ctx, bytes, val->size);
 
   TIMER_FG_STOP(put_val);
 }
@@ -166,6 +203,8 @@ void put_val_data(rewrite_context ctx,
   ASSERT(dest_addr, "invalid destination location\n");
   memcpy(dest_addr, &data, sizeof(uint64_t));
   if(callee_addr) memcpy(callee_addr, &data, sizeof(data));
+  COUNT_BYTES(ctx, act, bytes_moved, sizeof(uint64_t));
+  TALLY(ctx, bytes, sizeof(uint64_t));
 
   TIMER_FG_STOP(put_val);
 }
@@ -229,35 +268,14 @@ void* points_to_stack(const rewrite_context ctx,
 }
 
 /*
- * Return whether or not a pointer refers to the specified live value.
+ * Get the address of a stack allocation in the current frame.
  */
-void* points_to_data(const rewrite_context src,
-                     const live_value* src_val,
-                     const rewrite_context dest,
-                     const live_value* dest_val,
-                     void* src_ptr)
+void* alloca_addr(const rewrite_context ctx, const live_value* val)
 {
-  void* src_addr, *dest_addr = NULL;
-
-  ASSERT(src_val->type == SM_DIRECT && dest_val->type == SM_DIRECT,
-         "invalid value types (must be allocas for pointed-to analysis)\n");
-
-  ST_INFO("Checking if %p points to: ", src_ptr);
-  src_addr = get_val_loc(src, src_val->type,
-                         src_val->regnum,
-                         src_val->offset_or_constant,
-                         src->act);
-  if(src_addr <= src_ptr && src_ptr < (src_addr + src_val->alloca_size))
-  {
-    ST_INFO("Reifying address of source value %p to: ", src_addr);
-    dest_addr = get_val_loc(dest, dest_val->type,
-                            dest_val->regnum,
-                            dest_val->offset_or_constant,
-                            dest->act);
-    dest_addr += (src_ptr - src_addr);
-  }
-
-  return dest_addr;
+  ASSERT(val->type == SM_DIRECT && val->is_alloca,
+         "invalid value type (must be an alloca)\n");
+  return get_val_loc(ctx, val->type, val->regnum, val->offset_or_constant,
+                     ctx->act);
 }
 
 /*
@@ -391,10 +409,10 @@ static void* callee_saved_loc(rewrite_context ctx,
   void* saved_addr;
 
   /* Nothing to propagate from outermost frame */
-  if(act <= 0) return NULL;
+  if(act <= ctx->base_act) return NULL;
 
   /* Walk call chain to check if register has been saved. */
-  for(act--; act >= 0; act--)
+  for(act--; act >= ctx->base_act; act--)
   {
     if(bitmap_is_set(ctx->acts[act].callee_saved, regnum))
     {
@@ -408,7 +426,7 @@ static void* callee_saved_loc(rewrite_context ctx,
 
   /* Register is still live in outermost frame. */
   ST_INFO("Callee-saved register %u live in outer-most frame\n", regnum);
-  return REGOPS(ctx)->reg(ctx->acts[0].regs, regnum);
+  return REGOPS(ctx)->reg(ctx->acts[ctx->base_act].regs, regnum);
 }
 
 static void apply_arch_operation(rewrite_context ctx,
@@ -0,0 +1,167 @@
+/*
+ * Index of pointer-to-stack fixup records, sorted by pointed-to source address.
+ * Replaces scanning a list of every outstanding fixup for every stack
+ * allocation, which is quadratic in the number of pointers to the stack.
+ *
+ * Date: 10/16/2026
+ */
+
+#include "fixup.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Grow record storage BUF (with capacity CAP, holding NUM records) so it can
+ * hold at least MIN records, moving it to the heap if necessary.
+ */
+static void grow_storage(fixup** buf, size_t* cap, size_t num, size_t min,
+                         bool* heap);
+
+/*
+ * Sort fixup records by source address, for qsort().
+ */
+static int fixup_cmp(const void* a, const void* b);
+
+///////////////////////////////////////////////////////////////////////////////
+// Fixup index operations
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Initialize a fixup index.
+ */
+void fixup_index_init(fixup_index* index, fixup* pool, size_t pool_size)
+{
+  ASSERT(index, "invalid argument to fixup_index_init()\n");
+  index->num_sorted = 0;
+  index->num_resolved = 0;
+  index->num_pending = 0;
+  index->heap_sorted = false;
+  index->heap_pending = false;
+  if(pool)
+  {
+    index->sorted = pool;
+    index->cap_sorted = pool_size;
+    index->pending = pool + pool_size;
+    index->cap_pending = pool_size;
+  }
+  else
+  {
+    index->sorted = index->pending = NULL;
+    index->cap_sorted = index->cap_pending = 0;
+  }
+}
+
+/*
+ * Free heap storage used by a fixup index.
+ */
+void fixup_index_free(fixup_index* index)
+{
+  ASSERT(index, "invalid argument to fixup_index_free()\n");
+  if(index->heap_sorted) free(index->sorted);
+  if(index->heap_pending) free(index->pending);
+  fixup_index_init(index, NULL, 0);
+}
+
+/*
+ * Add a fixup record to the pending records.
+ */
+void fixup_index_add(fixup_index* index, const fixup* data)
+{
+  ASSERT(index && data, "invalid arguments to fixup_index_add()\n");
+  if(index->num_pending == index->cap_pending)
+    grow_storage(&index->pending, &index->cap_pending, index->num_pending,
+                 index->num_pending + 1, &index->heap_pending);
+  index->pending[index->num_pending++] = *data;
+}
+
+/*
+ * Merge pending records into the sorted records.
+ */
+void fixup_index_merge(fixup_index* index)
+{
+  size_t i, j, num;
+
+  ASSERT(index, "invalid argument to fixup_index_merge()\n");
+
+  /* Compact away resolved records */
+  if(index->num_resolved)
+  {
+    for(i = 0, j = 0; i < index->num_sorted; i++)
+      if(index->sorted[i].dest_loc) index->sorted[j++] = index->sorted[i];
+    index->num_sorted = j;
+    index->num_resolved = 0;
+  }
+
+  if(!index->num_pending) return;
+
+  /* Sort pending records & merge backwards so records are moved only once */
+  qsort(index->pending, index->num_pending, sizeof(fixup), fixup_cmp);
+  num = index->num_sorted + index->num_pending;
+  if(num > index->cap_sorted)
+    grow_storage(&index->sorted, &index->cap_sorted, index->num_sorted, num,
+                 &index->heap_sorted);
+
+  i = index->num_sorted;
+  j = index->num_pending;
+  while(j)
+  {
+    if(i && index->sorted[i - 1].src_addr > index->pending[j - 1].src_addr)
+      index->sorted[--num] = index->sorted[--i];
+    else
+      index->sorted[--num] = index->pending[--j];
+  }
+  index->num_sorted += index->num_pending;
+  index->num_pending = 0;
+}
+
+/*
+ * Binary search for the first record pointing at or above SRC_ADDR.
+ */
+size_t fixup_index_find(const fixup_index* index, const void* src_addr)
+{
+  size_t lo = 0, hi = index->num_sorted, mid;
+
+  while(lo < hi)
+  {
+    mid = lo + ((hi - lo) / 2);
+    if(index->sorted[mid].src_addr < src_addr) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API implementation
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Grow record storage, doubling its capacity.
+ */
+static void grow_storage(fixup** buf, size_t* cap, size_t num, size_t min,
+                         bool* heap)
+{
+  size_t new_cap = *cap ? *cap : FIXUP_POOL;
+  fixup* new_buf;
+
+  while(new_cap < min) new_cap *= 2;
+  new_buf = (fixup*)MALLOC(sizeof(fixup) * new_cap);
+  if(!new_buf) ST_ERR(1, "could not allocate fixup records\n");
+  if(num) memcpy(new_buf, *buf, sizeof(fixup) * num);
+  if(*heap) free(*buf);
+  *buf = new_buf;
+  *cap = new_cap;
+  *heap = true;
+}
+
+/*
+ * Compare fixup records by source address.
+ */
+static int fixup_cmp(const void* a, const void* b)
+{
+  const fixup* fa = (const fixup*)a, *fb = (const fixup*)b;
+  if(fa->src_addr < fb->src_addr) return -1;
+  else if(fa->src_addr > fb->src_addr) return 1;
+  else return 0;
+}
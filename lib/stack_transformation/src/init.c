@@ -9,16 +9,22 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "stack_transform.h"
 #include "unwind.h"
 #include "util.h"
+#include "site_pairs.h"
 
 #ifdef _LOG
 /* Log file descriptor */
 FILE* __log = NULL;
 #endif
 
+/* Generation of the most recently initialized handle */
+static uint64_t generation = 0;
+
 /* Userspace constructors & destructors */
 extern void __st_userspace_ctor(void);
 extern void __st_userspace_dtor(void);
@@ -52,6 +58,17 @@ __st_dtor(void)
 #endif
 }
 
+#ifdef _MMAP_METADATA
+
+/*
+ * Map the binary opened in HANDLE and point the handle's metadata directly
+ * into the mapping.  Returns true if successful, or false (without modifying
+ * the handle's mapping) if the binary should be read using libELF instead.
+ */
+static bool map_metadata(st_handle handle);
+
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // Initialization & teardown
 ///////////////////////////////////////////////////////////////////////////////
@@ -74,9 +91,24 @@ st_handle st_init(const char* fn)
 
   if(!(handle = (st_handle)MALLOC(sizeof(struct _st_handle)))) goto return_null;
   handle->fn = fn;
+  handle->elf = NULL;
+  handle->map = NULL;
+  handle->map_size = 0;
+  handle->generation = __atomic_add_fetch(&generation, 1, __ATOMIC_RELAXED);
+  handle->pairs = NULL;
 
-  /* Initialize libelf data */
   if((handle->fd = open(fn, O_RDONLY, 0)) < 0) goto free_handle;
+
+#ifdef _MMAP_METADATA
+  /* Fast path: point directly into a read-only mapping of the binary */
+  if(!getenv(ENV_NO_MMAP))
+  {
+    if(map_metadata(handle)) goto metadata_loaded;
+    ST_INFO("could not map metadata, falling back to libELF\n");
+  }
+#endif
+
+  /* Initialize libelf data */
   if(!(handle->elf = elf_begin(handle->fd, ELF_C_READ, NULL))) goto close_file;
 
   /* Get architecture-specific information */
@@ -160,16 +192,28 @@ st_handle st_init(const char* fn)
   else
     ST_INFO("no architecture-specific live value location records\n");
 
+#ifdef _MMAP_METADATA
+metadata_loaded:
+#endif
+  if(!init_site_index(handle))
+    ST_INFO("no call site indexes, using binary search\n");
+
   /* Get architecture-specific register operations & stack properties. */
-  if(!(handle->regops = get_regops(handle->arch))) goto close_elf;
-  if(!(handle->props = get_properties(handle->arch))) goto close_elf;
+  if(!(handle->regops = get_regops(handle->arch))) goto free_index;
+  if(!(handle->props = get_properties(handle->arch))) goto free_index;
+
+  /* Call site translation tables are built on first use */
+  if(pthread_mutex_init(&handle->pairs_lock, NULL)) goto free_index;
 
   TIMER_STOP(st_init);
 
   return handle;
 
+free_index:
+  free_site_index(handle);
 close_elf:
-  elf_end(handle->elf);
+  if(handle->map) munmap(handle->map, handle->map_size);
+  else elf_end(handle->elf);
 close_file:
   close(handle->fd);
 free_handle:
@@ -189,10 +233,145 @@ void st_destroy(st_handle handle)
   TIMER_START(st_destroy);
   ST_INFO("Cleaning up handle for '%s'\n", handle->fn);
 
-  elf_end(handle->elf);
+  free_site_pairs(handle);
+  pthread_mutex_destroy(&handle->pairs_lock);
+  free_site_index(handle);
+  if(handle->map) munmap(handle->map, handle->map_size);
+  else elf_end(handle->elf);
   close(handle->fd);
   free(handle);
 
   TIMER_STOP(st_destroy);
 }
 
+#ifdef _MMAP_METADATA
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API (implementation)
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Find section SEC in the mapping at MAP and return a pointer to its contents,
+ * storing the number of entries in ENTRIES.  Returns NULL if the section was
+ * not found or is malformed.
+ */
+static const void* get_mapped_section(const void* map,
+                                      size_t size,
+                                      const Elf64_Shdr* shdrs,
+                                      uint16_t shnum,
+                                      const Elf64_Shdr* strtab,
+                                      const char* sec,
+                                      uint64_t* entries)
+{
+  const char* names = (const char*)map + strtab->sh_offset;
+  size_t len = strlen(sec) + 1;
+  uint16_t i;
+
+  if(strtab->sh_size < len) return NULL;
+  for(i = 0; i < shnum; i++)
+  {
+    if(shdrs[i].sh_name > strtab->sh_size - len) continue;
+    if(memcmp(names + shdrs[i].sh_name, sec, len)) continue;
+
+    if(shdrs[i].sh_type == SHT_NOBITS || !shdrs[i].sh_entsize ||
+       shdrs[i].sh_offset > size || shdrs[i].sh_size > size - shdrs[i].sh_offset)
+      return NULL;
+    *entries = shdrs[i].sh_size / shdrs[i].sh_entsize;
+    return (const char*)map + shdrs[i].sh_offset;
+  }
+  return NULL;
+}
+
+/*
+ * Map the binary & find stack transformation sections using the section
+ * header table directly.  Returns false (leaving the binary to libELF) if any
+ * section is missing or malformed.
+ */
+static bool map_metadata(st_handle handle)
+{
+  struct stat st;
+  void* map;
+  size_t size;
+  uint64_t num_addrs = 0;
+  const Elf64_Ehdr* ehdr;
+  const Elf64_Shdr* shdrs, *strtab;
+
+  TIMER_START(map_metadata);
+
+  if(fstat(handle->fd, &st) || st.st_size < (off_t)sizeof(Elf64_Ehdr))
+    goto return_false;
+  size = st.st_size;
+  map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, handle->fd, 0);
+  if(map == MAP_FAILED) goto return_false;
+
+  /*
+   * Only handle the common case directly: 64-bit binaries in the host's byte
+   * order without extended section numbering.  Let libELF sort out the rest.
+   */
+  ehdr = (const Elf64_Ehdr*)map;
+  if(memcmp(ehdr->e_ident, ELFMAG, SELFMAG) ||
+     ehdr->e_ident[EI_CLASS] != ELFCLASS64 ||
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+     ehdr->e_ident[EI_DATA] != ELFDATA2LSB ||
+#else
+     ehdr->e_ident[EI_DATA] != ELFDATA2MSB ||
+#endif
+     ehdr->e_shentsize != sizeof(Elf64_Shdr) ||
+     ehdr->e_shnum == 0 || ehdr->e_shstrndx >= ehdr->e_shnum ||
+     ehdr->e_shoff > size ||
+     ehdr->e_shnum * sizeof(Elf64_Shdr) > size - ehdr->e_shoff)
+    goto unmap;
+
+  shdrs = (const Elf64_Shdr*)((const char*)map + ehdr->e_shoff);
+  strtab = &shdrs[ehdr->e_shstrndx];
+  if(strtab->sh_offset > size || strtab->sh_size > size - strtab->sh_offset)
+    goto unmap;
+
+#define GET_SECTION( name, count ) \
+  get_mapped_section(map, size, shdrs, ehdr->e_shnum, strtab, name, count)
+
+  /*
+   * As when reading through libELF, every section must be present but only
+   * the live value sections may be empty.  Binaries we can't handle here fall
+   * back to libELF, so both paths accept the same binaries.
+   */
+  handle->unwind_addrs = GET_SECTION(SECTION_ST_UNWIND_ADDR,
+                                     &handle->unwind_addr_count);
+  handle->unwind_locs = GET_SECTION(SECTION_ST_UNWIND, &handle->unwind_count);
+  handle->sites_id = GET_SECTION(SECTION_ST_ID, &handle->sites_count);
+  handle->sites_addr = GET_SECTION(SECTION_ST_ADDR, &num_addrs);
+  handle->live_vals = GET_SECTION(SECTION_ST_LIVE, &handle->live_vals_count);
+  handle->arch_live_vals = GET_SECTION(SECTION_ST_ARCH_LIVE,
+                                       &handle->arch_live_vals_count);
+
+#undef GET_SECTION
+
+  if(!handle->unwind_addrs || !handle->unwind_locs || !handle->sites_id ||
+     !handle->sites_addr || !handle->live_vals || !handle->arch_live_vals ||
+     !handle->unwind_addr_count || !handle->unwind_count ||
+     !handle->sites_count || handle->sites_count != num_addrs)
+    goto unmap;
+
+  handle->arch = ehdr->e_machine;
+  handle->ptr_size = 8;
+  handle->map = map;
+  handle->map_size = size;
+
+  ST_INFO("Mapped metadata (%lu unwind address, %lu unwind, %lu call site, "
+          "%lu live value, %lu arch-specific live value entries)\n",
+          handle->unwind_addr_count, handle->unwind_count,
+          handle->sites_count, handle->live_vals_count,
+          handle->arch_live_vals_count);
+
+  TIMER_STOP(map_metadata);
+  return true;
+
+unmap:
+  munmap(map, size);
+return_false:
+  TIMER_STOP(map_metadata);
+  return false;
+}
+
+#endif
+
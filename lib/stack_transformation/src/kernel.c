@@ -0,0 +1,173 @@
+/*
+ * Rewriting kernels, i.e., per-frame unwinding & live value copying
+ * operations instantiated for every pair of source & destination ISAs from
+ * the templates in kernel_isa.h & kernel_pair.h.
+ *
+ * Date: 10/16/2026
+ */
+
+#include <libelf/gelf.h>
+
+#include "arch.h"
+#include "kernel.h"
+#include "unwind.h"
+#include "arena.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API & definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/* Operations which go through the handles' function pointer tables. */
+static const rewrite_kernel generic_kernel = {
+  .pop_frame_src = pop_frame,
+  .pop_frame_dest = pop_frame,
+  .rewrite_vals = rewrite_vals,
+};
+
+#ifdef _REWRITE_KERNELS
+
+#include "arch/aarch64/ops.h"
+#include "arch/powerpc64/ops.h"
+#include "arch/x86_64/ops.h"
+
+/* Paste together names of operations & the ISA(s) they're specialized for */
+#define KERNEL_NAME( name, isa ) KERNEL_NAME_( name, isa )
+#define KERNEL_NAME_( name, isa ) name##_##isa
+
+/* Per-ISA operations */
+#define ISA aarch64
+#define ISA_REGSET struct regset_aarch64
+#define ISA_NUM_REGS AARCH64_NUM_REGS
+#define ISA_HAS_RA_REG true
+#include "kernel_isa.h"
+#undef ISA
+#undef ISA_REGSET
+#undef ISA_NUM_REGS
+#undef ISA_HAS_RA_REG
+
+#define ISA powerpc64
+#define ISA_REGSET struct regset_powerpc64
+#define ISA_NUM_REGS POWERPC64_NUM_REGS
+#define ISA_HAS_RA_REG true
+#include "kernel_isa.h"
+#undef ISA
+#undef ISA_REGSET
+#undef ISA_NUM_REGS
+#undef ISA_HAS_RA_REG
+
+#define ISA x86_64
+#define ISA_REGSET struct regset_x86_64
+#define ISA_NUM_REGS X86_64_NUM_REGS
+#define ISA_HAS_RA_REG false
+#include "kernel_isa.h"
+#undef ISA
+#undef ISA_REGSET
+#undef ISA_NUM_REGS
+#undef ISA_HAS_RA_REG
+
+/* Per-pair operations */
+#define SRC_ISA aarch64
+#define DEST_ISA aarch64
+#include "kernel_pair.h"
+#undef DEST_ISA
+#define DEST_ISA powerpc64
+#include "kernel_pair.h"
+#undef DEST_ISA
+#define DEST_ISA x86_64
+#include "kernel_pair.h"
+#undef DEST_ISA
+#undef SRC_ISA
+
+#define SRC_ISA powerpc64
+#define DEST_ISA aarch64
+#include "kernel_pair.h"
+#undef DEST_ISA
+#define DEST_ISA powerpc64
+#include "kernel_pair.h"
+#undef DEST_ISA
+#define DEST_ISA x86_64
+#include "kernel_pair.h"
+#undef DEST_ISA
+#undef SRC_ISA
+
+#define SRC_ISA x86_64
+#define DEST_ISA aarch64
+#include "kernel_pair.h"
+#undef DEST_ISA
+#define DEST_ISA powerpc64
+#include "kernel_pair.h"
+#undef DEST_ISA
+#define DEST_ISA x86_64
+#include "kernel_pair.h"
+#undef DEST_ISA
+#undef SRC_ISA
+
+/* Kernels indexed by source & destination ISA */
+static const rewrite_kernel* const kernels[NUM_ARCHES][NUM_ARCHES] = {
+  [ARCH_AARCH64] = {
+    [ARCH_AARCH64] = &kernel_aarch64_aarch64,
+    [ARCH_POWERPC64] = &kernel_aarch64_powerpc64,
+    [ARCH_X86_64] = &kernel_aarch64_x86_64,
+  },
+  [ARCH_POWERPC64] = {
+    [ARCH_AARCH64] = &kernel_powerpc64_aarch64,
+    [ARCH_POWERPC64] = &kernel_powerpc64_powerpc64,
+    [ARCH_X86_64] = &kernel_powerpc64_x86_64,
+  },
+  [ARCH_X86_64] = {
+    [ARCH_AARCH64] = &kernel_x86_64_aarch64,
+    [ARCH_POWERPC64] = &kernel_x86_64_powerpc64,
+    [ARCH_X86_64] = &kernel_x86_64_x86_64,
+  },
+};
+
+/* Whether specialized kernels have been disabled through the environment */
+static int kernels_disabled = -1;
+
+#endif /* _REWRITE_KERNELS */
+
+///////////////////////////////////////////////////////////////////////////////
+// Kernel selection
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef _REWRITE_KERNELS
+/*
+ * Convert an ELF machine (as stored in the handles) to the ISA used to index
+ * the kernel table.
+ */
+static enum arch kernel_isa(uint16_t e_machine)
+{
+  switch(e_machine)
+  {
+  case EM_AARCH64: return ARCH_AARCH64;
+  case EM_PPC64: return ARCH_POWERPC64;
+  case EM_X86_64: return ARCH_X86_64;
+  default: return ARCH_UNKNOWN;
+  }
+}
+#endif /* _REWRITE_KERNELS */
+
+/*
+ * Get the rewriting kernel for a pair of ISAs.
+ */
+const rewrite_kernel* get_rewrite_kernel(uint16_t src, uint16_t dest)
+{
+#ifdef _REWRITE_KERNELS
+  enum arch src_isa = kernel_isa(src), dest_isa = kernel_isa(dest);
+
+  // Note: racing threads all read the same environment, so no need to lock
+  if(kernels_disabled < 0) kernels_disabled = getenv(ENV_NO_KERNELS) != NULL;
+  if(!kernels_disabled && src_isa != ARCH_UNKNOWN && dest_isa != ARCH_UNKNOWN)
+    return kernels[src_isa][dest_isa];
+#endif
+  return &generic_kernel;
+}
+
+/*
+ * Return whether rewrites between two binaries use a specialized kernel.
+ */
+int st_specialized_kernel(st_handle src, st_handle dest)
+{
+  if(!src || !dest) return 0;
+  return get_rewrite_kernel(src->arch, dest->arch) != &generic_kernel;
+}
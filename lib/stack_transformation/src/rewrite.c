@@ -5,10 +5,18 @@
  * Date: 11/12/2015
  */
 
+#include <time.h>
+
 #include "stack_transform.h"
 #include "data.h"
 #include "unwind.h"
 #include "util.h"
+#include "trampoline.h"
+#include "site_pairs.h"
+#include "fixup.h"
+#include "arena.h"
+#include "kernel.h"
+#include "stats.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // File-local API & definitions
@@ -18,41 +26,36 @@
 
 #include "arch_regs.h"
 
-#define REGSET_POOL (MAX_REGSET_SIZE * MAX_FRAMES)
-#define CALLEE_POOL (MAX_CALLEE_SIZE * MAX_FRAMES)
-
 /*
- * Declare all rewriting space at compile time to avoid malloc whenever
- * possible.  We only need to declare a pair of each as each thread will only
- * ever use 2 at a time.
+ * Contexts for a thread's pending on-demand rewrite, if any.  These must
+ * survive until the thread has returned into (and we have rewritten) every
+ * frame, so they're held in the thread's arena separately from the contexts
+ * for any later rewrite.
  */
-static __thread struct rewrite_context src_ctx, dest_ctx;
-static __thread char src_regs[REGSET_POOL], dest_regs[REGSET_POOL];
-static __thread char src_callee[CALLEE_POOL], dest_callee[CALLEE_POOL];
+static __thread rewrite_context od_src = NULL, od_dest = NULL;
 
 #endif
 
 /*
  * Initialize an architecture-specific (source) context using previously
- * initialized REGSET and HANDLE.
+ * initialized REGSET and HANDLE.  ONDEMAND contexts are kept alive after the
+ * call to rewrite returns.
  */
 static rewrite_context init_src_context(st_handle handle,
                                         void* regset,
-                                        void* sp_base);
+                                        void* sp_base,
+                                        bool ondemand);
 
 /*
  * Initialize an architecture-specific (destination) context using destination
  * stack SP_BASE.  Store destination REGSET pointer to be filled with
- * destination thread's resultant register state.
+ * destination thread's resultant register state.  ONDEMAND contexts are kept
+ * alive after the call to rewrite returns.
  */
 static rewrite_context init_dest_context(st_handle handle,
                                          void* regset,
-                                         void* sp_base);
-
-/*
- * Initialize data pools for constant-time allocation.
- */
-static void init_data_pools(rewrite_context ctx);
+                                         void* sp_base,
+                                         bool ondemand);
 
 /*
  * Free previously-allocated context information.
@@ -60,23 +63,69 @@ static void init_data_pools(rewrite_context ctx);
 static void free_context(rewrite_context ctx);
 
 /*
- * Free a context's data pools.
+ * Rewrite the stack in its entirety into destination stack SP_BASE_DEST, or
+ * into a stack allocated by ALLOC (passed DATA) once its size is known.
  */
-static void free_data_pools(rewrite_context ctx);
+static int rewrite_stack(st_handle handle_src,
+                         void* regset_src,
+                         void* sp_base_src,
+                         st_handle handle_dest,
+                         void* regset_dest,
+                         void* sp_base_dest,
+                         st_stack_alloc alloc,
+                         void* data);
 
 /*
  * Unwind the source stack to find all live stack frames & determine
- * destination stack size.
+ * destination stack size.  Allocates the destination stack if necessary,
+ * returning false if it could not be allocated.
  */
-static void unwind_and_size(rewrite_context src,
+static bool unwind_and_size(rewrite_context src,
                             rewrite_context dest);
 
 /*
- * Rewrite an individual value from the source to destination call frame.
- * Returns true if there's a fixup needed within this stack frame.
+ * Look up the source & destination call sites for the current frame, whose
+ * return address is PC, and record them in FRAME (if non-NULL).
  */
-static bool rewrite_val(rewrite_context src, const live_value* val_src,
-                        rewrite_context dest, const live_value* val_dest);
+static void lookup_sites(rewrite_context src,
+                         rewrite_context dest,
+                         const site_pairs* pairs,
+                         void* pc,
+                         cached_frame* frame);
+
+#ifdef _UNWIND_CACHE
+
+/* Unwinding cache statistics, across all threads */
+static uint64_t cache_hits = 0, cache_misses = 0;
+static uint64_t hit_frames = 0, miss_frames = 0, hit_ns = 0, miss_ns = 0;
+
+/*
+ * Get the cached frame for activation ACT, growing the cache if necessary.
+ */
+static cached_frame* cache_frame(unwind_cache* cache, int act);
+
+/*
+ * Return whether a cached frame is valid for the current frame, whose return
+ * address is PC.
+ */
+static inline bool cached_frame_valid(rewrite_context src,
+                                      rewrite_context dest,
+                                      const cached_frame* frame,
+                                      void* pc);
+
+/*
+ * Account for an unwind of NUM_ACTS frames which took NS nanoseconds.
+ */
+static void account_unwind(bool hit, int num_acts, uint64_t ns);
+
+#endif
+
+/*
+ * Copy a run of live values between contiguous stack slots in bulk.
+ */
+static void rewrite_val_run(rewrite_context src,
+                            rewrite_context dest,
+                            const copy_op* ops);
 
 /*
  * Fix up pointers to same-frame data.
@@ -89,6 +138,35 @@ fixup_local_pointers(rewrite_context src, rewrite_context dest);
  */
 static void rewrite_frame(rewrite_context src, rewrite_context dest);
 
+#if _TLS_IMPL == COMPILER_TLS
+
+/*
+ * Re-write frames starting at the current activation until there are no
+ * outstanding pointers to the stack, and redirect the last frame's return
+ * into the on-demand trampoline.  Returns true if the entire stack has been
+ * rewritten.
+ */
+static bool rewrite_frames_ondemand(rewrite_context src, rewrite_context dest);
+
+/*
+ * Re-write the next frame(s) of the thread's pending on-demand rewrite and
+ * set up REGS (a register set for the current ISA) to resume in the first
+ * re-written frame.
+ */
+static void ondemand_rewrite_next(void* regs);
+
+#endif
+
+#ifdef _TIMING
+/*
+ * Print the number of bytes copied into each rewritten destination frame.
+ */
+static void print_bytes_moved(rewrite_context dest);
+# define PRINT_BYTES_MOVED( ctx ) print_bytes_moved(ctx)
+#else
+# define PRINT_BYTES_MOVED( ctx )
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // Perform stack transformation
 ///////////////////////////////////////////////////////////////////////////////
@@ -103,8 +181,51 @@ int st_rewrite_stack(st_handle handle_src,
                      void* regset_dest,
                      void* sp_base_dest)
 {
+  if(!sp_base_dest)
+  {
+    ST_WARN("invalid arguments\n");
+    return 1;
+  }
+  return rewrite_stack(handle_src, regset_src, sp_base_src,
+                       handle_dest, regset_dest, sp_base_dest, NULL, NULL);
+}
+
+/*
+ * Perform stack transformation in its entirety, from source to a destination
+ * stack allocated once its size is known.
+ */
+int st_rewrite_stack_alloc(st_handle handle_src,
+                           void* regset_src,
+                           void* sp_base_src,
+                           st_handle handle_dest,
+                           void* regset_dest,
+                           st_stack_alloc alloc,
+                           void* data)
+{
+  if(!alloc)
+  {
+    ST_WARN("invalid arguments\n");
+    return 1;
+  }
+  return rewrite_stack(handle_src, regset_src, sp_base_src,
+                       handle_dest, regset_dest, NULL, alloc, data);
+}
+
+/*
+ * Perform stack transformation for the top frame.  Replace return address so
+ * that we can intercept and transform frames on demand.
+ */
+int st_rewrite_ondemand(st_handle handle_src,
+                        void* regset_src,
+                        void* sp_base_src,
+                        st_handle handle_dest,
+                        void* regset_dest,
+                        void* sp_base_dest)
+{
+#if _TLS_IMPL == COMPILER_TLS
   rewrite_context src, dest;
-  uint64_t* saved_fbp;
+  bool finished;
+  stats_timer timer;
 
   if(!handle_src || !regset_src || !sp_base_src ||
      !handle_dest || !regset_dest || !sp_base_dest)
@@ -113,14 +234,173 @@ int st_rewrite_stack(st_handle handle_src,
     return 1;
   }
 
+  TIMER_START(st_rewrite_ondemand);
+  stats_timer_start(&timer);
+
+  ST_INFO("--> Initializing on-demand rewrite (%s -> %s) <--\n",
+          arch_name(handle_src->arch), arch_name(handle_dest->arch));
+
+  /* Initialize rewriting contexts. */
+  src = init_src_context(handle_src, regset_src, sp_base_src, true);
+  dest = init_dest_context(handle_dest, regset_dest, sp_base_dest, true);
+
+  if(!src || !dest)
+  {
+    if(src) free_context(src);
+    if(dest) free_context(dest);
+    return 1;
+  }
+  src->kernel = dest->kernel =
+    get_rewrite_kernel(handle_src->arch, handle_dest->arch);
+  stats_timer_phase(&timer, ST_PHASE_INIT);
+
+  ST_INFO("--> Unwinding source stack to find live activations <--\n");
+
+  // Note: unwinding finishes any on-demand rewrite still pending on the
+  // source stack, as the source stack's frames must be in their final form
+  if(!unwind_and_size(src, dest))
+  {
+    free_context(dest);
+    free_context(src);
+    TIMER_STOP(st_rewrite_ondemand);
+    return 1;
+  }
+  stats_timer_phase(&timer, ST_PHASE_UNWIND);
+  ASSERT(!od_src && !od_dest, "did not finish previous on-demand rewrite\n");
+
+  ST_INFO("--> Rewriting from source to destination stack <--\n");
+
+  TIMER_START(rewrite_stack);
+
+  /* Rewrite outer-most frame. */
+  ST_INFO("--> Rewriting outermost frame <--\n");
+
+  set_return_address_funcentry(dest, (void*)NEXT_ACT(dest).site.addr);
+  pop_frame_funcentry(dest);
+
+  /* Rewrite frames up until there are no pointers to the unrewritten stack */
+  finished = rewrite_frames_ondemand(src, dest);
+
+  TIMER_STOP(rewrite_stack);
+  stats_timer_phase(&timer, ST_PHASE_REWRITE);
+
+  /* Copy out register state for destination. */
+  REGOPS(dest)->regset_copyout(dest->acts[0].regs, dest->regs);
+  stats_timer_phase(&timer, ST_PHASE_FINISH);
+  stats_publish(src, dest, &timer, false);
+
+  // Note: don't clean up unless we're done, as we'll need the contexts when
+  // the thread needs to re-write the next frame
+  if(finished)
+  {
+    PRINT_BYTES_MOVED(dest);
+    free_context(dest);
+    free_context(src);
+    ST_INFO("Finished rewrite!\n");
+  }
+  else
+  {
+    od_src = src;
+    od_dest = dest;
+    ST_INFO("Rewrote %d of %d frames, remaining frames rewritten on-demand\n",
+            dest->act, dest->num_acts);
+  }
+
+  TIMER_STOP(st_rewrite_ondemand);
+  TIMER_PRINT;
+
+#ifdef _LOG
+#ifndef _PER_LOG_OPEN
+  fflush(__log);
+#endif
+#endif
+
+  return 0;
+#else
+  ST_WARN("on-demand rewriting requires compiler TLS, rewriting entire stack\n");
+  return st_rewrite_stack(handle_src, regset_src, sp_base_src,
+                          handle_dest, regset_dest, sp_base_dest);
+#endif
+}
+
+/*
+ * Rewrite the next frame(s) from the on-demand trampoline.
+ */
+void* __st_ondemand_resume(void* regset)
+{
+#if _TLS_IMPL == COMPILER_TLS
+  ondemand_rewrite_next(regset);
+#else
+  ST_ERR(1, "on-demand rewriting requires compiler TLS\n");
+#endif
+  return regset;
+}
+
+/*
+ * Get statistics for the cache of unwound call chains.
+ */
+void st_get_unwind_cache_stats(st_unwind_cache_stats* stats)
+{
+#ifdef _UNWIND_CACHE
+  uint64_t frames, ns, saved;
+#endif
+
+  if(!stats) return;
+  memset(stats, 0, sizeof(st_unwind_cache_stats));
+
+#ifdef _UNWIND_CACHE
+  stats->hits = __atomic_load_n(&cache_hits, __ATOMIC_RELAXED);
+  stats->misses = __atomic_load_n(&cache_misses, __ATOMIC_RELAXED);
+
+  /* Estimate what hits would have cost from the average cost of misses */
+  frames = __atomic_load_n(&miss_frames, __ATOMIC_RELAXED);
+  if(frames)
+  {
+    ns = __atomic_load_n(&miss_ns, __ATOMIC_RELAXED);
+    saved = (double)ns / frames *
+            __atomic_load_n(&hit_frames, __ATOMIC_RELAXED);
+    ns = __atomic_load_n(&hit_ns, __ATOMIC_RELAXED);
+    stats->saved_ns = saved > ns ? saved - ns : 0;
+  }
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API implementation
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Perform stack transformation in its entirety, from source to destination.
+ */
+static int rewrite_stack(st_handle handle_src,
+                         void* regset_src,
+                         void* sp_base_src,
+                         st_handle handle_dest,
+                         void* regset_dest,
+                         void* sp_base_dest,
+                         st_stack_alloc alloc,
+                         void* data)
+{
+  rewrite_context src, dest;
+  uint64_t* saved_fbp;
+  stats_timer timer;
+
+  if(!handle_src || !regset_src || !sp_base_src ||
+     !handle_dest || !regset_dest)
+  {
+    ST_WARN("invalid arguments\n");
+    return 1;
+  }
+
   TIMER_START(st_rewrite_stack);
+  stats_timer_start(&timer);
 
   ST_INFO("--> Initializing rewrite (%s -> %s) <--\n",
           arch_name(handle_src->arch), arch_name(handle_dest->arch));
 
   /* Initialize rewriting contexts. */
-  src = init_src_context(handle_src, regset_src, sp_base_src);
-  dest = init_dest_context(handle_dest, regset_dest, sp_base_dest);
+  src = init_src_context(handle_src, regset_src, sp_base_src, false);
+  dest = init_dest_context(handle_dest, regset_dest, sp_base_dest, false);
 
   if(!src || !dest)
   {
@@ -128,11 +408,23 @@ int st_rewrite_stack(st_handle handle_src,
     if(dest) free_context(dest);
     return 1;
   }
+  src->kernel = dest->kernel =
+    get_rewrite_kernel(handle_src->arch, handle_dest->arch);
+  dest->alloc_stack = alloc;
+  dest->alloc_data = data;
+  stats_timer_phase(&timer, ST_PHASE_INIT);
 
   ST_INFO("--> Unwinding source stack to find live activations <--\n");
 
   /* Unwind source stack to determine destination stack size. */
-  unwind_and_size(src, dest);
+  if(!unwind_and_size(src, dest))
+  {
+    free_context(dest);
+    free_context(src);
+    TIMER_STOP(st_rewrite_stack);
+    return 1;
+  }
+  stats_timer_phase(&timer, ST_PHASE_UNWIND);
 
   // Note: the following code is brittle -- it has to happen in this *exact*
   // order because of the way the stack is unwound and information in the
@@ -157,7 +449,7 @@ int st_rewrite_stack(st_handle handle_src,
     rewrite_frame(src, dest);
     saved_fbp = get_savedfbp_loc(dest);
     ASSERT(saved_fbp, "invalid saved frame pointer location\n");
-    pop_frame(dest, true);
+    dest->kernel->pop_frame_dest(dest, true);
     *saved_fbp = (uint64_t)REGOPS(dest)->fbp(ACT(dest).regs);
     ST_INFO("Old FP saved to %p\n", saved_fbp);
   }
@@ -168,9 +460,13 @@ int st_rewrite_stack(st_handle handle_src,
   rewrite_frame(src, dest);
 
   TIMER_STOP(rewrite_stack);
+  stats_timer_phase(&timer, ST_PHASE_REWRITE);
 
   /* Copy out register state for destination & clean up. */
   REGOPS(dest)->regset_copyout(dest->acts[0].regs, dest->regs);
+  PRINT_BYTES_MOVED(dest);
+  stats_timer_phase(&timer, ST_PHASE_FINISH);
+  stats_publish(src, dest, &timer, false);
   free_context(dest);
   free_context(src);
 
@@ -188,57 +484,32 @@ int st_rewrite_stack(st_handle handle_src,
   return 0;
 }
 
-/*
- * Perform stack transformation for the top frame.  Replace return address so
- * that we can intercept and transform frames on demand.
- */
-int st_rewrite_ondemand(st_handle handle_src,
-                        void* regset_src,
-                        void* sp_base_src,
-                        st_handle handle_dest,
-                        void* regset_dest,
-                        void* sp_base_dest)
-{
-  ST_ERR(1, "on-demand rewriting not yet supported\n");
-
-  // Note: don't clean up, as we'll need the contexts when the thread needs to
-  // re-write the next frame
-  return 0;
-}
-
-///////////////////////////////////////////////////////////////////////////////
-// File-local API implementation
-///////////////////////////////////////////////////////////////////////////////
-
 /*
  * Initialize an architecture-specific (source) context using previously
  * initialized REGSET and HANDLE.
  */
 static rewrite_context init_src_context(st_handle handle,
                                         void* regset,
-                                        void* sp_base)
+                                        void* sp_base,
+                                        bool ondemand)
 {
   rewrite_context ctx;
 
   TIMER_START(init_src_context);
 
-#if _TLS_IMPL == COMPILER_TLS
-  ctx = &src_ctx;
-  ctx->regset_pool = src_regs;
-  ctx->callee_saved_pool = src_callee;
-#else
-  ctx = (rewrite_context)MALLOC(sizeof(struct rewrite_context));
-#endif
-  ctx->handle = handle;
+  if(!(ctx = arena_get_context(handle)))
+  {
+    ST_WARN("could not allocate source rewriting context\n");
+    TIMER_STOP(init_src_context);
+    return NULL;
+  }
   ctx->num_acts = 1;
   ctx->act = 0;
+  ctx->base_act = 0;
   ctx->regs = regset;
   ctx->stack_base = sp_base;
+  ctx->ondemand = ondemand;
 
-#if _TLS_IMPL != COMPILER_TLS
-  init_data_pools(ctx);
-#endif
-  list_init(fixup, &ctx->stack_pointers);
   bootstrap_first_frame(ctx, regset); // Sets up initial register set
   ctx->stack = REGOPS(ctx)->sp(ACT(ctx).regs);
   ASSERT(ctx->stack, "invalid stack pointer\n");
@@ -252,6 +523,7 @@ static rewrite_context init_src_context(st_handle handle,
     ST_ERR(1, "could not get source call site information for outermost frame "
            "(address=%p)\n", REGOPS(ctx)->pc(ACT(ctx).regs));
   ACT(ctx).cfa = calculate_cfa(ctx, 0);
+  ACT(ctx).ops = NULL;
 
   TIMER_STOP(init_src_context);
   return ctx;
@@ -264,29 +536,28 @@ static rewrite_context init_src_context(st_handle handle,
  */
 static rewrite_context init_dest_context(st_handle handle,
                                          void* regset,
-                                         void* sp_base)
+                                         void* sp_base,
+                                         bool ondemand)
 {
   rewrite_context ctx;
 
   TIMER_START(init_dest_context);
 
-#if _TLS_IMPL == COMPILER_TLS
-  ctx = &dest_ctx;
-  ctx->regset_pool = dest_regs;
-  ctx->callee_saved_pool = dest_callee;
-#else
-  ctx = (rewrite_context)MALLOC(sizeof(struct rewrite_context));
-#endif
-  ctx->handle = handle;
+  if(!(ctx = arena_get_context(handle)))
+  {
+    ST_WARN("could not allocate destination rewriting context\n");
+    TIMER_STOP(init_dest_context);
+    return NULL;
+  }
   ctx->num_acts = 1;
   ctx->act = 0;
+  ctx->base_act = 0;
   ctx->regs = regset;
   ctx->stack_base = sp_base;
-
-#if _TLS_IMPL != COMPILER_TLS
-  init_data_pools(ctx);
-#endif
-  list_init(fixup, &ctx->stack_pointers);
+  ctx->ondemand = ondemand;
+  memset(&ctx->tally, 0, sizeof(rewrite_tally));
+  ctx->alloc_stack = NULL;
+  ctx->alloc_data = NULL;
 
   // Note: cannot setup frame information because CFA will be invalid, need to
   // set up SP & find call site information
@@ -295,79 +566,113 @@ static rewrite_context init_dest_context(st_handle handle,
   return ctx;
 }
 
-/*
- * Initialize the context's data pools.
- */
-static void init_data_pools(rewrite_context ctx)
-{
-  size_t num_regs = REGOPS(ctx)->num_regs;
-  ctx->regset_pool = MALLOC(REGOPS(ctx)->regset_size * MAX_FRAMES);
-  ctx->callee_saved_pool = MALLOC(bitmap_size(num_regs) * MAX_FRAMES);
-  ASSERT(ctx->callee_saved_pool && ctx->regset_pool,
-         "could not initialize data pools");
-}
-
 /*
  * Free an architecture-specific context.
  */
 static void free_context(rewrite_context ctx)
 {
-  node_t(fixup)* node;
+  size_t i;
+  fixup_index* index = &ctx->stack_pointers;
 
   TIMER_START(free_context);
 
-  node = list_begin(fixup, &ctx->stack_pointers);
-  while(node)
-  {
+  fixup_index_merge(index);
+  for(i = 0; i < index->num_sorted; i++)
     ST_WARN("could not find stack pointer fixup for %p (in activation %d)\n",
-            node->data.src_addr, node->data.act);
-    node = list_remove(fixup, &ctx->stack_pointers, node);
-  }
+            index->sorted[i].src_addr, index->sorted[i].act);
 
 #ifdef _CHECKS
-  int i;
-  for(i = 0; i < ctx->num_acts; i++)
-    clear_activation(ctx->handle, &ctx->acts[i]);
-#endif
-#if _TLS_IMPL != COMPILER_TLS
-  free_data_pools(ctx);
-  free(ctx);
+  int act;
+  for(act = 0; act < ctx->num_acts; act++)
+    clear_activation(ctx->handle, &ctx->acts[act]);
 #endif
 
+  // Note: the context's storage is kept for the thread's next rewrite
+  arena_put_context(ctx);
+
   TIMER_STOP(free_context);
 }
 
+#ifdef _TIMING
 /*
- * Free a rewrite context's data pools.
+ * Print the number of bytes copied into each rewritten destination frame.
  */
-static void free_data_pools(rewrite_context ctx)
+static void print_bytes_moved(rewrite_context dest)
 {
-  free(ctx->regset_pool);
-  free(ctx->callee_saved_pool);
-#ifdef _DEBUG
-  ctx->regset_pool = NULL;
-  ctx->callee_saved_pool = NULL;
-#endif
+  int i;
+  size_t moved = 0, bulk = 0;
+
+  printf("[Timing] Bytes moved (%s):\n", arch_name(dest->handle->arch));
+  for(i = 1; i < dest->num_acts; i++)
+  {
+    printf("[Timing]   frame %d - %lu byte(s), %lu in bulk copies\n",
+           i, dest->acts[i].bytes_moved, dest->acts[i].bytes_bulk);
+    moved += dest->acts[i].bytes_moved;
+    bulk += dest->acts[i].bytes_bulk;
+  }
+  printf("[Timing]   total - %lu byte(s), %lu in bulk copies\n", moved, bulk);
 }
+#endif
 
 /*
  * Unwind source stack to find live frames & size destination stack.
  * Simultaneously caches function & call-site information.
  */
-static void unwind_and_size(rewrite_context src,
+static bool unwind_and_size(rewrite_context src,
                             rewrite_context dest)
 {
   size_t stack_size = 8; // Account for possible already-pushed return address
-  void* fn;
+  void* fn, *pc;
+  const site_pairs* pairs;
+#ifdef _UNWIND_CACHE
+  int64_t idx;
+  unwind_cache* cache;
+  cached_frame* frame;
+  bool hit;
+  struct timespec start, end;
+#endif
 
   TIMER_START(unwind_and_size);
 
+  /* Pre-resolved call sites & live values, if available */
+  pairs = get_site_pairs(src->handle, dest->handle);
+
+#ifdef _UNWIND_CACHE
+  /* Does the outermost frame match the thread's last unwound call chain? */
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pc = REGOPS(src)->pc(ACT(src).regs);
+  if((cache = arena_get_unwind_cache(src->handle, dest->handle)) &&
+     (frame = cache_frame(cache, 0)))
+  {
+    hit = cache->num_acts && frame->pc == pc;
+    frame->pc = pc;
+  }
+  else
+  {
+    cache = NULL;
+    hit = false;
+  }
+#endif
+
   do
   {
-    pop_frame(src, false);
+    src->kernel->pop_frame_src(src, false);
+#if _TLS_IMPL == COMPILER_TLS
+    /*
+     * Frames belonging to a previous on-demand rewrite have not been
+     * transformed yet -- finish them before continuing to unwind.
+     */
+    if(REGOPS(src)->pc(ACT(src).regs) == (void*)__st_ondemand_trampoline)
+    {
+      ASSERT(od_dest && od_dest->handle->arch == src->handle->arch,
+             "invalid on-demand rewriting state\n");
+      ondemand_rewrite_next(ACT(src).regs);
+    }
+#endif
     src->num_acts++;
     dest->num_acts++;
     dest->act++;
+    if(dest->act >= dest->pool_frames) arena_grow_pools(dest, dest->act + 1);
 
     ST_INFO("Stack Activation Number = %d\n", ACT(src).site.id);
 
@@ -375,13 +680,34 @@ static void unwind_and_size(rewrite_context src,
      * Call site meta-data will be used to get return addresses, canonical
      * frame addresses and frame-base pointer locations.
      */
-    if(!get_site_by_addr(src->handle, REGOPS(src)->pc(ACT(src).regs), &ACT(src).site))
-      ST_ERR(1, "could not get source call site information (address=%p)\n",
-             REGOPS(src)->pc(ACT(src).regs));
+    pc = REGOPS(src)->pc(ACT(src).regs);
+#ifdef _UNWIND_CACHE
+    frame = cache ? cache_frame(cache, src->act) : NULL;
+    if(cache && !frame)
+    {
+      cache->num_acts = 0;
+      cache = NULL;
+      hit = false;
+    }
 
-    if(!get_site_by_id(dest->handle, ACT(src).site.id, &ACT(dest).site))
-      ST_ERR(1, "could not get destination call site information (address=%p, ID=%ld)\n",
-             REGOPS(src)->pc(ACT(src).regs), ACT(src).site.id);
+    /* Validate the return address against the cached call chain */
+    if(hit && src->act < cache->num_acts &&
+       cached_frame_valid(src, dest, frame, pc))
+    {
+      idx = frame->src_idx;
+      ACT(src).site = src->handle->sites_addr[idx];
+      ACT(dest).site = *frame->dest;
+      ACT(src).ops = (pairs && pairs->pairs[idx].dest == frame->dest) ?
+                     pairs->pairs[idx].ops : NULL;
+    }
+    else
+    {
+      hit = false;
+      lookup_sites(src, dest, pairs, pc, frame);
+    }
+#else
+    lookup_sites(src, dest, pairs, pc, NULL);
+#endif
 
     /* Update stack size with newly discovered stack frame's size */
     stack_size += ACT(dest).site.frame_size;
@@ -392,11 +718,40 @@ static void unwind_and_size(rewrite_context src,
   }
   while(!first_frame(ACT(src).site.id));
 
+#ifdef _UNWIND_CACHE
+  /* Remember the call chain for the next unwind & account for savings */
+  hit = hit && cache->num_acts == src->num_acts;
+  if(!hit && cache)
+  {
+    cache->src = src->handle;
+    cache->dest = dest->handle;
+    cache->num_acts = src->num_acts;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  account_unwind(hit, src->num_acts,
+                 (end.tv_sec - start.tv_sec) * 1000000000UL +
+                 end.tv_nsec - start.tv_nsec);
+#endif
+
   ASSERT(stack_size < MAX_STACK_SIZE / 2, "invalid stack size\n");
 
   ST_INFO("Number of live activations: %d\n", src->num_acts);
   ST_INFO("Destination stack size: %lu\n", stack_size);
 
+  /* Allocate the destination stack now that we know how big it must be */
+  if(!dest->stack_base)
+  {
+    ASSERT(dest->alloc_stack, "no destination stack\n");
+    if(!(dest->stack_base = dest->alloc_stack(stack_size, dest->alloc_data)))
+    {
+      ST_WARN("could not allocate destination stack (%lu bytes)\n",
+              stack_size);
+      TIMER_STOP(unwind_and_size);
+      return false;
+    }
+    ST_INFO("Allocated destination stack: %p\n", dest->stack_base);
+  }
+
   /* Reset to outer-most frame. */
   src->act = 0;
   dest->act = 0;
@@ -416,18 +771,164 @@ static void unwind_and_size(rewrite_context src,
                                      dest->num_acts);
 
   TIMER_STOP(unwind_and_size);
+  return true;
+}
+
+/*
+ * Look up the source & destination call sites for the current frame.
+ */
+static void lookup_sites(rewrite_context src,
+                         rewrite_context dest,
+                         const site_pairs* pairs,
+                         void* pc,
+                         cached_frame* frame)
+{
+  int64_t idx;
+
+  idx = get_site_idx_by_addr(src->handle, pc);
+  if(idx < 0)
+    ST_ERR(1, "could not get source call site information (address=%p)\n",
+           pc);
+  ACT(src).site = src->handle->sites_addr[idx];
+
+  if(pairs && pairs->pairs[idx].dest)
+  {
+    ACT(dest).site = *pairs->pairs[idx].dest;
+    ACT(src).ops = pairs->pairs[idx].ops;
+    if(frame) frame->dest = pairs->pairs[idx].dest;
+  }
+  else
+  {
+    ACT(src).ops = NULL;
+    if(!get_site_by_id(dest->handle, ACT(src).site.id, &ACT(dest).site))
+      ST_ERR(1, "could not get destination call site information (address=%p, ID=%ld)\n",
+             pc, ACT(src).site.id);
+    if(frame)
+      frame->dest = &dest->handle->sites_id[
+                      get_site_idx_by_id(dest->handle, ACT(src).site.id)];
+  }
+
+  if(frame)
+  {
+    frame->pc = pc;
+    frame->src_idx = idx;
+  }
+}
+
+#ifdef _UNWIND_CACHE
+
+/*
+ * Get the cached frame for activation ACT.
+ */
+static cached_frame* cache_frame(unwind_cache* cache, int act)
+{
+  int cap;
+  cached_frame* frames;
+
+  if(act >= cache->cap)
+  {
+    cap = cache->cap ? cache->cap : ARENA_INIT_FRAMES;
+    while(cap <= act) cap *= 2;
+    if(!(frames = (cached_frame*)MALLOC(sizeof(cached_frame) * cap)))
+      return NULL;
+    if(cache->cap)
+      memcpy(frames, cache->frames, sizeof(cached_frame) * cache->cap);
+    free(cache->frames);
+    cache->frames = frames;
+    cache->cap = cap;
+  }
+  return &cache->frames[act];
+}
+
+/*
+ * Return whether a cached frame is valid for the current frame.  Check the
+ * call sites against the handles in case they were re-allocated after being
+ * destroyed.
+ */
+static inline bool cached_frame_valid(rewrite_context src,
+                                      rewrite_context dest,
+                                      const cached_frame* frame,
+                                      void* pc)
+{
+  const call_site* site;
+
+  if(frame->pc != pc || frame->src_idx < 0 ||
+     (uint64_t)frame->src_idx >= src->handle->sites_count)
+    return false;
+  site = &src->handle->sites_addr[frame->src_idx];
+  return site->addr == (uint64_t)pc &&
+         frame->dest >= dest->handle->sites_id &&
+         frame->dest < dest->handle->sites_id + dest->handle->sites_count &&
+         frame->dest->id == site->id;
+}
+
+/*
+ * Account for an unwind.
+ */
+static void account_unwind(bool hit, int num_acts, uint64_t ns)
+{
+  if(hit)
+  {
+    __atomic_add_fetch(&cache_hits, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hit_frames, num_acts, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hit_ns, ns, __ATOMIC_RELAXED);
+  }
+  else
+  {
+    __atomic_add_fetch(&cache_misses, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&miss_frames, num_acts, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&miss_ns, ns, __ATOMIC_RELAXED);
+  }
+}
+
+#endif
+
+/*
+ * Resolve fix-ups for pointers to a value which has been copied into the
+ * destination call frame.
+ */
+void resolve_fixups(rewrite_context src, const live_value* val_src,
+                    rewrite_context dest, const live_value* val_dest)
+{
+  size_t i;
+  void* src_addr, *dest_addr = NULL;
+  fixup_index* index = &dest->stack_pointers;
+  const fixup* data;
+
+  /* Check if value is pointed to by other values & fix up if so. */
+  // Note: can only be pointed to if value is in memory, i.e., allocas
+  if(val_src->is_alloca && !val_src->is_temporary)
+  {
+    src_addr = alloca_addr(src, val_src);
+    for(i = fixup_index_find(index, src_addr); i < index->num_sorted; i++)
+    {
+      data = &index->sorted[i];
+      if(data->src_addr >= src_addr + val_src->alloca_size) break;
+      if(!data->dest_loc) continue; // Already resolved
+
+      if(!dest_addr) dest_addr = alloca_addr(dest, val_dest);
+      ST_INFO("Found fixup for %p (in frame %d)\n",
+              data->src_addr, data->act);
+
+      put_val_data(dest,
+                   data->dest_loc,
+                   data->act,
+                   (uint64_t)(dest_addr + (data->src_addr - src_addr)));
+      fixup_index_resolve(index, i);
+      TALLY(dest, fixups, 1);
+    }
+  }
 }
 
 /*
  * Rewrite an individual value from the source to destination call frame.
  */
-static bool rewrite_val(rewrite_context src, const live_value* val_src,
-                        rewrite_context dest, const live_value* val_dest)
+bool rewrite_val(rewrite_context src, const live_value* val_src,
+                 rewrite_context dest, const live_value* val_dest)
 {
   bool skip = false, needs_local_fixup = false;
   void* stack_addr;
   fixup fixup_data;
-  node_t(fixup)* fixup_node;
 
   ASSERT(val_src && val_dest, "invalid values\n");
 
@@ -485,7 +986,7 @@ static bool rewrite_val(rewrite_context src, const live_value* val_src,
       fixup_data.src_addr = stack_addr;
       fixup_data.act = dest->act;
       fixup_data.dest_loc = val_dest;
-      list_add(fixup, &dest->stack_pointers, fixup_data);
+      fixup_index_add(&dest->stack_pointers, &fixup_data);
 
       /* Are we pointing to a value within the same frame? */
       if(stack_addr < ACT(src).cfa) needs_local_fixup = true;
@@ -497,30 +998,43 @@ static bool rewrite_val(rewrite_context src, const live_value* val_src,
   }
   else put_val(src, val_src, dest, val_dest);
 
-  /* Check if value is pointed to by other values & fix up if so. */
-  // Note: can only be pointed to if value is in memory, i.e., allocas
-  if(val_src->is_alloca && !val_src->is_temporary)
+  resolve_fixups(src, val_src, dest, val_dest);
+
+  return needs_local_fixup;
+}
+
+/*
+ * Copy a run of live values between contiguous stack slots in bulk.  Values
+ * in a run are neither pointers nor temporaries, so only fix-ups pointing
+ * into them need to be handled.
+ */
+static void rewrite_val_run(rewrite_context src,
+                            rewrite_context dest,
+                            const copy_op* ops)
+{
+  uint16_t i;
+
+  ST_INFO("Copying run of %u values (%u bytes)\n",
+          ops->run_ops, ops->run_bytes);
+  put_val_run(src, ops->src, dest, ops->dest, ops->run_bytes);
+  for(i = 0; i < ops->run_ops; i++)
+    resolve_fixups(src, ops[i].src, dest, ops[i].dest);
+}
+
+/*
+ * Copy live values using pre-matched records.
+ */
+bool rewrite_vals(rewrite_context src, rewrite_context dest)
+{
+  size_t i;
+  const copy_op* ops = ACT(src).ops;
+  bool needs_local_fixup = false;
+
+  for(i = 0; i < ACT(dest).site.num_live; i += ops[i].run_ops)
   {
-    fixup_node = list_begin(fixup, &dest->stack_pointers);
-    while(fixup_node)
-    {
-      if((stack_addr = points_to_data(src, val_src,
-                                      dest, val_dest,
-                                      fixup_node->data.src_addr)))
-      {
-        ST_INFO("Found fixup for %p (in frame %d)\n",
-                fixup_node->data.src_addr, fixup_node->data.act);
-
-        put_val_data(dest,
-                     fixup_node->data.dest_loc,
-                     fixup_node->data.act,
-                     (uint64_t)stack_addr);
-        fixup_node = list_remove(fixup, &dest->stack_pointers, fixup_node);
-      }
-      else fixup_node = list_next(fixup, fixup_node);
-    }
+    if(ops[i].run_ops > 1) rewrite_val_run(src, dest, &ops[i]);
+    else needs_local_fixup |= rewrite_val(src, ops[i].src, dest, ops[i].dest);
   }
-
   return needs_local_fixup;
 }
 
@@ -531,73 +1045,59 @@ static inline void
 fixup_local_pointers(rewrite_context src, rewrite_context dest)
 {
   size_t i, j, src_offset, dest_offset;
-  bool found_fixup;
-  void* stack_addr;
   const live_value* val_src, *val_dest;
-  node_t(fixup)* fixup_node;
+  const copy_op* ops = ACT(src).ops;
+  const fixup_index* index = &dest->stack_pointers;
 
   ST_INFO("Resolving local fix-ups\n");
 
-  // Search over all fix-ups
-  fixup_node = list_begin(fixup, &dest->stack_pointers);
-  while(fixup_node)
+  // Make fix-ups recorded while rewriting this frame searchable
+  fixup_index_merge(&dest->stack_pointers);
+
+  // TODO If the code creates a pointer to an argument, is LLVM forced to
+  // create an alloca and copy the argument into the local stack space?
+  // Otherwise, how does LLVM understand argument/register conventions?
+  src_offset = ACT(src).site.live_offset;
+  dest_offset = ACT(dest).site.live_offset;
+  for(i = 0, j = 0; j < ACT(dest).site.num_live; i++, j++)
   {
-    // TODO If the code creates a pointer to an argument, is LLVM forced to
-    // create an alloca and copy the argument into the local stack space?
-    // Otherwise, how does LLVM understand argument/register conventions?
-    if(fixup_node->data.src_addr <= ACT(src).cfa) // Is fixup in this frame?
+    /*
+     * Skip duplicate location records, which can never be pointed-to
+     * (these are spilled values, not stack allocations).
+     */
+    if(ops)
     {
-      // Note: we should have resolved all fixups for this frame from frames
-      // down the call chain by this point.  If not, the fixup may be
-      // pointing to garbage data (e.g. uninitialized local values)
-      if(fixup_node->data.act != src->act)
-      {
-        ST_WARN("unresolved fixup for %p (frame %d)\n",
-                fixup_node->data.src_addr, fixup_node->data.act);
-        fixup_node = list_next(fixup, fixup_node);
-        continue;
-      }
+      val_src = ops[j].src;
+      val_dest = ops[j].dest;
+      if(val_dest->is_duplicate) continue;
+    }
+    else
+    {
+      val_src = &src->handle->live_vals[i + src_offset];
+      val_dest = &dest->handle->live_vals[j + dest_offset];
 
-      // Find the same-frame data which corresponds to the fixup
-      found_fixup = false;
-      src_offset = ACT(src).site.live_offset;
-      dest_offset = ACT(dest).site.live_offset;
-      for(i = 0, j = 0; j < ACT(dest).site.num_live; i++, j++)
-      {
-        val_src = &src->handle->live_vals[i + src_offset];
-        val_dest = &dest->handle->live_vals[j + dest_offset];
+      ASSERT(!val_src->is_duplicate, "invalid duplicate location record\n");
+      ASSERT(!val_dest->is_duplicate, "invalid duplicate location record\n");
 
-        ASSERT(!val_src->is_duplicate, "invalid duplicate location record\n");
-        ASSERT(!val_dest->is_duplicate, "invalid duplicate location record\n");
-
-        /*
-         * Advance past duplicate location records, which can never be
-         * pointed-to (these are spilled values, not stack allocations).
-         */
-        while(src->handle->live_vals[i + 1 + src_offset].is_duplicate) i++;
-        while(dest->handle->live_vals[j + 1 + dest_offset].is_duplicate) j++;
-
-        /* Can only have stack pointers to allocas */
-        if(!val_src->is_alloca || !val_dest->is_alloca) continue;
-
-        if((stack_addr = points_to_data(src, val_src,
-                                        dest, val_dest,
-                                        fixup_node->data.src_addr)))
-        {
-          ST_INFO("Found local fixup for %p\n", fixup_node->data.src_addr);
-
-          put_val_data(dest,
-                       fixup_node->data.dest_loc,
-                       fixup_node->data.act,
-                       (uint64_t)stack_addr);
-          fixup_node = list_remove(fixup, &dest->stack_pointers, fixup_node);
-          found_fixup = true;
-          break;
-        }
-      }
+      while(src->handle->live_vals[i + 1 + src_offset].is_duplicate) i++;
+      while(dest->handle->live_vals[j + 1 + dest_offset].is_duplicate) j++;
     }
 
-    if(!found_fixup) fixup_node = list_next(fixup, fixup_node);
+    /* Can only have stack pointers to allocas */
+    if(!val_src->is_alloca || !val_dest->is_alloca) continue;
+
+    resolve_fixups(src, val_src, dest, val_dest);
+  }
+
+  // Note: we should have resolved all fixups for this frame from frames
+  // down the call chain by this point.  If not, the fixup may be
+  // pointing to garbage data (e.g. uninitialized local values)
+  for(i = 0; i < index->num_sorted; i++)
+  {
+    if(index->sorted[i].src_addr > ACT(src).cfa) break;
+    if(index->sorted[i].dest_loc && index->sorted[i].act != src->act)
+      ST_WARN("unresolved fixup for %p (frame %d)\n",
+              index->sorted[i].src_addr, index->sorted[i].act);
   }
 }
 
@@ -613,42 +1113,56 @@ static void rewrite_frame(rewrite_context src, rewrite_context dest)
   TIMER_FG_START(rewrite_frame);
   ST_INFO("Rewriting frame (CFA: %p -> %p)\n", ACT(src).cfa, ACT(dest).cfa);
 
-  /* Copy live values */
-  src_offset = ACT(src).site.live_offset;
-  dest_offset = ACT(dest).site.live_offset;
-  for(i = 0, j = 0; j < ACT(dest).site.num_live; i++, j++)
-  {
-    ASSERT(i < src->handle->live_vals_count,
-           "out-of-bounds live value record access in source handle\n");
-    ASSERT(j < dest->handle->live_vals_count,
-           "out-of-bounds live value record access in destination handle\n");
-
-    val_src = &src->handle->live_vals[i + src_offset];
-    val_dest = &dest->handle->live_vals[j + dest_offset];
-
-    ASSERT(!val_src->is_duplicate, "invalid duplicate location record\n");
-    ASSERT(!val_dest->is_duplicate, "invalid duplicate location record\n");
+#ifdef _TIMING
+  ACT(dest).bytes_moved = ACT(dest).bytes_bulk = 0;
+#endif
 
-    /* Apply to first location record */
-    needs_local_fixup |= rewrite_val(src, val_src, dest, val_dest);
+  /* Make fix-ups recorded while rewriting newer frames searchable */
+  fixup_index_merge(&dest->stack_pointers);
+  TALLY(dest, frames, 1);
+  TALLY(dest, values, ACT(dest).site.num_live);
 
-    /* Apply to all duplicate location records */
-    while((j + 1 + dest_offset) < dest->handle->live_vals_count &&
-          dest->handle->live_vals[j + 1 + dest_offset].is_duplicate)
+  /* Copy live values using pre-matched records */
+  if(ACT(src).ops) needs_local_fixup = dest->kernel->rewrite_vals(src, dest);
+  else
+  {
+    /* Copy live values */
+    src_offset = ACT(src).site.live_offset;
+    dest_offset = ACT(dest).site.live_offset;
+    for(i = 0, j = 0; j < ACT(dest).site.num_live; i++, j++)
     {
-      j++;
+      ASSERT(i < src->handle->live_vals_count,
+             "out-of-bounds live value record access in source handle\n");
+      ASSERT(j < dest->handle->live_vals_count,
+             "out-of-bounds live value record access in destination handle\n");
+
+      val_src = &src->handle->live_vals[i + src_offset];
       val_dest = &dest->handle->live_vals[j + dest_offset];
-      ASSERT(!val_dest->is_alloca, "invalid duplicate location record\n");
-      ST_INFO("Applying to duplicate location record\n");
+
+      ASSERT(!val_src->is_duplicate, "invalid duplicate location record\n");
+      ASSERT(!val_dest->is_duplicate, "invalid duplicate location record\n");
+
+      /* Apply to first location record */
       needs_local_fixup |= rewrite_val(src, val_src, dest, val_dest);
-    }
 
-    /* Advance source value past duplicates location records */
-    while((i + 1 + src_offset) < src->handle->live_vals_count &&
-          src->handle->live_vals[i + 1 + src_offset].is_duplicate) i++;
+      /* Apply to all duplicate location records */
+      while((j + 1 + dest_offset) < dest->handle->live_vals_count &&
+            dest->handle->live_vals[j + 1 + dest_offset].is_duplicate)
+      {
+        j++;
+        val_dest = &dest->handle->live_vals[j + dest_offset];
+        ASSERT(!val_dest->is_alloca, "invalid duplicate location record\n");
+        ST_INFO("Applying to duplicate location record\n");
+        needs_local_fixup |= rewrite_val(src, val_src, dest, val_dest);
+      }
+
+      /* Advance source value past duplicates location records */
+      while((i + 1 + src_offset) < src->handle->live_vals_count &&
+            src->handle->live_vals[i + 1 + src_offset].is_duplicate) i++;
+    }
+    ASSERT(i == ACT(src).site.num_live && j == ACT(dest).site.num_live,
+          "did not handle all live values\n");
   }
-  ASSERT(i == ACT(src).site.num_live && j == ACT(dest).site.num_live,
-        "did not handle all live values\n");
 
   /* Set architecture-specific live values */
   dest_offset = ACT(dest).site.arch_live_offset;
@@ -661,3 +1175,105 @@ static void rewrite_frame(rewrite_context src, rewrite_context dest)
   TIMER_FG_STOP(rewrite_frame);
 }
 
+
+#if _TLS_IMPL == COMPILER_TLS
+
+/*
+ * Transform frames from the source to destination stack on-demand.  Any
+ * pointers to the stack must be valid once the thread resumes, so keep
+ * rewriting frames until all pointed-to frames have been transformed.
+ */
+static bool rewrite_frames_ondemand(rewrite_context src, rewrite_context dest)
+{
+  uint64_t* saved_fbp;
+  void* retaddr;
+
+  for(src->act = dest->act; src->act < src->num_acts - 1; src->act++)
+  {
+    ST_INFO("--> Rewriting frame %d <--\n", src->act);
+
+    rewrite_frame(src, dest);
+    if(fixup_index_size(&dest->stack_pointers))
+      retaddr = (void*)NEXT_ACT(dest).site.addr;
+    else retaddr = (void*)__st_ondemand_trampoline;
+    set_return_address(dest, retaddr);
+    saved_fbp = get_savedfbp_loc(dest);
+    ASSERT(saved_fbp, "invalid saved frame pointer location\n");
+    dest->kernel->pop_frame_dest(dest, true);
+    *saved_fbp = (uint64_t)REGOPS(dest)->fbp(ACT(dest).regs);
+    ST_INFO("Old FP saved to %p\n", saved_fbp);
+
+    if(retaddr == (void*)__st_ondemand_trampoline)
+    {
+      src->act++;
+      ST_INFO("Deferring rewrite of frame %d\n", src->act);
+      return false;
+    }
+  }
+
+  ST_INFO("--> Rewriting frame %d (starting function) <--\n", src->act);
+  rewrite_frame(src, dest);
+  return true;
+}
+
+/*
+ * Transform the next frame(s) of the thread's pending on-demand rewrite.
+ */
+static void ondemand_rewrite_next(void* regs)
+{
+  rewrite_context src = od_src, dest = od_dest;
+  const void* frame_regs;
+  uint16_t reg;
+  size_t i;
+  int base;
+  bool finished;
+  stats_timer timer;
+
+  ASSERT(src && dest, "no pending on-demand rewrite\n");
+
+  TIMER_START(rewrite_ondemand);
+  stats_timer_start(&timer);
+
+  /*
+   * The thread resumes in the first frame we rewrite, so callee-saved
+   * registers must not be propagated into (already returned) newer frames.
+   */
+  base = dest->base_act = dest->act;
+  ASSERT(src->act == base, "non-matching activations (%d vs. %d)\n",
+         src->act, base);
+  ST_INFO("--> Rewriting on-demand from frame %d <--\n", base);
+
+  finished = rewrite_frames_ondemand(src, dest);
+  stats_timer_phase(&timer, ST_PHASE_REWRITE);
+
+  /* Set up register state to resume in the first rewritten frame. */
+  frame_regs = dest->acts[base].regs;
+  for(i = 0; i < PROPS(dest)->num_callee_saved; i++)
+  {
+    reg = PROPS(dest)->callee_saved[i];
+    memcpy(REGOPS(dest)->reg(regs, reg),
+           REGOPS(dest)->reg((void*)frame_regs, reg),
+           REGOPS(dest)->reg_size(reg));
+  }
+  REGOPS(dest)->set_sp(regs, REGOPS(dest)->sp(frame_regs));
+  REGOPS(dest)->set_fbp(regs, REGOPS(dest)->fbp(frame_regs));
+  REGOPS(dest)->set_pc(regs, (void*)dest->acts[base].site.addr);
+  ST_INFO("Resuming at %p (SP=%p, FBP=%p)\n", REGOPS(dest)->pc(regs),
+          REGOPS(dest)->sp(regs), REGOPS(dest)->fbp(regs));
+  stats_timer_phase(&timer, ST_PHASE_FINISH);
+  stats_publish(src, dest, &timer, true);
+
+  if(finished)
+  {
+    PRINT_BYTES_MOVED(dest);
+    free_context(dest);
+    free_context(src);
+    od_src = NULL;
+    od_dest = NULL;
+    ST_INFO("Finished on-demand rewrite!\n");
+  }
+
+  TIMER_STOP(rewrite_ondemand);
+}
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * Implementation of call site translation tables.  Every source call site is
+ * mapped to its destination call site and the source & destination live value
+ * records are matched up front (skipping source duplicates & replicating values
+ * into destination duplicates), so rewriting a frame is a loop over a flat
+ * array of copy operations.
+ *
+ * Date: 10/16/2026
+ */
+
+#include "definitions.h"
+#include "util.h"
+#include "site_pairs.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API & definitions
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef _SITE_PAIRS
+
+/*
+ * Build the translation table from SRC to DEST.
+ */
+static site_pairs* build_site_pairs(st_handle src, st_handle dest);
+
+/*
+ * Match live value records for source call site SITE_SRC & destination call
+ * site SITE_DEST, filling OPS.  Returns false if the records don't match up.
+ */
+static bool match_live_values(st_handle src,
+                              const call_site* site_src,
+                              st_handle dest,
+                              const call_site* site_dest,
+                              copy_op* ops);
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Translation tables
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Search for (and build, if needed) the translation table from SRC to DEST.
+ */
+const site_pairs* get_site_pairs(st_handle src, st_handle dest)
+{
+#ifdef _SITE_PAIRS
+  site_pairs* table;
+
+  ASSERT(src && dest, "invalid arguments to get_site_pairs()\n");
+
+  /*
+   * Fast path: tables are never removed once published.  Tables built for a
+   * since-destroyed handle are never matched again, but are only freed along
+   * with the source handle.
+   */
+  table = __atomic_load_n(&src->pairs, __ATOMIC_ACQUIRE);
+  for(; table; table = table->next)
+    if(table->dest == dest && table->dest_generation == dest->generation)
+      return table;
+
+  pthread_mutex_lock(&src->pairs_lock);
+  for(table = src->pairs; table; table = table->next)
+    if(table->dest == dest && table->dest_generation == dest->generation)
+      break;
+  if(!table && (table = build_site_pairs(src, dest)))
+  {
+    table->next = src->pairs;
+    __atomic_store_n(&src->pairs, table, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&src->pairs_lock);
+
+  return table;
+#else
+  return NULL;
+#endif
+}
+
+/*
+ * Free all translation tables.
+ */
+void free_site_pairs(st_handle handle)
+{
+  site_pairs* table, *next;
+
+  for(table = handle->pairs; table; table = next)
+  {
+    next = table->next;
+    free(table->pairs);
+    free(table->ops);
+    free(table);
+  }
+  handle->pairs = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API (implementation)
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef _SITE_PAIRS
+
+/*
+ * Build the translation table.  Call sites without a counterpart in the
+ * destination (or whose live values don't match) are left untranslated, and
+ * rewriting falls back to looking them up for every frame.
+ */
+static site_pairs* build_site_pairs(st_handle src, st_handle dest)
+{
+  uint64_t i, site_ops, num_ops = 0, num_translated = 0;
+  int64_t idx;
+  site_pairs* table;
+  copy_op* ops;
+
+  TIMER_START(build_site_pairs);
+
+  if(!(table = (site_pairs*)MALLOC(sizeof(site_pairs)))) goto return_null;
+  table->dest = dest;
+  table->dest_generation = dest->generation;
+  table->next = NULL;
+  table->pairs = (site_pair*)MALLOC(sizeof(site_pair) * src->sites_count);
+  if(!table->pairs) goto free_table;
+
+  /* Resolve destination call sites & size the copy operation storage */
+  for(i = 0; i < src->sites_count; i++)
+  {
+    if((idx = get_site_idx_by_id(dest, src->sites_addr[i].id)) >= 0)
+    {
+      table->pairs[i].dest = &dest->sites_id[idx];
+      num_ops += table->pairs[i].dest->num_live;
+    }
+    else table->pairs[i].dest = NULL;
+    table->pairs[i].ops = NULL;
+  }
+
+  table->ops = (copy_op*)MALLOC(sizeof(copy_op) * (num_ops ? num_ops : 1));
+  if(!table->ops) goto free_pairs;
+
+  /* Match up live values */
+  for(i = 0, ops = table->ops; i < src->sites_count; i++)
+  {
+    if(!table->pairs[i].dest) continue;
+    site_ops = table->pairs[i].dest->num_live;
+    if(match_live_values(src, &src->sites_addr[i],
+                         dest, table->pairs[i].dest, ops))
+    {
+      coalesce_copies(ops, site_ops);
+      table->pairs[i].ops = ops;
+      num_translated++;
+    }
+    else
+    {
+      ST_WARN("could not match live values for call site %lu\n",
+              src->sites_addr[i].id);
+      table->pairs[i].dest = NULL;
+    }
+    ops += site_ops;
+  }
+
+  ST_INFO("Translated %lu of %lu call sites (%s -> %s, %lu copies)\n",
+          num_translated, src->sites_count, arch_name(src->arch),
+          arch_name(dest->arch), num_ops);
+
+  TIMER_STOP(build_site_pairs);
+  return table;
+
+free_pairs:
+  free(table->pairs);
+free_table:
+  free(table);
+return_null:
+  TIMER_STOP(build_site_pairs);
+  return NULL;
+}
+
+/*
+ * Match live value records, in the same order rewrite_frame() used to walk
+ * them.
+ */
+static bool match_live_values(st_handle src,
+                              const call_site* site_src,
+                              st_handle dest,
+                              const call_site* site_dest,
+                              copy_op* ops)
+{
+  uint64_t i, j, n = 0;
+  uint64_t src_offset = site_src->live_offset;
+  uint64_t dest_offset = site_dest->live_offset;
+
+  if(src_offset + site_src->num_live > src->live_vals_count ||
+     dest_offset + site_dest->num_live > dest->live_vals_count)
+    return false;
+
+  for(i = 0, j = 0; j < site_dest->num_live && i < site_src->num_live;
+      i++, j++)
+  {
+    if(src->live_vals[i + src_offset].is_duplicate ||
+       dest->live_vals[j + dest_offset].is_duplicate)
+      return false;
+
+    /* Apply to first location record */
+    ops[n].src = &src->live_vals[i + src_offset];
+    ops[n++].dest = &dest->live_vals[j + dest_offset];
+
+    /* Apply to all duplicate location records */
+    while(j + 1 < site_dest->num_live &&
+          dest->live_vals[j + 1 + dest_offset].is_duplicate)
+    {
+      j++;
+      ops[n].src = &src->live_vals[i + src_offset];
+      ops[n++].dest = &dest->live_vals[j + dest_offset];
+    }
+
+    /* Advance source value past duplicates location records */
+    while(i + 1 < site_src->num_live &&
+          src->live_vals[i + 1 + src_offset].is_duplicate) i++;
+  }
+
+  return i == site_src->num_live && j == site_dest->num_live &&
+         n == site_dest->num_live;
+}
+
+/*
+ * Can the value be copied as raw bytes in a run of stack slots?  Pointers &
+ * temporaries may need to be fixed up, and constants/registers aren't in
+ * stack slots.
+ */
+static inline bool bulk_copyable(const live_value* val)
+{
+  return ((val->type == SM_DIRECT && val->is_alloca) ||
+          val->type == SM_INDIRECT) && !val->is_ptr && !val->is_temporary;
+}
+
+/*
+ * Can the copy be part of a run?  Both values must be in stack slots & have
+ * the same size in both frames (e.g., va_lists differ between ISAs & are
+ * handled separately by rewrite_val()).
+ */
+static inline bool run_copyable(const copy_op* op)
+{
+  return bulk_copyable(op->src) && bulk_copyable(op->dest) &&
+         VAL_SIZE(op->src) == VAL_SIZE(op->dest) && !op->dest->is_duplicate;
+}
+
+/*
+ * Is NEXT in the stack slot immediately following PREV?
+ */
+static inline bool adjacent(const live_value* prev, const live_value* next)
+{
+  return prev->type == next->type && prev->regnum == next->regnum &&
+         (int64_t)prev->offset_or_constant + VAL_SIZE(prev) ==
+         (int64_t)next->offset_or_constant;
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Copy coalescing
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Coalesce copies between adjacent stack slots in both frames into runs.
+ */
+void coalesce_copies(copy_op* ops, uint64_t num)
+{
+#ifdef _SITE_PAIRS
+  uint64_t start, i;
+
+  for(start = 0; start < num; start = i)
+  {
+    ops[start].run_ops = 1;
+    ops[start].run_bytes = VAL_SIZE(ops[start].dest);
+    for(i = start + 1; i < num; i++)
+    {
+      if(!run_copyable(&ops[start]) || !run_copyable(&ops[i]) ||
+         !adjacent(ops[i - 1].src, ops[i].src) ||
+         !adjacent(ops[i - 1].dest, ops[i].dest) ||
+         ops[start].run_ops == UINT16_MAX ||
+         ops[start].run_bytes > UINT32_MAX - VAL_SIZE(ops[i].dest))
+        break;
+
+      ops[start].run_ops++;
+      ops[start].run_bytes += VAL_SIZE(ops[i].dest);
+      ops[i].run_ops = 1;
+      ops[i].run_bytes = VAL_SIZE(ops[i].dest);
+    }
+  }
+#endif
+}
@@ -0,0 +1,341 @@
+/*
+ * Always-on statistics for rewrites.  Replaces relying on the compile-time
+ * timers (which must be enabled by rebuilding the runtime) to find out where
+ * time goes in production migrations.
+ *
+ * Each thread's counters are only written by the thread itself, so updates are
+ * plain (relaxed atomic) stores rather than read-modify-write operations.
+ * Counters are never freed so that statistics include threads which have
+ * exited.
+ *
+ * Date: 10/16/2026
+ */
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "stats.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API & definitions
+///////////////////////////////////////////////////////////////////////////////
+
+/* A thread's statistics. */
+typedef struct thread_stats
+{
+  st_stats stats;
+  uint32_t tid;
+  struct thread_stats* next;
+} thread_stats;
+
+/* All threads' statistics. */
+static thread_stats* all_stats = NULL;
+
+/* Whether statistics are enabled, or -1 if not yet read from environment. */
+static int enabled = -1;
+
+/* Ring buffer of the most recent rewrites, if writing a statistics file. */
+static st_stats_record* ring = NULL;
+static uint64_t ring_next = 0;
+static const char* ring_file = NULL;
+static pthread_once_t ring_once = PTHREAD_ONCE_INIT;
+
+#if _TLS_IMPL == COMPILER_TLS
+static __thread thread_stats* my_stats = NULL;
+#else /* PTHREAD_TLS */
+static pthread_key_t stats_key;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+#endif
+
+/* Add to a counter only written by the calling thread. */
+#define BUMP( counter, num ) \
+  __atomic_store_n(&(counter), (counter) + (num), __ATOMIC_RELAXED)
+
+/*
+ * Get the calling thread's statistics, allocating them if necessary.
+ */
+static thread_stats* get_thread_stats(void);
+
+#if _TLS_IMPL == PTHREAD_TLS
+
+/*
+ * Create the statistics key.
+ */
+static void create_stats_key(void);
+
+#endif
+
+/*
+ * Set up the ring buffer if a statistics file was requested.
+ */
+static void init_ring(void);
+
+/*
+ * Record a rewrite in the ring buffer.
+ */
+static void record_rewrite(rewrite_context src,
+                           rewrite_context dest,
+                           const stats_timer* timer,
+                           uint32_t tid,
+                           bool resume);
+
+/*
+ * Write the ring buffer to the statistics file.
+ */
+static void write_stats_file(void);
+
+/*
+ * Get the latency histogram bucket for a duration of NS nanoseconds.
+ */
+static inline size_t hist_bucket(uint64_t ns);
+
+///////////////////////////////////////////////////////////////////////////////
+// Statistics APIs
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Get statistics summed across all threads.
+ */
+void st_get_stats(st_stats* stats)
+{
+  const thread_stats* cur;
+  const uint64_t* src;
+  uint64_t* dest;
+  size_t i;
+
+  if(!stats) return;
+  memset(stats, 0, sizeof(st_stats));
+
+  // Note: st_stats is entirely made up of counters, so sum it as an array
+  dest = (uint64_t*)stats;
+  cur = __atomic_load_n(&all_stats, __ATOMIC_ACQUIRE);
+  for(; cur; cur = cur->next)
+  {
+    src = (const uint64_t*)&cur->stats;
+    for(i = 0; i < sizeof(st_stats) / sizeof(uint64_t); i++)
+      dest[i] += __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+  }
+}
+
+/*
+ * Enable or disable statistics.
+ */
+void st_set_stats_enabled(int enable)
+{
+  __atomic_store_n(&enabled, enable ? 1 : 0, __ATOMIC_RELAXED);
+}
+
+/*
+ * Return whether statistics are enabled.
+ */
+bool stats_enabled(void)
+{
+  int cur = __atomic_load_n(&enabled, __ATOMIC_RELAXED);
+
+  // Note: racing threads all read the same environment, so no need to lock
+  if(cur < 0)
+  {
+    cur = getenv(ENV_NO_STATS) == NULL;
+    __atomic_store_n(&enabled, cur, __ATOMIC_RELAXED);
+  }
+  return cur;
+}
+
+/*
+ * Publish a rewrite's work & time into the calling thread's statistics.
+ */
+void stats_publish(rewrite_context src,
+                   rewrite_context dest,
+                   stats_timer* timer,
+                   bool resume)
+{
+  thread_stats* thread;
+  st_stats* stats;
+  size_t i;
+
+  if(!timer->enabled || !(thread = get_thread_stats())) goto reset;
+  stats = &thread->stats;
+
+  timer->ns[ST_PHASE_TOTAL] = 0;
+  for(i = 0; i < ST_PHASE_TOTAL; i++)
+    timer->ns[ST_PHASE_TOTAL] += timer->ns[i];
+
+  if(resume) BUMP(stats->resumes, 1);
+  else BUMP(stats->rewrites, 1);
+  BUMP(stats->frames, dest->tally.frames);
+  BUMP(stats->values, dest->tally.values);
+  BUMP(stats->bytes, dest->tally.bytes);
+  BUMP(stats->fixups, dest->tally.fixups);
+  for(i = 0; i < ST_NUM_PHASES; i++)
+  {
+    BUMP(stats->phase_ns[i], timer->ns[i]);
+    BUMP(stats->phase_hist[i][hist_bucket(timer->ns[i])], 1);
+  }
+
+  pthread_once(&ring_once, init_ring);
+  if(ring) record_rewrite(src, dest, timer, thread->tid, resume);
+
+reset:
+  memset(&dest->tally, 0, sizeof(rewrite_tally));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// File-local API implementation
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Get the calling thread's statistics.
+ */
+static thread_stats* get_thread_stats(void)
+{
+  thread_stats* stats;
+
+#if _TLS_IMPL == COMPILER_TLS
+  if(my_stats) return my_stats;
+#else /* PTHREAD_TLS */
+  pthread_once(&stats_once, create_stats_key);
+  if((stats = pthread_getspecific(stats_key))) return stats;
+#endif
+
+  if(!(stats = (thread_stats*)MALLOC(sizeof(thread_stats)))) return NULL;
+  memset(stats, 0, sizeof(thread_stats));
+  stats->tid = syscall(SYS_gettid);
+
+  /* Make the statistics visible to readers */
+  stats->next = __atomic_load_n(&all_stats, __ATOMIC_RELAXED);
+  while(!__atomic_compare_exchange_n(&all_stats, &stats->next, stats, true,
+                                     __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+#if _TLS_IMPL == COMPILER_TLS
+  my_stats = stats;
+#else /* PTHREAD_TLS */
+  if(pthread_setspecific(stats_key, stats))
+    ST_WARN("could not register thread's statistics\n");
+#endif
+  return stats;
+}
+
+#if _TLS_IMPL == PTHREAD_TLS
+
+/*
+ * Create the statistics key.
+ */
+static void create_stats_key(void)
+{
+  if(pthread_key_create(&stats_key, NULL))
+    ST_WARN("could not create thread-specific key for statistics\n");
+}
+
+#endif
+
+/*
+ * Set up the ring buffer & write it out at exit.
+ */
+static void init_ring(void)
+{
+  st_stats_record* buf;
+  size_t size;
+
+  if(!(ring_file = getenv(ENV_STATS_FILE)) || !*ring_file) return;
+  size = sizeof(st_stats_record) * STATS_RING_RECORDS;
+  if(!(buf = (st_stats_record*)MALLOC(size)))
+  {
+    ST_WARN("could not allocate statistics ring buffer\n");
+    return;
+  }
+  memset(buf, 0, size);
+  if(atexit(write_stats_file))
+  {
+    ST_WARN("could not register statistics file to be written at exit\n");
+    free(buf);
+    return;
+  }
+  ring = buf;
+}
+
+/*
+ * Record a rewrite in the next slot of the ring buffer.
+ */
+static void record_rewrite(rewrite_context src,
+                           rewrite_context dest,
+                           const stats_timer* timer,
+                           uint32_t tid,
+                           bool resume)
+{
+  uint64_t seq = __atomic_fetch_add(&ring_next, 1, __ATOMIC_RELAXED);
+  st_stats_record* rec = &ring[seq % STATS_RING_RECORDS];
+  struct timespec now;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  // Note: invalidate the slot while filling it in, and publish the sequence
+  // number last so the writer at exit skips partially-written records
+  __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+  rec->timestamp = now.tv_sec * 1000000000UL + now.tv_nsec;
+  rec->tid = tid;
+  rec->src_arch = src->handle->arch;
+  rec->dest_arch = dest->handle->arch;
+  rec->resume = resume;
+  rec->frames = dest->tally.frames;
+  rec->values = dest->tally.values;
+  rec->fixups = dest->tally.fixups;
+  rec->bytes = dest->tally.bytes;
+  memcpy(rec->phase_ns, timer->ns, sizeof(rec->phase_ns));
+  __atomic_store_n(&rec->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Write the header & ring buffer, oldest record first.
+ */
+static void write_stats_file(void)
+{
+  FILE* fp;
+  st_stats_header header;
+  const st_stats_record* rec;
+  uint64_t seq, first, last;
+
+  if(!(fp = fopen(ring_file, "w")))
+  {
+    ST_WARN("could not open statistics file '%s'\n", ring_file);
+    return;
+  }
+
+  last = __atomic_load_n(&ring_next, __ATOMIC_ACQUIRE);
+  first = last > STATS_RING_RECORDS ? last - STATS_RING_RECORDS : 0;
+
+  memset(&header, 0, sizeof(st_stats_header));
+  memcpy(header.magic, ST_STATS_MAGIC, sizeof(ST_STATS_MAGIC));
+  header.version = ST_STATS_VERSION;
+  header.record_size = sizeof(st_stats_record);
+  header.dropped = first;
+  st_get_stats(&header.totals);
+  if(fwrite(&header, sizeof(st_stats_header), 1, fp) != 1) goto write_error;
+
+  for(seq = first; seq < last; seq++)
+  {
+    rec = &ring[seq % STATS_RING_RECORDS];
+    if(__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != seq + 1) continue;
+    if(fwrite(rec, sizeof(st_stats_record), 1, fp) != 1) goto write_error;
+    header.num_records++;
+  }
+
+  /* Fill in the number of records actually written */
+  if(fseek(fp, 0, SEEK_SET) ||
+     fwrite(&header, sizeof(st_stats_header), 1, fp) != 1) goto write_error;
+
+  fclose(fp);
+  return;
+
+write_error:
+  ST_WARN("could not write statistics file '%s'\n", ring_file);
+  fclose(fp);
+}
+
+/*
+ * Get the latency histogram bucket for a duration.
+ */
+static inline size_t hist_bucket(uint64_t ns)
+{
+  size_t bucket = ns ? 64 - __builtin_clzl(ns) : 0;
+  return bucket < ST_STATS_BUCKETS ? bucket : ST_STATS_BUCKETS - 1;
+}
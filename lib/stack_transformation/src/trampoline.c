@@ -0,0 +1,236 @@
+/*
+ * Implementation of the on-demand rewriting return trampoline.  The trampoline
+ * reserves a register set on the stack, saves the registers which may hold the
+ * returning function's return value, and calls into the runtime to rewrite the
+ * next frame(s).  It then restores the callee-saved registers for the frame it
+ * resumes in and jumps to that frame's call site.
+ *
+ * Note: the trampoline lives in its own section so that it is aligned at the
+ * same address across all ISAs like any other function.
+ *
+ * Date: 10/16/2026
+ */
+
+#include <stddef.h>
+
+#include "definitions.h"
+#include "arch_regs.h"
+#include "trampoline.h"
+
+#if defined(__aarch64__)
+
+/* Offsets of registers used by the trampoline */
+_Static_assert(sizeof(struct regset_aarch64) == 784,
+               "update trampoline frame size");
+_Static_assert(offsetof(struct regset_aarch64, sp) == 0, "update sp");
+_Static_assert(offsetof(struct regset_aarch64, pc) == 8, "update pc");
+_Static_assert(offsetof(struct regset_aarch64, x) == 16, "update x0");
+_Static_assert(offsetof(struct regset_aarch64, v) == 272, "update v0");
+
+__asm__(
+"  .section .text.__st_ondemand_trampoline,\"ax\",%progbits\n"
+"  .globl __st_ondemand_trampoline\n"
+"  .type __st_ondemand_trampoline,%function\n"
+"  .p2align 4\n"
+"__st_ondemand_trampoline:\n"
+"  sub sp, sp, #784\n"
+   /* Save return value registers (x0-x7, x8 indirect result, q0-q7) */
+"  stp x0, x1, [sp, #16]\n"
+"  stp x2, x3, [sp, #32]\n"
+"  stp x4, x5, [sp, #48]\n"
+"  stp x6, x7, [sp, #64]\n"
+"  str x8, [sp, #80]\n"
+"  stp q0, q1, [sp, #272]\n"
+"  stp q2, q3, [sp, #304]\n"
+"  stp q4, q5, [sp, #336]\n"
+"  stp q6, q7, [sp, #368]\n"
+"  mov x0, sp\n"
+"  bl __st_ondemand_resume\n"
+"  mov x16, x0\n"
+   /* Restore callee-saved registers of the rewritten frame */
+"  ldp x19, x20, [x16, #168]\n"
+"  ldp x21, x22, [x16, #184]\n"
+"  ldp x23, x24, [x16, #200]\n"
+"  ldp x25, x26, [x16, #216]\n"
+"  ldp x27, x28, [x16, #232]\n"
+"  ldp x29, x30, [x16, #248]\n"
+"  ldp q8, q9, [x16, #400]\n"
+"  ldp q10, q11, [x16, #432]\n"
+"  ldp q12, q13, [x16, #464]\n"
+"  ldp q14, q15, [x16, #496]\n"
+   /* Restore return value registers */
+"  ldp q0, q1, [x16, #272]\n"
+"  ldp q2, q3, [x16, #304]\n"
+"  ldp q4, q5, [x16, #336]\n"
+"  ldp q6, q7, [x16, #368]\n"
+"  ldp x0, x1, [x16, #16]\n"
+"  ldp x2, x3, [x16, #32]\n"
+"  ldp x4, x5, [x16, #48]\n"
+"  ldp x6, x7, [x16, #64]\n"
+"  ldr x8, [x16, #80]\n"
+   /* Switch to the rewritten frame & resume at its call site */
+"  ldr x17, [x16, #8]\n"
+"  ldr x9, [x16, #0]\n"
+"  mov sp, x9\n"
+"  br x17\n"
+"  .size __st_ondemand_trampoline,.-__st_ondemand_trampoline\n"
+"  .text\n"
+);
+
+#elif defined(__powerpc64__)
+
+/* Offsets of registers used by the trampoline */
+_Static_assert(sizeof(struct regset_powerpc64) == 536,
+               "update trampoline frame size");
+_Static_assert(offsetof(struct regset_powerpc64, pc) == 0, "update pc");
+_Static_assert(offsetof(struct regset_powerpc64, lr) == 8, "update lr");
+_Static_assert(offsetof(struct regset_powerpc64, r) == 24, "update r0");
+_Static_assert(offsetof(struct regset_powerpc64, f) == 280, "update f0");
+
+/*
+ * The register set is placed after the 32-byte ELFv2 frame header, i.e., at
+ * 32(r1).  Register r2 (TOC) is shared by all code, so it isn't restored.
+ */
+__asm__(
+"  .section .text.__st_ondemand_trampoline,\"ax\",@progbits\n"
+"  .globl __st_ondemand_trampoline\n"
+"  .type __st_ondemand_trampoline,@function\n"
+"  .p2align 4\n"
+"__st_ondemand_trampoline:\n"
+"  stdu 1, -576(1)\n"
+   /* Save return value registers (r3-r10, f1-f8) */
+"  std 3, 80(1)\n"
+"  std 4, 88(1)\n"
+"  std 5, 96(1)\n"
+"  std 6, 104(1)\n"
+"  std 7, 112(1)\n"
+"  std 8, 120(1)\n"
+"  std 9, 128(1)\n"
+"  std 10, 136(1)\n"
+"  stfd 1, 320(1)\n"
+"  stfd 2, 328(1)\n"
+"  stfd 3, 336(1)\n"
+"  stfd 4, 344(1)\n"
+"  stfd 5, 352(1)\n"
+"  stfd 6, 360(1)\n"
+"  stfd 7, 368(1)\n"
+"  stfd 8, 376(1)\n"
+"  addi 3, 1, 32\n"
+"  bl __st_ondemand_resume\n"
+"  nop\n"
+"  mr 12, 3\n"
+   /* Restore callee-saved registers of the rewritten frame */
+"  ld 14, 136(12)\n"
+"  ld 15, 144(12)\n"
+"  ld 16, 152(12)\n"
+"  ld 17, 160(12)\n"
+"  ld 18, 168(12)\n"
+"  ld 19, 176(12)\n"
+"  ld 20, 184(12)\n"
+"  ld 21, 192(12)\n"
+"  ld 22, 200(12)\n"
+"  ld 23, 208(12)\n"
+"  ld 24, 216(12)\n"
+"  ld 25, 224(12)\n"
+"  ld 26, 232(12)\n"
+"  ld 27, 240(12)\n"
+"  ld 28, 248(12)\n"
+"  ld 29, 256(12)\n"
+"  ld 30, 264(12)\n"
+"  ld 31, 272(12)\n"
+"  lfd 14, 392(12)\n"
+"  lfd 15, 400(12)\n"
+"  lfd 16, 408(12)\n"
+"  lfd 17, 416(12)\n"
+"  lfd 18, 424(12)\n"
+"  lfd 19, 432(12)\n"
+"  lfd 20, 440(12)\n"
+"  lfd 21, 448(12)\n"
+"  lfd 22, 456(12)\n"
+"  lfd 23, 464(12)\n"
+"  lfd 24, 472(12)\n"
+"  lfd 25, 480(12)\n"
+"  lfd 26, 488(12)\n"
+"  lfd 27, 496(12)\n"
+"  lfd 28, 504(12)\n"
+"  lfd 29, 512(12)\n"
+"  lfd 30, 520(12)\n"
+"  lfd 31, 528(12)\n"
+   /* Restore return value registers */
+"  ld 3, 48(12)\n"
+"  ld 4, 56(12)\n"
+"  ld 5, 64(12)\n"
+"  ld 6, 72(12)\n"
+"  ld 7, 80(12)\n"
+"  ld 8, 88(12)\n"
+"  ld 9, 96(12)\n"
+"  ld 10, 104(12)\n"
+"  lfd 1, 288(12)\n"
+"  lfd 2, 296(12)\n"
+"  lfd 3, 304(12)\n"
+"  lfd 4, 312(12)\n"
+"  lfd 5, 320(12)\n"
+"  lfd 6, 328(12)\n"
+"  lfd 7, 336(12)\n"
+"  lfd 8, 344(12)\n"
+   /* Switch to the rewritten frame & resume at its call site */
+"  ld 0, 8(12)\n"
+"  mtlr 0\n"
+"  ld 0, 0(12)\n"
+"  mtctr 0\n"
+"  ld 1, 32(12)\n"
+"  bctr\n"
+"  .size __st_ondemand_trampoline,.-__st_ondemand_trampoline\n"
+"  .text\n"
+);
+
+#elif defined(__x86_64__)
+
+/* Offsets of registers used by the trampoline */
+_Static_assert(sizeof(struct regset_x86_64) == 624,
+               "update trampoline frame size");
+_Static_assert(offsetof(struct regset_x86_64, rip) == 0, "update rip");
+_Static_assert(offsetof(struct regset_x86_64, rax) == 8, "update rax");
+_Static_assert(offsetof(struct regset_x86_64, rbx) == 32, "update rbx");
+_Static_assert(offsetof(struct regset_x86_64, rsp) == 64, "update rsp");
+_Static_assert(offsetof(struct regset_x86_64, r12) == 104, "update r12");
+_Static_assert(offsetof(struct regset_x86_64, xmm) == 208, "update xmm0");
+
+__asm__(
+"  .section .text.__st_ondemand_trampoline,\"ax\",@progbits\n"
+"  .globl __st_ondemand_trampoline\n"
+"  .type __st_ondemand_trampoline,@function\n"
+"  .p2align 4\n"
+"__st_ondemand_trampoline:\n"
+"  subq $624, %rsp\n"
+   /* Save return value registers (rax, rdx, xmm0, xmm1) */
+"  movq %rax, 8(%rsp)\n"
+"  movq %rdx, 16(%rsp)\n"
+"  movdqu %xmm0, 208(%rsp)\n"
+"  movdqu %xmm1, 224(%rsp)\n"
+"  movq %rsp, %rdi\n"
+"  call __st_ondemand_resume\n"
+"  movq %rax, %r10\n"
+   /* Restore callee-saved registers of the rewritten frame */
+"  movq 32(%r10), %rbx\n"
+"  movq 56(%r10), %rbp\n"
+"  movq 104(%r10), %r12\n"
+"  movq 112(%r10), %r13\n"
+"  movq 120(%r10), %r14\n"
+"  movq 128(%r10), %r15\n"
+   /* Restore return value registers */
+"  movdqu 208(%r10), %xmm0\n"
+"  movdqu 224(%r10), %xmm1\n"
+"  movq 16(%r10), %rdx\n"
+"  movq 8(%r10), %rax\n"
+   /* Switch to the rewritten frame & resume at its call site */
+"  movq 0(%r10), %r11\n"
+"  movq 64(%r10), %rsp\n"
+"  jmp *%r11\n"
+"  .size __st_ondemand_trampoline,.-__st_ondemand_trampoline\n"
+"  .text\n"
+);
+
+#else
+# error Unsupported architecture!
+#endif
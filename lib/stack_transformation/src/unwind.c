@@ -6,6 +6,7 @@
  */
 
 #include "unwind.h"
+#include "arena.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // File-local API
@@ -170,6 +171,7 @@ void pop_frame(rewrite_context ctx, bool setup_bounds)
   TIMER_FG_START(pop_frame);
   ST_INFO("Popping frame (CFA = %p)\n", ACT(ctx).cfa);
 
+  if(next_frame >= ctx->pool_frames) arena_grow_pools(ctx, next_frame + 1);
   setup_regset(ctx, next_frame);
   setup_callee_saved_bits(ctx, next_frame);
   restore_callee_saved_regs(ctx, next_frame);
@@ -183,7 +185,6 @@ void pop_frame(rewrite_context ctx, bool setup_bounds)
 
   /* Advance to next frame. */
   ctx->act++;
-  ASSERT(ctx->act < MAX_FRAMES, "too many frames on stack\n");
 
   TIMER_FG_STOP(pop_frame);
 }
@@ -200,6 +201,7 @@ void pop_frame_funcentry(rewrite_context ctx)
   TIMER_FG_START(pop_frame);
   ST_INFO("Popping frame (CFA = %p)\n", ACT(ctx).cfa);
 
+  if(next_frame >= ctx->pool_frames) arena_grow_pools(ctx, next_frame + 1);
   setup_regset(ctx, next_frame);
   setup_callee_saved_bits(ctx, next_frame);
 
@@ -224,7 +226,6 @@ void pop_frame_funcentry(rewrite_context ctx)
 
   /* Advance to next frame. */
   ctx->act++;
-  ASSERT(ctx->act < MAX_FRAMES, "too many frames on stack\n");
 
   TIMER_FG_STOP(pop_frame);
 }
@@ -269,5 +270,6 @@ void clear_activation(st_handle handle, activation* act)
   memset(act->regs, 0, handle->regops->regset_size);
   act->regs = NULL;
   memset(&act->callee_saved, 0, sizeof(bitmap));
+  act->ops = NULL;
 }
 
@@ -109,26 +109,136 @@ const void* get_section_data(Elf* e, const char* sec)
   return data->d_buf;
 }
 
+#ifdef _SITE_INDEX
+
+/*
+ * Fill KEYS & IDX in Eytzinger order by doing an in-order traversal of the
+ * implicit tree rooted at node K, consuming call site records (sorted by
+ * return address or ID) starting at record I.  Returns the next record.
+ */
+static uint64_t eytzinger_fill(const call_site* sites,
+                               bool by_id,
+                               uint64_t num,
+                               uint64_t* keys,
+                               uint32_t* idx,
+                               uint64_t i,
+                               uint64_t k)
+{
+  if(k <= num)
+  {
+    i = eytzinger_fill(sites, by_id, num, keys, idx, i, 2 * k);
+    keys[k] = by_id ? sites[i].id : sites[i].addr;
+    idx[k] = i++;
+    i = eytzinger_fill(sites, by_id, num, keys, idx, i, 2 * k + 1);
+  }
+  return i;
+}
+
+/*
+ * Search an Eytzinger-ordered index for KEY.  Returns the index node for KEY,
+ * or 0 if not found.
+ */
+static inline uint64_t
+eytzinger_search(const uint64_t* keys, uint64_t num, uint64_t key)
+{
+  uint64_t k = 1;
+
+  while(k <= num)
+  {
+    __builtin_prefetch(keys + k * SITE_INDEX_PREFETCH);
+    k = 2 * k + (keys[k] < key);
+  }
+
+  /* Undo the right turns taken after the last left turn (lower bound) */
+  k >>= __builtin_ffsll(~k);
+  return (k && keys[k] == key) ? k : 0;
+}
+
+#endif
+
+/*
+ * Build Eytzinger-ordered indexes for call site return addresses & IDs.
+ */
+bool init_site_index(st_handle handle)
+{
+  handle->sites_addr_keys = handle->sites_id_keys = NULL;
+  handle->sites_addr_idx = handle->sites_id_idx = NULL;
+
+#ifdef _SITE_INDEX
+  uint64_t num = handle->sites_count;
+
+  ASSERT(handle->sites_addr && handle->sites_id,
+         "invalid arguments to init_site_index()\n");
+
+  if(num == 0 || num >= UINT32_MAX) return false;
+
+  handle->sites_addr_keys = (uint64_t*)MALLOC(sizeof(uint64_t) * (num + 1));
+  handle->sites_addr_idx = (uint32_t*)MALLOC(sizeof(uint32_t) * (num + 1));
+  handle->sites_id_keys = (uint64_t*)MALLOC(sizeof(uint64_t) * (num + 1));
+  handle->sites_id_idx = (uint32_t*)MALLOC(sizeof(uint32_t) * (num + 1));
+  if(!handle->sites_addr_keys || !handle->sites_addr_idx ||
+     !handle->sites_id_keys || !handle->sites_id_idx)
+  {
+    free_site_index(handle);
+    return false;
+  }
+
+  handle->sites_addr_keys[0] = handle->sites_id_keys[0] = 0;
+  handle->sites_addr_idx[0] = handle->sites_id_idx[0] = 0;
+  eytzinger_fill(handle->sites_addr, false, num,
+                 handle->sites_addr_keys, handle->sites_addr_idx, 0, 1);
+  eytzinger_fill(handle->sites_id, true, num,
+                 handle->sites_id_keys, handle->sites_id_idx, 0, 1);
+
+  ST_INFO("Built call site indexes (%lu entries)\n", num);
+  return true;
+#else
+  return false;
+#endif
+}
+
+/*
+ * Free call site indexes.
+ */
+void free_site_index(st_handle handle)
+{
+  free(handle->sites_addr_keys);
+  free(handle->sites_addr_idx);
+  free(handle->sites_id_keys);
+  free(handle->sites_id_idx);
+  handle->sites_addr_keys = handle->sites_id_keys = NULL;
+  handle->sites_addr_idx = handle->sites_id_idx = NULL;
+}
+
 /*
  * Search through call site entries for the specified return address.
  */
-bool get_site_by_addr(st_handle handle, void* ret_addr, call_site* cs)
+int64_t get_site_idx_by_addr(st_handle handle, void* ret_addr)
 {
-  bool found = false;
+  int64_t found = -1;
   long min = 0;
   long max = (handle->sites_count - 1);
   long mid;
   uint64_t retaddr = (uint64_t)ret_addr;
 
   TIMER_FG_START(get_site_by_addr);
-  ASSERT(cs, "invalid arguments to get_site_by_addr()\n");
+
+#ifdef _SITE_INDEX
+  if(handle->sites_addr_keys)
+  {
+    if((mid = eytzinger_search(handle->sites_addr_keys,
+                               handle->sites_count, retaddr)))
+      found = handle->sites_addr_idx[mid];
+    TIMER_FG_STOP(get_site_by_addr);
+    return found;
+  }
+#endif
 
   while(max >= min)
   {
     mid = (max + min) / 2;
     if(handle->sites_addr[mid].addr == retaddr) {
-      *cs = handle->sites_addr[mid];
-      found = true;
+      found = mid;
       break;
     }
     else if(retaddr > handle->sites_addr[mid].addr)
@@ -144,22 +254,31 @@ bool get_site_by_addr(st_handle handle, void* ret_addr, call_site* cs)
 /*
  * Search through call site entries for the specified ID.
  */
-bool get_site_by_id(st_handle handle, uint64_t csid, call_site* cs)
+int64_t get_site_idx_by_id(st_handle handle, uint64_t csid)
 {
-  bool found = false;
+  int64_t found = -1;
   long min = 0;
   long max = (handle->sites_count - 1);
   long mid;
 
   TIMER_FG_START(get_site_by_id);
-  ASSERT(cs, "invalid arguments to get_site_by_id()\n");
+
+#ifdef _SITE_INDEX
+  if(handle->sites_id_keys)
+  {
+    if((mid = eytzinger_search(handle->sites_id_keys,
+                               handle->sites_count, csid)))
+      found = handle->sites_id_idx[mid];
+    TIMER_FG_STOP(get_site_by_id);
+    return found;
+  }
+#endif
 
   while(max >= min)
   {
     mid = (max + min) / 2;
     if(handle->sites_id[mid].id == csid) {
-      *cs = handle->sites_id[mid];
-      found = true;
+      found = mid;
       break;
     }
     else if(csid > handle->sites_id[mid].id)
@@ -172,6 +291,32 @@ bool get_site_by_id(st_handle handle, uint64_t csid, call_site* cs)
   return found;
 }
 
+/*
+ * Copy out call site entry for the specified return address.
+ */
+bool get_site_by_addr(st_handle handle, void* ret_addr, call_site* cs)
+{
+  int64_t idx;
+
+  ASSERT(cs, "invalid arguments to get_site_by_addr()\n");
+  if((idx = get_site_idx_by_addr(handle, ret_addr)) < 0) return false;
+  *cs = handle->sites_addr[idx];
+  return true;
+}
+
+/*
+ * Copy out call site entry for the specified ID.
+ */
+bool get_site_by_id(st_handle handle, uint64_t csid, call_site* cs)
+{
+  int64_t idx;
+
+  ASSERT(cs, "invalid arguments to get_site_by_id()\n");
+  if((idx = get_site_idx_by_id(handle, csid)) < 0) return false;
+  *cs = handle->sites_id[idx];
+  return true;
+}
+
 /* Check if an address is within the range of a function unwinding record */
 #define IN_RANGE( idx, _addr ) \
   (handle->unwind_addrs[idx].addr <= _addr && \
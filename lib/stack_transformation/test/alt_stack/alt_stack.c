@@ -0,0 +1,250 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <stack_transform.h>
+#include "alt_stack.h"
+#include "stack_transform_timing.h"
+
+#ifdef __aarch64__
+# define REGSET struct regset_aarch64
+# define READ_REGS READ_REGS_AARCH64
+# define PC pc
+# define STACK_PTR( regset ) (regset).sp
+# define SWITCH_STACK( regset, func ) \
+  ({ \
+    SET_REGS_AARCH64(regset); \
+    SET_FRAME_AARCH64((regset).x[29], (regset).sp); \
+    SET_PC_IMM(func); \
+  })
+#elif defined(__powerpc64__)
+# define REGSET struct regset_powerpc64
+# define READ_REGS READ_REGS_POWERPC64
+# define PC pc
+# define STACK_PTR( regset ) (regset).r[1]
+# define SWITCH_STACK( regset, func ) \
+  ({ \
+    SET_REGS_POWERPC64(regset); \
+    SET_FRAME_POWERPC64((regset).r[31], (regset).r[1]); \
+    SET_PC_IMM(func); \
+  })
+#elif defined(__x86_64__)
+# define REGSET struct regset_x86_64
+# define READ_REGS READ_REGS_X86_64
+# define PC rip
+# define STACK_PTR( regset ) (regset).rsp
+# define SWITCH_STACK( regset, func ) \
+  ({ \
+    SET_REGS_X86_64(regset); \
+    SET_FRAME_X86_64((regset).rbp, (regset).rsp); \
+    SET_RIP_IMM(func); \
+  })
+#endif
+
+#define MAX_RETRIES 1000
+
+static int num_migrations = 8;
+static int num_threads = 4;
+static int num_rounds = 3;
+static int max_depth = 10;
+static st_handle handle = NULL;
+static pthread_barrier_t barrier;
+
+/* Per-thread migration state, which must survive switching stacks */
+static __thread int id;
+static __thread int migrations = 0;
+static __thread void* dests[2] = { NULL, NULL };
+
+/*
+ * Stacks each thread ran on when it exited (retired at exit) and the other
+ * alternate stack (unmapped at exit).
+ */
+static stack_bounds* exit_stacks;
+static stack_bounds* idle_stacks;
+
+static void fail(const char* msg)
+{
+  fprintf(stderr, "Thread %d, migration %d: %s\n", id, migrations, msg);
+  exit(1);
+}
+
+/* Return whether a stack's pages are still mapped. */
+static int mapped(const stack_bounds* bounds)
+{
+  return !msync(bounds->low, bounds->high - bounds->low, MS_ASYNC) ||
+         errno != ENOMEM;
+}
+
+void outer_frame()
+{
+  REGSET regset, regset_dest;
+  stack_bounds bounds, dest;
+  void* sp = &regset;
+
+  if(migrations == num_migrations)
+  {
+    if(!alt_stack_bounds(sp, &exit_stacks[id]))
+      fail("not running on an alternate stack");
+    alt_stack_bounds(dests[migrations % 2], &idle_stacks[id]);
+    return;
+  }
+
+  /* Source is the thread's own stack first, then its alternate stacks */
+  if(alt_stack_bounds(sp, &bounds))
+  {
+    if(!migrations) fail("on an alternate stack before migrating");
+    if(bounds.high != dests[(migrations + 1) % 2])
+      fail("not running on the previous destination stack");
+  }
+  else if(migrations) fail("not running on an alternate stack");
+  else bounds = get_stack_bounds();
+
+  READ_REGS(regset);
+  regset.PC = get_call_site();
+  if(st_rewrite_stack_alloc(handle, &regset, bounds.high,
+                            handle, &regset_dest, alt_stack_alloc, sp))
+    fail("couldn't re-write the stack");
+
+  if(!alt_stack_bounds((void*)STACK_PTR(regset_dest), &dest))
+    fail("rewritten stack pointer not on an alternate stack");
+  if(dest.high == bounds.high) fail("rewrote onto the current stack");
+  if(migrations >= 2 && dest.high != dests[migrations % 2])
+    fail("didn't reuse the idle alternate stack");
+  dests[migrations % 2] = dest.high;
+
+  migrations++;
+  SWITCH_STACK(regset_dest, outer_frame);
+}
+
+void recurse(int depth)
+{
+  if(depth < max_depth) recurse(depth + 1);
+  else outer_frame();
+}
+
+void* thread_main(void* args)
+{
+  id = (int)(long)args;
+  recurse(1);
+
+  // Note: wait until all threads are done allocating stacks so that none of
+  // them can be mapped at the address of a stack released by another thread
+  pthread_barrier_wait(&barrier);
+  return NULL;
+}
+
+/*
+ * Check that threads FIRST to END unmapped their idle alternate stacks at
+ * exit & that their retired stacks are reaped by a later allocation.
+ */
+static void check_released(int first, int end)
+{
+  int i, retries, reaped = 0;
+
+  for(i = first; i < end; i++)
+  {
+    if(mapped(&idle_stacks[i]))
+    {
+      fprintf(stderr, "Thread %d's idle stack wasn't unmapped\n", i);
+      exit(1);
+    }
+    if(!mapped(&exit_stacks[i]))
+    {
+      fprintf(stderr, "Thread %d's stack was unmapped while in use\n", i);
+      exit(1);
+    }
+  }
+
+  // Note: the kernel may briefly report a thread as alive after joining it,
+  // in which case its stack is reaped by a subsequent allocation
+  for(retries = 0; retries < MAX_RETRIES && !reaped; retries++)
+  {
+    if(!alt_stack_alloc(0, &retries))
+    {
+      fprintf(stderr, "Couldn't allocate an alternate stack\n");
+      exit(1);
+    }
+    for(i = first, reaped = 1; i < end && reaped; i++)
+      reaped = !mapped(&exit_stacks[i]);
+    if(!reaped) usleep(1000);
+  }
+  if(!reaped)
+  {
+    fprintf(stderr, "Retired stacks weren't reaped\n");
+    exit(1);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int i, round, total;
+  pthread_t* children;
+
+  if(argc > 1) num_migrations = atoi(argv[1]);
+  if(argc > 2) num_threads = atoi(argv[2]);
+  if(argc > 3) num_rounds = atoi(argv[3]);
+  if(num_migrations < 3) num_migrations = 3;
+  if(num_threads < 1) num_threads = 1;
+  if(num_rounds < 1) num_rounds = 1;
+
+  if(!(handle = st_init(argv[0])))
+  {
+    fprintf(stderr, "Couldn't initialize stack transformation handle\n");
+    return 1;
+  }
+
+  total = num_threads * num_rounds;
+  children = (pthread_t*)malloc(sizeof(pthread_t) * num_threads);
+  exit_stacks = (stack_bounds*)calloc(total, sizeof(stack_bounds));
+  idle_stacks = (stack_bounds*)calloc(total, sizeof(stack_bounds));
+  if(!children || !exit_stacks || !idle_stacks)
+  {
+    fprintf(stderr, "Couldn't allocate thread data\n");
+    return 1;
+  }
+
+  // Note: map the main thread's stack up front, so that reaping stacks below
+  // never maps a new stack where a reaped one used to be
+  if(!alt_stack_alloc(0, &i))
+  {
+    fprintf(stderr, "Couldn't allocate an alternate stack\n");
+    return 1;
+  }
+
+  for(round = 0; round < num_rounds; round++)
+  {
+    pthread_barrier_init(&barrier, NULL, num_threads);
+    for(i = 0; i < num_threads; i++)
+    {
+      if(pthread_create(&children[i], NULL, thread_main,
+                        (void*)(long)(round * num_threads + i)))
+      {
+        fprintf(stderr, "Couldn't spawn child thread\n");
+        return 1;
+      }
+    }
+    for(i = 0; i < num_threads; i++)
+    {
+      if(pthread_join(children[i], NULL))
+      {
+        fprintf(stderr, "Couldn't join child thread\n");
+        return 1;
+      }
+    }
+    pthread_barrier_destroy(&barrier);
+
+    check_released(round * num_threads, (round + 1) * num_threads);
+    printf("Round %d: %d threads migrated %d times\n",
+           round, num_threads, num_migrations);
+  }
+
+  st_destroy(handle);
+  free(idle_stacks);
+  free(exit_stacks);
+  free(children);
+  printf("Alternate stacks verified\n");
+  return 0;
+}
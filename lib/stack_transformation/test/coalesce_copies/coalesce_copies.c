@@ -0,0 +1,83 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <stack_transform.h>
+#include "definitions.h"
+#include "site_pairs.h"
+
+#define MAX_VALS 8
+
+static live_value src[MAX_VALS], dest[MAX_VALS];
+static copy_op ops[MAX_VALS];
+static int failed = 0;
+
+/* Describe an alloca of SRC_SIZE/DEST_SIZE bytes at the given frame offsets */
+static void alloca_val(int i, int src_off, int src_size,
+                       int dest_off, int dest_size)
+{
+  src[i] = (live_value){ .is_alloca = 1, .type = SM_DIRECT, .regnum = 7,
+                         .offset_or_constant = src_off,
+                         .alloca_size = src_size };
+  dest[i] = (live_value){ .is_alloca = 1, .type = SM_DIRECT, .regnum = 7,
+                          .offset_or_constant = dest_off,
+                          .alloca_size = dest_size };
+  ops[i].src = &src[i];
+  ops[i].dest = &dest[i];
+}
+
+static void check(const char* name, int i, int run_ops, int run_bytes)
+{
+  if(ops[i].run_ops != run_ops || ops[i].run_bytes != run_bytes)
+  {
+    fprintf(stderr, "%s: op %d has a run of %u ops/%u bytes, "
+                    "expected %d ops/%d bytes\n",
+            name, i, ops[i].run_ops, ops[i].run_bytes, run_ops, run_bytes);
+    failed = 1;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  /* All values adjacent & the same size -- one run */
+  alloca_val(0, 0, 8, 16, 8);
+  alloca_val(1, 8, 8, 24, 8);
+  alloca_val(2, 16, 4, 32, 4);
+  coalesce_copies(ops, 3);
+  check("adjacent", 0, 3, 20);
+
+  /*
+   * Leading va_list (24 bytes on x86-64, 32 bytes on aarch64) followed by
+   * values adjacent to it in both frames -- the va_list must be copied on its
+   * own, and the following values form their own run.
+   */
+  alloca_val(0, 0, 24, 0, 32);
+  alloca_val(1, 24, 8, 32, 8);
+  alloca_val(2, 32, 8, 40, 8);
+  coalesce_copies(ops, 3);
+  check("leading size mismatch", 0, 1, 32);
+  check("leading size mismatch", 1, 2, 16);
+
+  /* Size mismatch in the middle of adjacent values */
+  alloca_val(0, 0, 8, 0, 8);
+  alloca_val(1, 8, 24, 8, 32);
+  alloca_val(2, 32, 8, 40, 8);
+  coalesce_copies(ops, 3);
+  check("middle size mismatch", 0, 1, 8);
+  check("middle size mismatch", 1, 1, 32);
+  check("middle size mismatch", 2, 1, 8);
+
+  /* Leading register value -- never starts a run */
+  alloca_val(0, 0, 8, 0, 8);
+  src[0].is_alloca = dest[0].is_alloca = 0;
+  src[0].type = dest[0].type = SM_REGISTER;
+  src[0].size = dest[0].size = 8;
+  alloca_val(1, 8, 8, 8, 8);
+  alloca_val(2, 16, 8, 16, 8);
+  coalesce_copies(ops, 3);
+  check("leading register", 0, 1, 8);
+  check("leading register", 1, 2, 16);
+
+  if(failed) return 1;
+  printf("[ST] Coalesced copies correctly\n");
+  return 0;
+}
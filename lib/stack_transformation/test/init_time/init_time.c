@@ -0,0 +1,79 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <stack_transform.h>
+
+#define NUM_BINS 3
+
+static const char* bins[NUM_BINS] = {
+  "./init_time_aarch64",
+  "./init_time_powerpc64",
+  "./init_time_x86-64"
+};
+
+static inline unsigned long elapsed(struct timespec* start,
+                                    struct timespec* end)
+{
+  return (end->tv_sec * 1000000000 + end->tv_nsec) -
+         (start->tv_sec * 1000000000 + start->tv_nsec);
+}
+
+/* Read the resident set size (in kB) from procfs */
+static long resident_kb()
+{
+  char buf[256];
+  long rss = -1;
+  FILE* fp = fopen("/proc/self/status", "r");
+
+  if(!fp) return -1;
+  while(fgets(buf, sizeof(buf), fp))
+    if(!strncmp(buf, "VmRSS:", 6)) { rss = atol(buf + 6); break; }
+  fclose(fp);
+  return rss;
+}
+
+int main(int argc, char** argv)
+{
+  int i, j, iterations = 100;
+  long rss_before, rss_after = 0;
+  unsigned long init_ns = 0, destroy_ns = 0;
+  struct timespec start, end;
+  st_handle handles[NUM_BINS];
+
+  if(argc > 1) iterations = atoi(argv[1]);
+  if(iterations < 1) iterations = 1;
+
+  printf("Metadata loaded via %s\n", getenv("ST_NO_MMAP") ? "libELF" : "mmap");
+
+  for(i = 0; i < iterations; i++)
+  {
+    rss_before = resident_kb();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(j = 0; j < NUM_BINS; j++)
+    {
+      if(!(handles[j] = st_init(bins[j])))
+      {
+        fprintf(stderr, "Couldn't initialize handle for '%s'\n", bins[j]);
+        return 1;
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    init_ns += elapsed(&start, &end);
+
+    if(!i) rss_after = resident_kb();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(j = 0; j < NUM_BINS; j++) st_destroy(handles[j]);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    destroy_ns += elapsed(&start, &end);
+
+    if(!i) printf("Resident memory growth: %ld kB\n", rss_after - rss_before);
+  }
+
+  printf("st_init (%d handles): %lu ns\n", NUM_BINS, init_ns / iterations);
+  printf("st_destroy (%d handles): %lu ns\n", NUM_BINS, destroy_ns / iterations);
+  return 0;
+}
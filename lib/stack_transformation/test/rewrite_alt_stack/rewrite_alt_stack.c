@@ -0,0 +1,132 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+#include <stack_transform.h>
+#include "stack_transform_timing.h"
+
+#define MAX_DEPTHS 16
+
+#ifdef __aarch64__
+# define BIN "./rewrite_alt_stack_aarch64"
+# define REGSET struct regset_aarch64
+# define READ_REGS READ_REGS_AARCH64
+# define PC pc
+# define STACK_PTR( regset ) (regset).sp
+#elif defined(__powerpc64__)
+# define BIN "./rewrite_alt_stack_powerpc64"
+# define REGSET struct regset_powerpc64
+# define READ_REGS READ_REGS_POWERPC64
+# define PC pc
+# define STACK_PTR( regset ) (regset).r[1]
+#elif defined(__x86_64__)
+# define BIN "./rewrite_alt_stack_x86-64"
+# define REGSET struct regset_x86_64
+# define READ_REGS READ_REGS_X86_64
+# define PC rip
+# define STACK_PTR( regset ) (regset).rsp
+#endif
+
+static int depths[MAX_DEPTHS] = { 10, 100, 1000 };
+static int num_depths = 3;
+static int max_depth;
+static st_handle handle = NULL;
+
+/* The most recently allocated stack */
+static void* stack = NULL;
+static size_t stack_size = 0;
+
+/* Map a stack of exactly the requested size */
+static void* alloc_stack(size_t size, void* data)
+{
+  size = (size + 4095) & ~4095UL;
+  stack = mmap(NULL, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(stack == MAP_FAILED) return NULL;
+  stack_size = size;
+  *(size_t*)data = size;
+  return stack + size;
+}
+
+void outer_frame()
+{
+  static size_t last_size = 0;
+  size_t size = 0;
+  REGSET regset, regset_dest;
+  stack_bounds bounds = get_stack_bounds();
+
+  READ_REGS(regset);
+  regset.PC = get_call_site();
+
+  if(st_rewrite_stack_alloc(handle, &regset, bounds.high,
+                            handle, &regset_dest, alloc_stack, &size))
+  {
+    fprintf(stderr, "Couldn't re-write the stack (depth %d)\n", max_depth);
+    exit(1);
+  }
+  printf("[ST] Depth %d: requested %lu bytes\n", max_depth, size);
+
+  if((void*)STACK_PTR(regset_dest) < stack ||
+     (void*)STACK_PTR(regset_dest) >= stack + stack_size)
+  {
+    fprintf(stderr, "Rewritten stack pointer %p outside of stack %p - %p\n",
+            (void*)STACK_PTR(regset_dest), stack, stack + stack_size);
+    exit(1);
+  }
+  if(size < last_size)
+  {
+    fprintf(stderr, "Deeper stack requested less space (%lu vs. %lu)\n",
+            size, last_size);
+    exit(1);
+  }
+  last_size = size;
+  munmap(stack, stack_size);
+}
+
+void recurse(int depth)
+{
+  if(depth < max_depth) recurse(depth + 1);
+  else outer_frame();
+}
+
+int main(int argc, char** argv)
+{
+  int i, j, tmp;
+
+  if(argc > 1)
+  {
+    num_depths = 0;
+    for(i = 1; i < argc && num_depths < MAX_DEPTHS; i++)
+      depths[num_depths++] = atoi(argv[i]);
+  }
+
+  /* Sort depths so that requested sizes should increase */
+  for(i = 1; i < num_depths; i++)
+    for(j = i; j > 0 && depths[j - 1] > depths[j]; j--)
+    {
+      tmp = depths[j];
+      depths[j] = depths[j - 1];
+      depths[j - 1] = tmp;
+    }
+
+  if(!(handle = st_init(BIN)))
+  {
+    fprintf(stderr, "Couldn't open ELF information\n");
+    return 1;
+  }
+
+  for(i = 0; i < num_depths; i++)
+  {
+    if(depths[i] < 1)
+    {
+      fprintf(stderr, "Depths must be positive\n");
+      return 1;
+    }
+    max_depth = depths[i];
+    recurse(1);
+  }
+
+  st_destroy(handle);
+  printf("Alternate stacks verified\n");
+  return 0;
+}
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include <stack_transform.h>
+#include "stack_transform_timing.h"
+
+#define MAX_DEPTHS 16
+
+#ifdef __aarch64__
+# define BIN "./rewrite_deep_aarch64"
+# define REGSET struct regset_aarch64
+# define READ_REGS READ_REGS_AARCH64
+# define PC pc
+#elif defined(__powerpc64__)
+# define BIN "./rewrite_deep_powerpc64"
+# define REGSET struct regset_powerpc64
+# define READ_REGS READ_REGS_POWERPC64
+# define PC pc
+#elif defined(__x86_64__)
+# define BIN "./rewrite_deep_x86-64"
+# define REGSET struct regset_x86_64
+# define READ_REGS READ_REGS_X86_64
+# define PC rip
+#endif
+
+static int depths[MAX_DEPTHS] = { 10, 1000, 10000 };
+static int num_depths = 3;
+static int max_depth;
+static int test_switch = 0;
+static int post_transform = 0;
+static st_handle handle = NULL;
+
+/* Rewrite the stack without switching to it & report time & memory usage */
+static void measure_rewrite()
+{
+  int ret;
+  struct timespec start, end;
+  struct rusage usage;
+  REGSET regset, regset_dest;
+  stack_bounds bounds = get_stack_bounds();
+
+  READ_REGS(regset);
+  regset.PC = get_call_site();
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ret = st_rewrite_stack(handle, &regset, bounds.high,
+                         handle, &regset_dest, bounds.low);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  if(ret)
+  {
+    fprintf(stderr, "Couldn't re-write the stack (depth %d)\n", max_depth);
+    exit(1);
+  }
+
+  getrusage(RUSAGE_SELF, &usage);
+  printf("[ST] Depth %d: %lu ns/frame, peak RSS %ld KB\n", max_depth,
+         ((end.tv_sec * 1000000000 + end.tv_nsec) -
+          (start.tv_sec * 1000000000 + start.tv_nsec)) / max_depth,
+         usage.ru_maxrss);
+}
+
+void outer_frame()
+{
+  if(!test_switch) measure_rewrite();
+  else if(!post_transform) TIME_AND_TEST_NO_INIT(handle, outer_frame);
+}
+
+void recurse(int depth)
+{
+  long a = depth, b = depth * 2, c = depth * 3;
+
+  if(depth < max_depth) recurse(depth + 1);
+  else outer_frame();
+
+  if(a != depth || b != depth * 2 || c != depth * 3)
+  {
+    fprintf(stderr, "Frame %d was not correctly rewritten\n", depth);
+    exit(1);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int i;
+
+  if(argc > 1)
+  {
+    num_depths = 0;
+    for(i = 1; i < argc && num_depths < MAX_DEPTHS; i++)
+      depths[num_depths++] = atoi(argv[i]);
+  }
+
+  if(!(handle = st_init(BIN)))
+  {
+    fprintf(stderr, "Couldn't open ELF information\n");
+    return 1;
+  }
+
+  for(i = 0; i < num_depths; i++)
+  {
+    if(depths[i] < 1)
+    {
+      fprintf(stderr, "Depths must be positive\n");
+      return 1;
+    }
+    max_depth = depths[i];
+    recurse(1);
+  }
+
+  /* Switch to the deepest rewritten stack & check it as the thread returns */
+  test_switch = 1;
+  for(i = 0; i < num_depths; i++)
+    if(depths[i] > max_depth) max_depth = depths[i];
+  recurse(1);
+  if(!post_transform)
+  {
+    fprintf(stderr, "Stack was not rewritten\n");
+    return 1;
+  }
+  printf("Verified %d frames\n", max_depth);
+
+  st_destroy(handle);
+  return 0;
+}
@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <stack_transform.h>
+#include "stack_transform_timing.h"
+
+#ifdef __aarch64__
+# define BIN "./rewrite_kernels_aarch64"
+# define REGSET struct regset_aarch64
+# define READ_REGS READ_REGS_AARCH64
+# define PC pc
+#elif defined(__powerpc64__)
+# define BIN "./rewrite_kernels_powerpc64"
+# define REGSET struct regset_powerpc64
+# define READ_REGS READ_REGS_POWERPC64
+# define PC pc
+#elif defined(__x86_64__)
+# define BIN "./rewrite_kernels_x86-64"
+# define REGSET struct regset_x86_64
+# define READ_REGS READ_REGS_X86_64
+# define PC rip
+#endif
+
+/* Must match ENV_NO_KERNELS in the stack transformation library's config.h */
+#define ENV_NO_KERNELS "ST_NO_KERNELS"
+
+static int max_depth = 100;
+static int iterations = 100;
+static st_handle handle = NULL;
+
+/* Repeatedly rewrite the stack without switching to it & report the time */
+static void measure_rewrite()
+{
+  int i;
+  unsigned long total = 0;
+  struct timespec start, end;
+  REGSET regset, regset_dest;
+  stack_bounds bounds = get_stack_bounds();
+
+  READ_REGS(regset);
+  regset.PC = get_call_site();
+
+  for(i = 0; i < iterations; i++)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(st_rewrite_stack(handle, &regset, bounds.high,
+                        handle, &regset_dest, bounds.low))
+    {
+      fprintf(stderr, "Couldn't re-write the stack\n");
+      exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    total += (end.tv_sec * 1000000000 + end.tv_nsec) -
+             (start.tv_sec * 1000000000 + start.tv_nsec);
+  }
+
+  printf("[ST] %s: %lu ns/frame\n",
+         getenv(ENV_NO_KERNELS) ? "Generic path" : "Specialized kernels",
+         total / iterations / max_depth);
+}
+
+void recurse(int depth, double scale)
+{
+  long a = depth, b = depth * 2, c = depth * 3, d = depth * 4;
+  double e = depth * scale, f = depth / scale;
+
+  if(depth < max_depth) recurse(depth + 1, scale);
+  else measure_rewrite();
+
+  if(a != depth || b != depth * 2 || c != depth * 3 || d != depth * 4 ||
+     e != depth * scale || f != depth / scale)
+  {
+    fprintf(stderr, "Frame %d was corrupted\n", depth);
+    exit(1);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if(argc > 1) max_depth = atoi(argv[1]);
+  if(argc > 2) iterations = atoi(argv[2]);
+  if(max_depth < 1 || iterations < 1)
+  {
+    fprintf(stderr, "Depth & iterations must be positive\n");
+    return 1;
+  }
+
+  if(!(handle = st_init(BIN)))
+  {
+    fprintf(stderr, "Couldn't open ELF information\n");
+    return 1;
+  }
+
+  /* Make sure we're measuring what we think we're measuring */
+  if(st_specialized_kernel(handle, handle) != !getenv(ENV_NO_KERNELS))
+  {
+    fprintf(stderr, "Expected the %s to be selected\n",
+            getenv(ENV_NO_KERNELS) ? "generic path" : "specialized kernel");
+    return 1;
+  }
+  recurse(1, 1.5);
+  st_destroy(handle);
+
+  /* Re-run with the generic path, which is selected once per process */
+  if(!getenv(ENV_NO_KERNELS))
+  {
+    fflush(stdout);
+    setenv(ENV_NO_KERNELS, "1", 1);
+    execv(argv[0], argv);
+    perror("Couldn't re-execute with the generic path");
+    return 1;
+  }
+  return 0;
+}
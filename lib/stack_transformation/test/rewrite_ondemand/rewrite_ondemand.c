@@ -0,0 +1,81 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <stack_transform.h>
+#include "stack_transform_timing.h"
+
+#define MAX_DEPTH 500
+#define NUM_VALS 4
+
+static int max_depth = 256;
+static int ondemand = 1;
+static int post_transform = 0;
+static st_handle handle = NULL;
+static long expected[MAX_DEPTH + 1][NUM_VALS];
+
+void outer_frame()
+{
+  if(!post_transform)
+  {
+    if(ondemand) TIME_AND_TEST_NO_INIT_WITH(handle, outer_frame,
+                                            st_rewrite_ondemand);
+    else TIME_AND_TEST_NO_INIT_WITH(handle, outer_frame, st_rewrite_stack);
+  }
+}
+
+void recurse(int depth, int* shared)
+{
+  long a = rand(), b = rand(), c = rand(), d = rand();
+  int mine = 0;
+
+  expected[depth][0] = a;
+  expected[depth][1] = b;
+  expected[depth][2] = c;
+  expected[depth][3] = d;
+
+  /* Pass a pointer to this frame's data down the rest of the call chain. */
+  if(depth == max_depth / 2) shared = &mine;
+  else if(shared) (*shared)++;
+
+  if(depth < max_depth) recurse(depth + 1, shared);
+  else outer_frame();
+
+  if(a != expected[depth][0] || b != expected[depth][1] ||
+     c != expected[depth][2] || d != expected[depth][3])
+  {
+    fprintf(stderr, "Frame %d was not correctly rewritten\n", depth);
+    exit(1);
+  }
+
+  if(depth == max_depth / 2 && mine != max_depth - max_depth / 2)
+  {
+    fprintf(stderr, "Pointer to frame %d was not correctly rewritten "
+                    "(%d vs. %d)\n", depth, mine, max_depth - max_depth / 2);
+    exit(1);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if(argc > 1) max_depth = atoi(argv[1]);
+  if(argc > 2) ondemand = strcmp(argv[2], "full");
+  if(max_depth < 1 || max_depth > MAX_DEPTH)
+  {
+    fprintf(stderr, "Depth must be between 1 and %d\n", MAX_DEPTH);
+    return 1;
+  }
+
+  if(!(handle = st_init(argv[0])))
+  {
+    fprintf(stderr, "Couldn't initialize stack transformation handle\n");
+    return 1;
+  }
+
+  srand(0);
+  recurse(1, NULL);
+  printf("Verified %d frames\n", max_depth);
+
+  st_destroy(handle);
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <stack_transform.h>
+#include "stack_transform_timing.h"
+
+#define MAX_DEPTH 500
+#define NUM_ROOTS 8
+
+static int max_depth = 256;
+static int post_transform = 0;
+
+void outer_frame()
+{
+  if(!post_transform)
+  {
+#ifdef __aarch64__
+    TIME_AND_TEST_REWRITE("./rewrite_pointers_aarch64", outer_frame);
+#elif defined(__powerpc64__)
+    TIME_AND_TEST_REWRITE("./rewrite_pointers_powerpc64", outer_frame);
+#elif defined(__x86_64__)
+    TIME_AND_TEST_REWRITE("./rewrite_pointers_x86-64", outer_frame);
+#endif
+  }
+}
+
+void recurse(int depth, long* roots, long* parent)
+{
+  long local[4] = { depth, depth, depth, depth };
+  long *p0 = &roots[0], *p1 = &roots[1], *p2 = &roots[2], *p3 = &roots[3],
+       *p4 = &roots[4], *p5 = &roots[5], *p6 = &roots[6], *p7 = &roots[7];
+
+  if(depth < max_depth) recurse(depth + 1, roots, local);
+  else outer_frame();
+
+  /* Every pointer must refer to the rewritten data. */
+  (*p0)++; (*p1)++; (*p2)++; (*p3)++;
+  (*p4)++; (*p5)++; (*p6)++; (*p7)++;
+  if(parent) parent[depth % 4] += local[depth % 4];
+
+  /* The callee updated this frame's buffer through the pointer to it. */
+  if(depth < max_depth && local[(depth + 1) % 4] != 2 * depth + 1)
+  {
+    fprintf(stderr, "Pointer to frame %d was not correctly rewritten\n",
+            depth);
+    exit(1);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  long roots[NUM_ROOTS] = { 0 };
+  long total = 0;
+  int i;
+
+  if(argc > 1) max_depth = atoi(argv[1]);
+  if(max_depth < 1 || max_depth > MAX_DEPTH)
+  {
+    fprintf(stderr, "Depth must be between 1 and %d\n", MAX_DEPTH);
+    return 1;
+  }
+
+  recurse(1, roots, NULL);
+
+  for(i = 0; i < NUM_ROOTS; i++)
+  {
+    if(roots[i] != max_depth)
+    {
+      fprintf(stderr, "Pointer to root %d was not correctly rewritten "
+                      "(%ld vs. %d)\n", i, roots[i], max_depth);
+      return 1;
+    }
+    total += roots[i];
+  }
+  printf("Verified %d frames (%ld pointers)\n", max_depth, total);
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <stack_transform.h>
+#include "stack_transform_timing.h"
+
+#define MAX_DEPTH 500
+
+#ifdef __aarch64__
+# define BIN "./rewrite_stats_aarch64"
+# define REGSET struct regset_aarch64
+# define READ_REGS READ_REGS_AARCH64
+# define PC pc
+#elif defined(__powerpc64__)
+# define BIN "./rewrite_stats_powerpc64"
+# define REGSET struct regset_powerpc64
+# define READ_REGS READ_REGS_POWERPC64
+# define PC pc
+#elif defined(__x86_64__)
+# define BIN "./rewrite_stats_x86-64"
+# define REGSET struct regset_x86_64
+# define READ_REGS READ_REGS_X86_64
+# define PC rip
+#endif
+
+static int max_depth = 16;
+static int iterations = 10;
+
+static const char* phase_names[ST_NUM_PHASES] = {
+  "init", "unwind", "rewrite", "finish", "total"
+};
+
+static void print_stats(const st_stats* stats)
+{
+  int i, j;
+
+  printf("[ST] %lu rewrites, %lu resumes, %lu frames, %lu values, "
+         "%lu bytes, %lu fixups\n", stats->rewrites, stats->resumes,
+         stats->frames, stats->values, stats->bytes, stats->fixups);
+  for(i = 0; i < ST_NUM_PHASES; i++)
+  {
+    printf("[ST] %s: %lu ns/rewrite, histogram:", phase_names[i],
+           stats->phase_ns[i] / stats->rewrites);
+    for(j = 0; j < ST_STATS_BUCKETS; j++)
+      if(stats->phase_hist[i][j])
+        printf(" <%luns=%lu", 1UL << j, stats->phase_hist[i][j]);
+    printf("\n");
+  }
+}
+
+static void rewrite(st_handle handle, int times)
+{
+  int i;
+  REGSET regset, regset_dest;
+  stack_bounds bounds = get_stack_bounds();
+
+  READ_REGS(regset);
+  regset.PC = get_call_site();
+
+  for(i = 0; i < times; i++)
+  {
+    if(st_rewrite_stack(handle, &regset, bounds.high,
+                        handle, &regset_dest, bounds.low))
+    {
+      fprintf(stderr, "Couldn't re-write the stack (iteration %d)\n", i);
+      exit(1);
+    }
+  }
+}
+
+void outer_frame()
+{
+  int i;
+  uint64_t hist;
+  st_stats before, after;
+  st_handle handle = st_init(BIN);
+
+  if(!handle)
+  {
+    fprintf(stderr, "Couldn't open ELF information\n");
+    exit(1);
+  }
+
+  /* Rewrite with statistics enabled & check they were all counted */
+  st_set_stats_enabled(1);
+  st_get_stats(&before);
+  rewrite(handle, iterations);
+  st_get_stats(&after);
+  after.rewrites -= before.rewrites;
+  after.frames -= before.frames;
+  for(i = 0, hist = 0; i < ST_STATS_BUCKETS; i++)
+    hist += after.phase_hist[ST_PHASE_TOTAL][i] -
+            before.phase_hist[ST_PHASE_TOTAL][i];
+  print_stats(&after);
+
+  if(after.rewrites != iterations || hist != iterations)
+  {
+    fprintf(stderr, "Expected %d rewrites, counted %lu (%lu in histogram)\n",
+            iterations, after.rewrites, hist);
+    exit(1);
+  }
+  if(after.frames < (uint64_t)max_depth * iterations || !after.bytes)
+  {
+    fprintf(stderr, "Expected at least %d frames, counted %lu\n",
+            max_depth * iterations, after.frames);
+    exit(1);
+  }
+
+  /* Rewrite with statistics disabled & check nothing was counted */
+  st_set_stats_enabled(0);
+  st_get_stats(&before);
+  rewrite(handle, 1);
+  st_get_stats(&after);
+  st_set_stats_enabled(1);
+  if(after.rewrites != before.rewrites || after.frames != before.frames)
+  {
+    fprintf(stderr, "Counted rewrite while statistics were disabled\n");
+    exit(1);
+  }
+
+  st_destroy(handle);
+  printf("Statistics verified\n");
+}
+
+void recurse(int depth)
+{
+  if(depth < max_depth) recurse(depth + 1);
+  else outer_frame();
+}
+
+int main(int argc, char** argv)
+{
+  if(argc > 1) max_depth = atoi(argv[1]);
+  if(argc > 2) iterations = atoi(argv[2]);
+  if(max_depth < 1 || max_depth > MAX_DEPTH || iterations < 1)
+  {
+    fprintf(stderr, "Depth must be between 1 and %d & iterations must be "
+                    "positive\n", MAX_DEPTH);
+    return 1;
+  }
+
+  recurse(1);
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <stack_transform.h>
+#include "definitions.h"
+#include "util.h"
+
+#define NUM_QUERIES 4096
+
+static uint64_t addrs[NUM_QUERIES], ids[NUM_QUERIES];
+
+static inline unsigned long elapsed(struct timespec* start,
+                                    struct timespec* end)
+{
+  return (end->tv_sec * 1000000000 + end->tv_nsec) -
+         (start->tv_sec * 1000000000 + start->tv_nsec);
+}
+
+/* Time looking up random call sites, returns nanoseconds per lookup */
+static double time_lookups(st_handle handle, long lookups, int by_id)
+{
+  long i;
+  call_site site;
+  struct timespec start, end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(i = 0; i < lookups; i++)
+  {
+    if(by_id)
+    {
+      if(!get_site_by_id(handle, ids[i % NUM_QUERIES], &site)) goto bad;
+    }
+    else if(!get_site_by_addr(handle, (void*)addrs[i % NUM_QUERIES], &site))
+      goto bad;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (double)elapsed(&start, &end) / lookups;
+
+bad:
+  fprintf(stderr, "Could not find call site\n");
+  exit(1);
+}
+
+int main(int argc, char** argv)
+{
+  long lookups = 1000000;
+  uint64_t num, total, i;
+  double search_addr, search_id, index_addr, index_id;
+  st_handle handle;
+
+  if(argc > 1) lookups = atol(argv[1]);
+
+  if(!(handle = st_init(argv[0])))
+  {
+    fprintf(stderr, "Couldn't initialize stack transformation handle\n");
+    return 1;
+  }
+
+  srand(0);
+  total = handle->sites_count;
+  printf("%10s %14s %14s %14s %14s\n", "Sites", "Search (addr)",
+         "Index (addr)", "Search (ID)", "Index (ID)");
+  for(num = 16; ; num *= 4)
+  {
+    if(num > total) num = total;
+
+    // Note: prefixes of the sorted call site records are themselves sorted
+    handle->sites_count = num;
+    for(i = 0; i < NUM_QUERIES; i++)
+    {
+      addrs[i] = handle->sites_addr[rand() % num].addr;
+      ids[i] = handle->sites_id[rand() % num].id;
+    }
+
+    free_site_index(handle);
+    search_addr = time_lookups(handle, lookups, 0);
+    search_id = time_lookups(handle, lookups, 1);
+
+    if(!init_site_index(handle))
+      fprintf(stderr, "Couldn't build call site indexes\n");
+    index_addr = time_lookups(handle, lookups, 0);
+    index_id = time_lookups(handle, lookups, 1);
+
+    printf("%10lu %11.2f ns %11.2f ns %11.2f ns %11.2f ns\n", num,
+           search_addr, index_addr, search_id, index_id);
+
+    if(num == total) break;
+  }
+
+  /* Restore the handle before cleaning up */
+  handle->sites_count = total;
+  free_site_index(handle);
+  init_site_index(handle);
+  st_destroy(handle);
+  return 0;
+}
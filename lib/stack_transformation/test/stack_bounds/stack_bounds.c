@@ -0,0 +1,205 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <stack_transform.h>
+
+#define BUF_SIZE 512
+#define REPEAT 1000
+
+static int num_threads = 64;
+static pthread_barrier_t barrier;
+
+/* Per-thread lookup latencies, in nanoseconds. */
+typedef struct lookup_time
+{
+  unsigned long runtime_first, legacy_first;
+  unsigned long runtime_repeat, legacy_repeat;
+  int id, valid;
+} lookup_time;
+
+/* Bounds cached by the legacy lookup, as the runtime did in TLS. */
+static __thread stack_bounds legacy_cache = { .high = NULL, .low = NULL };
+
+static inline unsigned long elapsed(struct timespec* start,
+                                    struct timespec* end)
+{
+  return (end->tv_sec * 1000000000 + end->tv_nsec) -
+         (start->tv_sec * 1000000000 + start->tv_nsec);
+}
+
+/*
+ * Look up the main thread's stack bounds the way the runtime did at startup
+ * before musl recorded them, by scanning procfs.  Only done once per process.
+ */
+static int legacy_main_bounds(stack_bounds* bounds)
+{
+  char buf[BUF_SIZE], path[BUF_SIZE];
+  unsigned long start, end;
+  FILE* fp;
+  int found = 0;
+
+  if(!(fp = fopen("/proc/self/maps", "r"))) return 0;
+  while(fgets(buf, sizeof(buf), fp))
+  {
+    if(sscanf(buf, "%lx-%lx %*s %*s %*s %*s %s", &start, &end, path) == 3 &&
+       !strncmp(path, "[stack]", 7))
+    {
+      bounds->low = (void*)start;
+      bounds->high = (void*)end;
+      found = 1;
+      break;
+    }
+  }
+  fclose(fp);
+  return found;
+}
+
+/*
+ * Look up a cloned thread's stack bounds the way the runtime did before musl
+ * recorded them, through pthread_getattr_np() on the thread's first migration
+ * and from TLS afterwards.
+ */
+static int legacy_bounds(stack_bounds* bounds)
+{
+  pthread_attr_t attr;
+  size_t size;
+
+  if(!legacy_cache.high)
+  {
+    if(pthread_getattr_np(pthread_self(), &attr) ||
+       pthread_attr_getstack(&attr, &legacy_cache.low, &size)) return 0;
+    legacy_cache.high = legacy_cache.low + size;
+    pthread_attr_destroy(&attr);
+  }
+  *bounds = legacy_cache;
+  return 1;
+}
+
+static unsigned long time_runtime(stack_bounds* bounds, int times)
+{
+  struct timespec start, end;
+  int i;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(i = 0; i < times; i++) *bounds = get_stack_bounds();
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return elapsed(&start, &end);
+}
+
+static unsigned long time_legacy(stack_bounds* bounds, int times)
+{
+  struct timespec start, end;
+  int i;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(i = 0; i < times; i++) legacy_bounds(bounds);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return elapsed(&start, &end);
+}
+
+void* thread_main(void* args)
+{
+  lookup_time* time = (lookup_time*)args;
+  stack_bounds runtime, legacy;
+  void* sp = &runtime;
+
+  // Note: alternate which lookup goes first so that neither consistently
+  // benefits from the other warming up the caches
+  pthread_barrier_wait(&barrier);
+  if(time->id % 2)
+  {
+    time->runtime_first = time_runtime(&runtime, 1);
+    time->legacy_first = time_legacy(&legacy, 1);
+  }
+  else
+  {
+    time->legacy_first = time_legacy(&legacy, 1);
+    time->runtime_first = time_runtime(&runtime, 1);
+  }
+
+  pthread_barrier_wait(&barrier);
+  time->runtime_repeat = time_runtime(&runtime, REPEAT) / REPEAT;
+  time->legacy_repeat = time_legacy(&legacy, REPEAT) / REPEAT;
+
+  time->valid = runtime.low && runtime.low < sp && sp < runtime.high &&
+                legacy.low && legacy.low < sp && sp < legacy.high;
+  return NULL;
+}
+
+int main(int argc, char** argv)
+{
+  int i, ret = 0;
+  pthread_t* threads;
+  lookup_time* times;
+  stack_bounds main_bounds;
+  struct timespec start, end;
+  unsigned long main_time,
+                runtime_sum = 0, runtime_max = 0, runtime_repeat = 0,
+                legacy_sum = 0, legacy_max = 0, legacy_repeat = 0;
+
+  if(argc > 1) num_threads = atoi(argv[1]);
+  if(num_threads < 1) num_threads = 1;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if(!legacy_main_bounds(&main_bounds))
+  {
+    fprintf(stderr, "Couldn't find the main thread's stack in procfs\n");
+    return 1;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  main_time = elapsed(&start, &end);
+
+  threads = (pthread_t*)malloc(sizeof(pthread_t) * num_threads);
+  times = (lookup_time*)calloc(num_threads, sizeof(lookup_time));
+  if(!threads || !times)
+  {
+    fprintf(stderr, "Couldn't allocate thread data\n");
+    return 1;
+  }
+
+  pthread_barrier_init(&barrier, NULL, num_threads);
+  for(i = 0; i < num_threads; i++)
+  {
+    times[i].id = i;
+    if(pthread_create(&threads[i], NULL, thread_main, &times[i]))
+    {
+      fprintf(stderr, "Couldn't spawn thread %d\n", i);
+      return 1;
+    }
+  }
+
+  for(i = 0; i < num_threads; i++)
+  {
+    pthread_join(threads[i], NULL);
+    if(!times[i].valid)
+    {
+      fprintf(stderr, "Thread %d's stack pointer is outside its bounds\n", i);
+      ret = 1;
+    }
+    runtime_sum += times[i].runtime_first;
+    legacy_sum += times[i].legacy_first;
+    runtime_repeat += times[i].runtime_repeat;
+    legacy_repeat += times[i].legacy_repeat;
+    if(times[i].runtime_first > runtime_max)
+      runtime_max = times[i].runtime_first;
+    if(times[i].legacy_first > legacy_max)
+      legacy_max = times[i].legacy_first;
+  }
+
+  printf("Legacy main thread lookup (once at startup): %lu ns\n", main_time);
+  printf("Descriptor first lookup (%d threads): %lu ns average, %lu ns max, "
+         "%lu ns afterwards\n", num_threads, runtime_sum / num_threads,
+         runtime_max, runtime_repeat / num_threads);
+  printf("Legacy first lookup (%d threads): %lu ns average, %lu ns max, "
+         "%lu ns afterwards\n", num_threads, legacy_sum / num_threads,
+         legacy_max, legacy_repeat / num_threads);
+  if(!ret) printf("Stack bounds verified\n");
+
+  pthread_barrier_destroy(&barrier);
+  free(times);
+  free(threads);
+  return ret;
+}
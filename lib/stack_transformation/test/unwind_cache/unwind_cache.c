@@ -0,0 +1,88 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <stack_transform.h>
+#include "stack_transform_timing.h"
+
+#define MAX_DEPTH 500
+
+#ifdef __aarch64__
+# define BIN "./unwind_cache_aarch64"
+# define REGSET struct regset_aarch64
+# define READ_REGS READ_REGS_AARCH64
+# define PC pc
+#elif defined(__powerpc64__)
+# define BIN "./unwind_cache_powerpc64"
+# define REGSET struct regset_powerpc64
+# define READ_REGS READ_REGS_POWERPC64
+# define PC pc
+#elif defined(__x86_64__)
+# define BIN "./unwind_cache_x86-64"
+# define REGSET struct regset_x86_64
+# define READ_REGS READ_REGS_X86_64
+# define PC rip
+#endif
+
+static int max_depth = 64;
+static int iterations = 100;
+
+void outer_frame()
+{
+  int i, ret = 0;
+  struct timespec start, end;
+  st_unwind_cache_stats stats;
+  REGSET regset, regset_dest;
+  stack_bounds bounds = get_stack_bounds();
+  st_handle handle = st_init(BIN);
+
+  if(!handle)
+  {
+    fprintf(stderr, "Couldn't open ELF information\n");
+    exit(1);
+  }
+
+  READ_REGS(regset);
+  regset.PC = get_call_site();
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(i = 0; i < iterations && !ret; i++)
+    ret = st_rewrite_stack(handle, &regset, bounds.high,
+                           handle, &regset_dest, bounds.low);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  st_destroy(handle);
+
+  if(ret)
+  {
+    fprintf(stderr, "Couldn't re-write the stack (iteration %d)\n", i);
+    exit(1);
+  }
+
+  st_get_unwind_cache_stats(&stats);
+  printf("[ST] Average transform time: %lu\n",
+         ((end.tv_sec * 1000000000 + end.tv_nsec) -
+          (start.tv_sec * 1000000000 + start.tv_nsec)) / iterations);
+  printf("[ST] Unwind cache: %lu hits, %lu misses, ~%luns saved\n",
+         stats.hits, stats.misses, stats.saved_ns);
+}
+
+void recurse(int depth)
+{
+  if(depth < max_depth) recurse(depth + 1);
+  else outer_frame();
+}
+
+int main(int argc, char** argv)
+{
+  if(argc > 1) max_depth = atoi(argv[1]);
+  if(argc > 2) iterations = atoi(argv[2]);
+  if(max_depth < 1 || max_depth > MAX_DEPTH || iterations < 1)
+  {
+    fprintf(stderr, "Depth must be between 1 and %d & iterations must be "
+                    "positive\n", MAX_DEPTH);
+    return 1;
+  }
+
+  recurse(1);
+  return 0;
+}
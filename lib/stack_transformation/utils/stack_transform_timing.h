@@ -113,10 +113,11 @@ get_call_site() { return __builtin_return_address(0); }
   })
 
 /*
- * Time & test the re-write with a previously initialized handle.  Useful for
+ * Time & test the re-write with a previously initialized handle using
+ * REWRITE_FN (e.g., st_rewrite_stack or st_rewrite_ondemand).  Useful for
  * testing multi-threaded applications which all use the same handle.
  */
-#define TIME_AND_TEST_NO_INIT( aarch64_handle, func ) \
+#define TIME_AND_TEST_NO_INIT_WITH( aarch64_handle, func, rewrite_fn ) \
   ({ \
     int ret; \
     struct timespec start = { .tv_sec = 0, .tv_nsec = 0 }; \
@@ -128,8 +129,8 @@ get_call_site() { return __builtin_return_address(0); }
     if(aarch64_handle) \
     { \
       clock_gettime(CLOCK_MONOTONIC, &start); \
-      ret = st_rewrite_stack(aarch64_handle, &regset, bounds.high, \
-                             aarch64_handle, &regset_dest, bounds.low); \
+      ret = rewrite_fn(aarch64_handle, &regset, bounds.high, \
+                       aarch64_handle, &regset_dest, bounds.low); \
       if(ret) fprintf(stderr, "Couldn't re-write the stack\n"); \
       else \
       { \
@@ -146,6 +147,10 @@ get_call_site() { return __builtin_return_address(0); }
     else fprintf(stderr, "Invalid stack transformation handle\n"); \
   })
 
+/* Time & test rewriting the entire stack with a previously initialized handle */
+#define TIME_AND_TEST_NO_INIT( aarch64_handle, func ) \
+  TIME_AND_TEST_NO_INIT_WITH(aarch64_handle, func, st_rewrite_stack)
+
 #elif defined(__powerpc64__)
 
 /*
@@ -253,10 +258,11 @@ get_call_site() { return __builtin_return_address(0); }
   })
 
 /*
- * Time & test the re-write with a previously initialized handle.  Good for
+ * Time & test the re-write with a previously initialized handle using
+ * REWRITE_FN (e.g., st_rewrite_stack or st_rewrite_ondemand).  Good for
  * testing multi-threaded applications which all use the same handle.
  */
-#define TIME_AND_TEST_NO_INIT( powerpc64_handle, func ) \
+#define TIME_AND_TEST_NO_INIT_WITH( powerpc64_handle, func, rewrite_fn ) \
   ({ \
     int ret; \
     struct timespec start = { .tv_sec = 0, .tv_nsec = 0 }; \
@@ -268,8 +274,8 @@ get_call_site() { return __builtin_return_address(0); }
     if(powerpc64_handle) \
     { \
       clock_gettime(CLOCK_MONOTONIC, &start); \
-      ret = st_rewrite_stack(powerpc64_handle, &regset, bounds.high, \
-                             powerpc64_handle, &regset_dest, bounds.low); \
+      ret = rewrite_fn(powerpc64_handle, &regset, bounds.high, \
+                       powerpc64_handle, &regset_dest, bounds.low); \
       if(ret) fprintf(stderr, "Couldn't re-write the stack\n"); \
       else \
       { \
@@ -287,6 +293,10 @@ get_call_site() { return __builtin_return_address(0); }
       fprintf(stderr, "Invalid stack transformation handle\n"); \
   })
 
+/* Time & test rewriting the entire stack with a previously initialized handle */
+#define TIME_AND_TEST_NO_INIT( powerpc64_handle, func ) \
+  TIME_AND_TEST_NO_INIT_WITH(powerpc64_handle, func, st_rewrite_stack)
+
 #elif defined __x86_64__
 
 /* Times rewriting the entire stack (x86-64) */
@@ -390,10 +400,11 @@ get_call_site() { return __builtin_return_address(0); }
   })
 
 /*
- * Time & test the re-write with a previously initialized handle.  Good for
+ * Time & test the re-write with a previously initialized handle using
+ * REWRITE_FN (e.g., st_rewrite_stack or st_rewrite_ondemand).  Good for
  * testing multi-threaded applications which all use the same handle.
  */
-#define TIME_AND_TEST_NO_INIT( x86_64_handle, func ) \
+#define TIME_AND_TEST_NO_INIT_WITH( x86_64_handle, func, rewrite_fn ) \
   ({ \
     int ret; \
     struct timespec start = { .tv_sec = 0, .tv_nsec = 0 }; \
@@ -405,8 +416,8 @@ get_call_site() { return __builtin_return_address(0); }
     if(x86_64_handle) \
     { \
       clock_gettime(CLOCK_MONOTONIC, &start); \
-      ret = st_rewrite_stack(x86_64_handle, &regset, bounds.high, \
-                             x86_64_handle, &regset_dest, bounds.low); \
+      ret = rewrite_fn(x86_64_handle, &regset, bounds.high, \
+                       x86_64_handle, &regset_dest, bounds.low); \
       if(ret) fprintf(stderr, "Couldn't re-write the stack\n"); \
       else \
       { \
@@ -423,6 +434,10 @@ get_call_site() { return __builtin_return_address(0); }
     else fprintf(stderr, "Invalid stack transformation handle\n"); \
   })
 
+/* Time & test rewriting the entire stack with a previously initialized handle */
+#define TIME_AND_TEST_NO_INIT( x86_64_handle, func ) \
+  TIME_AND_TEST_NO_INIT_WITH(x86_64_handle, func, st_rewrite_stack)
+
 #else
 
 # error Unsupported architecture!
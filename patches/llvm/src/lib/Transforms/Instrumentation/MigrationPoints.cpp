@@ -73,11 +73,16 @@ public:
     std::vector<Type *> ArgTy = { CallbackType, VoidPtrTy };
     FunctionType *FuncTy = FunctionType::get(VoidTy, ArgTy, false);
     if(DoHTM) {
-      MigrateAPI = M.getOrInsertFunction("migrate", FuncTy);
+      // The flag is a per-thread migration request slot holding the node to
+      // which the thread should migrate (or -1 if none), which is passed
+      // directly to the migration library
+      std::vector<Type *> NidArgTy = { Type::getInt32Ty(C), CallbackType,
+                                       VoidPtrTy };
+      FunctionType *NidFuncTy = FunctionType::get(VoidTy, NidArgTy, false);
+      MigrateAPI = M.getOrInsertFunction("migrate", NidFuncTy);
       MigrateFlag = cast<GlobalValue>(
         M.getOrInsertGlobal(MIGRATE_FLAG_NAME, Type::getInt32Ty(C)));
-      // TODO this needs to be thread-local storage
-      //MigrateFlag->setThreadLocal(true);
+      MigrateFlag->setThreadLocalMode(GlobalValue::InitialExecTLSModel);
     }
     else {
       MigrateAPI = M.getOrInsertFunction("check_migrate", FuncTy);
@@ -243,7 +248,8 @@ private:
   unsigned AbortHandlerCount;
   std::ofstream MapFile;
 
-  /// Function declaration & migration node ID for migration library API
+  /// Function declaration & per-thread migration request flag (holding the
+  /// requested node ID) for migration library API
   Constant *MigrateAPI;
   GlobalValue *MigrateFlag;
   PointerType *CallbackType;
@@ -343,14 +349,15 @@ private:
 
       AbortHandlerCount++;
     }
-    Value *Flag = FlagCheckWorker.CreateLoad(MigrateFlag);
+    Value *Flag = FlagCheckWorker.CreateLoad(MigrateFlag, true, "migflag");
     Value *NegOne = ConstantInt::get(Type::getInt32Ty(C), -1, true);
     Value *Cmp = FlagCheckWorker.CreateICmpEQ(Flag, NegOne);
     FlagCheckWorker.CreateCondBr(Cmp, NewSuccBB, MigPointBB);
 
-    // Add call to migration library API.
+    // Add call to migration library API, migrating to the requested node.
     IRBuilder<> MigPointWorker(MigPointBB);
     std::vector<Value *> Args = {
+      Flag,
       ConstantPointerNull::get(CallbackType),
       ConstantPointerNull::get(Type::getInt8PtrTy(C, 0))
     };